@@ -0,0 +1,532 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+#include <glib-unix.h>
+
+#include <net/if.h>
+#include <signal.h>
+
+#include "netif-agent.h"
+#include "netif-wire.h"
+
+/* ticks between keyframes, new viewers get one as they connect */
+#define AGENT_KEYFRAME_TICKS	30
+
+/* unsent bytes after which a viewer is dropped, it reconnects to a keyframe */
+#define AGENT_MAX_BACKLOG	(4 << 20)
+
+#define CLIENT_RETRY_SECONDS	5
+#define CLIENT_READ_SIZE	65536
+
+/*
+ * agent: one dump per interval, encoded once and queued to every viewer
+ */
+
+struct agent_peer {
+	GSocketConnection *conn;
+	GSocket *socket;
+	char *name;
+	GByteArray *pending;
+};
+
+struct agent {
+	struct netif_source *source;
+
+	/* the state last sent, and the one being dumped */
+	struct netif_wire prev;
+	struct netif_wire cur;
+
+	GSocketService *service;
+	GPtrArray *peers;
+	GMainLoop *loop;
+};
+
+static void agent_peer_free(gpointer data)
+{
+	struct agent_peer *peer = data;
+
+	g_io_stream_close(G_IO_STREAM(peer->conn), NULL, NULL);
+	g_object_unref(peer->conn);
+	g_byte_array_unref(peer->pending);
+	g_free(peer->name);
+	g_free(peer);
+}
+
+/* Returns false once @peer is gone or hopelessly behind */
+static bool agent_peer_flush(struct agent_peer *peer)
+{
+	while (peer->pending->len) {
+		g_autoptr(GError) error = NULL;
+		gssize n = g_socket_send(peer->socket, (const char *)peer->pending->data,
+				peer->pending->len, NULL, &error);
+
+		if (n < 0) {
+			if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+				break;
+			g_message("%s: %s", peer->name, error->message);
+			return false;
+		}
+
+		g_byte_array_remove_range(peer->pending, 0, n);
+	}
+
+	if (peer->pending->len > AGENT_MAX_BACKLOG) {
+		g_message("%s: %u bytes behind, dropped", peer->name, peer->pending->len);
+		return false;
+	}
+
+	return true;
+}
+
+static void agent_send(struct agent *agent, const GByteArray *frame)
+{
+	for (guint i = agent->peers->len; i-- > 0;) {
+		struct agent_peer *peer = g_ptr_array_index(agent->peers, i);
+
+		g_byte_array_append(peer->pending, frame->data, frame->len);
+		if (!agent_peer_flush(peer))
+			g_ptr_array_remove_index_fast(agent->peers, i);
+	}
+}
+
+static gboolean agent_incoming(GSocketService *service, GSocketConnection *conn,
+		GObject *source, gpointer data)
+{
+	struct agent *agent = data;
+	struct agent_peer *peer = g_new0(struct agent_peer, 1);
+	g_autoptr(GSocketAddress) addr = g_socket_connection_get_remote_address(conn, NULL);
+	g_autofree char *host = NULL;
+
+	if (G_IS_INET_SOCKET_ADDRESS(addr))
+		host = g_inet_address_to_string(g_inet_socket_address_get_address(
+					G_INET_SOCKET_ADDRESS(addr)));
+
+	peer->conn = g_object_ref(conn);
+	peer->socket = g_socket_connection_get_socket(conn);
+	peer->name = g_strdup(host ? host : "viewer");
+	peer->pending = g_byte_array_new();
+	g_socket_set_blocking(peer->socket, FALSE);
+
+	/* start from the last state sent, the next delta builds on it */
+	g_byte_array_append(peer->pending, (const guint8 *)NETIF_WIRE_MAGIC,
+			NETIF_WIRE_MAGIC_LEN);
+	if (agent->prev.tick)
+		netif_wire_encode(NULL, &agent->prev, peer->pending);
+
+	g_debug("%s connected", peer->name);
+
+	if (agent_peer_flush(peer))
+		g_ptr_array_add(agent->peers, peer);
+	else
+		agent_peer_free(peer);
+
+	return TRUE;
+}
+
+static void agent_sample(const struct netif_sample *sample, gpointer data)
+{
+	struct agent *agent = data;
+	struct netif_wire_link link = {
+		.ifindex = sample->ifindex,
+		.counters = {
+			[NETIF_WIRE_RX_BYTES] = sample->rx_bytes,
+			[NETIF_WIRE_TX_BYTES] = sample->tx_bytes,
+			[NETIF_WIRE_RX_PACKETS] = sample->rx_packets,
+			[NETIF_WIRE_TX_PACKETS] = sample->tx_packets,
+		},
+	};
+
+	if (sample->ifname)
+		g_strlcpy(link.ifname, sample->ifname, sizeof(link.ifname));
+	else if (!if_indextoname(sample->ifindex, link.ifname))
+		snprintf(link.ifname, sizeof(link.ifname), "if%u", sample->ifindex);
+
+	g_array_append_val(agent->cur.links, link);
+}
+
+static gboolean agent_tick(gpointer data)
+{
+	struct agent *agent = data;
+	g_autoptr(GByteArray) frame = g_byte_array_new();
+	struct netif_wire tmp;
+	int err;
+
+	g_array_set_size(agent->cur.links, 0);
+	agent->cur.time = g_get_monotonic_time();
+	agent->cur.tick = agent->prev.tick + 1;
+
+	err = netif_source_dump(agent->source);
+	if (err < 0) {
+		g_warning("%s dump error: %s", agent->source->ops->name, g_strerror(-err));
+		return G_SOURCE_CONTINUE;
+	}
+	netif_wire_sort(&agent->cur);
+
+	if (agent->prev.tick == 0 || agent->cur.tick % AGENT_KEYFRAME_TICKS == 0)
+		netif_wire_encode(NULL, &agent->cur, frame);
+	else
+		netif_wire_encode(&agent->prev, &agent->cur, frame);
+	agent_send(agent, frame);
+
+	tmp = agent->prev;
+	agent->prev = agent->cur;
+	agent->cur = tmp;
+
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean agent_quit(gpointer data)
+{
+	struct agent *agent = data;
+
+	g_main_loop_quit(agent->loop);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static int agent_listen_address(struct agent *agent, GInetAddress *inet, guint16 port,
+		GError **error)
+{
+	g_autoptr(GSocketAddress) addr = g_inet_socket_address_new(inet, port);
+
+	return g_socket_listener_add_address(G_SOCKET_LISTENER(agent->service), addr,
+			G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP, NULL, NULL, error) ?
+		0 : -EINVAL;
+}
+
+/* The stream is unauthenticated, so a bare port only serves this machine */
+static int agent_listen_loopback(struct agent *agent, guint16 port, GError **error)
+{
+	g_autoptr(GInetAddress) inet4 = g_inet_address_new_loopback(G_SOCKET_FAMILY_IPV4);
+	g_autoptr(GInetAddress) inet6 = g_inet_address_new_loopback(G_SOCKET_FAMILY_IPV6);
+	g_autoptr(GError) error6 = NULL;
+
+	if (agent_listen_address(agent, inet4, port, error) < 0)
+		return -EINVAL;
+
+	/* hosts with IPv6 disabled only get 127.0.0.1 */
+	if (agent_listen_address(agent, inet6, port, &error6) < 0)
+		g_debug("listen on [::1]:%u: %s", port, error6->message);
+
+	return 0;
+}
+
+static int agent_listen(struct agent *agent, const char *listen, GError **error)
+{
+	g_autoptr(GSocketConnectable) connectable = NULL;
+	g_autoptr(GInetAddress) inet = NULL;
+	char *end;
+	guint64 port;
+
+	if (!listen)
+		return agent_listen_loopback(agent, NETIF_AGENT_PORT, error);
+
+	port = g_ascii_strtoull(listen, &end, 10);
+	if (*listen && !*end && port <= G_MAXUINT16)
+		return agent_listen_loopback(agent, port, error);
+
+	connectable = g_network_address_parse(listen, NETIF_AGENT_PORT, error);
+	if (!connectable)
+		return -EINVAL;
+
+	inet = g_inet_address_new_from_string(
+			g_network_address_get_hostname(G_NETWORK_ADDRESS(connectable)));
+	if (!inet) {
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+				"%s: not an IP address", listen);
+		return -EINVAL;
+	}
+
+	return agent_listen_address(agent, inet,
+			g_network_address_get_port(G_NETWORK_ADDRESS(connectable)), error);
+}
+
+int netif_agent_run(const char *source_spec, const char *listen, guint interval_ms)
+{
+	struct agent agent = { 0 };
+	g_autoptr(GError) error = NULL;
+	guint tick_id, int_id, term_id;
+	int err;
+
+	err = netif_source_open(&agent.source, source_spec, agent_sample, &agent);
+	if (err < 0) {
+		g_printerr("stats source %s: %s\n", source_spec ? source_spec : "netlink",
+				g_strerror(-err));
+		return err;
+	}
+
+	netif_wire_init(&agent.prev);
+	netif_wire_init(&agent.cur);
+	agent.peers = g_ptr_array_new_with_free_func(agent_peer_free);
+	agent.service = g_socket_service_new();
+	agent.loop = g_main_loop_new(NULL, FALSE);
+
+	err = agent_listen(&agent, listen, &error);
+	if (err < 0) {
+		g_printerr("listen %s: %s\n", listen ? listen : "", error->message);
+		goto out;
+	}
+
+	g_signal_connect(agent.service, "incoming", G_CALLBACK(agent_incoming), &agent);
+	g_socket_service_start(agent.service);
+
+	agent_tick(&agent);
+	tick_id = g_timeout_add(MAX(interval_ms, 10), agent_tick, &agent);
+	int_id = g_unix_signal_add(SIGINT, agent_quit, &agent);
+	term_id = g_unix_signal_add(SIGTERM, agent_quit, &agent);
+
+	g_main_loop_run(agent.loop);
+
+	g_source_remove(tick_id);
+	g_source_remove(int_id);
+	g_source_remove(term_id);
+	g_socket_service_stop(agent.service);
+
+out:
+	g_socket_listener_close(G_SOCKET_LISTENER(agent.service));
+	g_object_unref(agent.service);
+	g_ptr_array_unref(agent.peers);
+	g_main_loop_unref(agent.loop);
+	netif_wire_clear(&agent.prev);
+	netif_wire_clear(&agent.cur);
+	netif_source_free(agent.source);
+
+	return err;
+}
+
+/*
+ * client: mirrors the agent's interfaces from the stream, the widget
+ * drains the mirror on its own tick
+ */
+
+struct netif_agent_client {
+	char *address;
+	GSocketClient *client;
+	GSocketConnection *conn;
+	GCancellable *cancellable;
+	guint retry_id;
+	bool warned;
+
+	GByteArray *buf;
+	guint8 *chunk;
+	bool hello;
+
+	struct netif_wire wire;
+	GArray *removed;
+	bool fresh;
+};
+
+static void client_connect(struct netif_agent_client *self);
+
+static gboolean client_retry(gpointer data)
+{
+	struct netif_agent_client *self = data;
+
+	self->retry_id = 0;
+	client_connect(self);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Everything seen is gone until a new keyframe says otherwise */
+static void client_reset(struct netif_agent_client *self, const char *reason)
+{
+	if (!self->warned)
+		g_warning("agent %s: %s", self->address, reason);
+	self->warned = true;
+
+	if (self->conn) {
+		g_io_stream_close(G_IO_STREAM(self->conn), NULL, NULL);
+		g_clear_object(&self->conn);
+	}
+	g_byte_array_set_size(self->buf, 0);
+	self->hello = false;
+
+	for (guint i = 0; i < self->wire.links->len; i++)
+		g_array_append_val(self->removed,
+				g_array_index(self->wire.links, struct netif_wire_link, i).ifindex);
+	g_array_set_size(self->wire.links, 0);
+	self->wire.synced = false;
+	self->fresh = true;
+
+	self->retry_id = g_timeout_add_seconds(CLIENT_RETRY_SECONDS, client_retry, self);
+}
+
+static int client_parse(struct netif_agent_client *self)
+{
+	gsize off = 0;
+	int err = 0;
+
+	if (!self->hello) {
+		if (self->buf->len < NETIF_WIRE_MAGIC_LEN)
+			return 0;
+		if (memcmp(self->buf->data, NETIF_WIRE_MAGIC, NETIF_WIRE_MAGIC_LEN) != 0)
+			return -EPROTO;
+		self->hello = true;
+		off = NETIF_WIRE_MAGIC_LEN;
+	}
+
+	while (off < self->buf->len) {
+		gsize payload;
+		gssize n = netif_wire_frame(self->buf->data + off, self->buf->len - off,
+				&payload);
+
+		if (n <= 0) {
+			err = n;
+			break;
+		}
+
+		err = netif_wire_decode(&self->wire, self->buf->data + off + payload,
+				n - payload, self->removed);
+		if (err < 0)
+			break;
+
+		self->fresh = true;
+		off += n;
+	}
+
+	g_byte_array_remove_range(self->buf, 0, off);
+
+	return err;
+}
+
+static void client_read_done(GObject *object, GAsyncResult *result, gpointer data)
+{
+	g_autoptr(GError) error = NULL;
+	gssize n = g_input_stream_read_finish(G_INPUT_STREAM(object), result, &error);
+	struct netif_agent_client *self = data;
+	int err;
+
+	if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		return;
+
+	if (n <= 0) {
+		client_reset(self, error ? error->message : "connection closed");
+		return;
+	}
+
+	g_byte_array_append(self->buf, self->chunk, n);
+	err = client_parse(self);
+	if (err < 0) {
+		client_reset(self, err == -EPROTO ? "not a netifstat agent" : "bad frame");
+		return;
+	}
+
+	g_input_stream_read_async(g_io_stream_get_input_stream(G_IO_STREAM(self->conn)),
+			self->chunk, CLIENT_READ_SIZE, G_PRIORITY_DEFAULT, self->cancellable,
+			client_read_done, self);
+}
+
+static void client_connect_done(GObject *object, GAsyncResult *result, gpointer data)
+{
+	g_autoptr(GError) error = NULL;
+	GSocketConnection *conn = g_socket_client_connect_finish(G_SOCKET_CLIENT(object),
+			result, &error);
+	struct netif_agent_client *self = data;
+
+	if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		return;
+
+	if (!conn) {
+		client_reset(self, error->message);
+		return;
+	}
+
+	if (self->warned)
+		g_message("agent %s: connected", self->address);
+	self->warned = false;
+	self->conn = conn;
+
+	g_input_stream_read_async(g_io_stream_get_input_stream(G_IO_STREAM(conn)),
+			self->chunk, CLIENT_READ_SIZE, G_PRIORITY_DEFAULT, self->cancellable,
+			client_read_done, self);
+}
+
+static void client_connect(struct netif_agent_client *self)
+{
+	g_socket_client_connect_to_host_async(self->client, self->address,
+			NETIF_AGENT_PORT, self->cancellable, client_connect_done, self);
+}
+
+struct netif_agent_client *netif_agent_client_new(const char *address)
+{
+	struct netif_agent_client *self = g_new0(struct netif_agent_client, 1);
+
+	self->address = g_strdup(address);
+	self->client = g_socket_client_new();
+	g_socket_client_set_timeout(self->client, CLIENT_RETRY_SECONDS);
+	self->cancellable = g_cancellable_new();
+	self->buf = g_byte_array_new();
+	self->chunk = g_malloc(CLIENT_READ_SIZE);
+	self->removed = g_array_new(FALSE, FALSE, sizeof(guint));
+	netif_wire_init(&self->wire);
+
+	client_connect(self);
+
+	return self;
+}
+
+void netif_agent_client_free(struct netif_agent_client *self)
+{
+	/* the pending callbacks see G_IO_ERROR_CANCELLED and leave self alone */
+	g_cancellable_cancel(self->cancellable);
+	g_clear_handle_id(&self->retry_id, g_source_remove);
+	if (self->conn) {
+		g_io_stream_close(G_IO_STREAM(self->conn), NULL, NULL);
+		g_object_unref(self->conn);
+	}
+	g_object_unref(self->cancellable);
+	g_object_unref(self->client);
+	g_byte_array_unref(self->buf);
+	g_array_unref(self->removed);
+	netif_wire_clear(&self->wire);
+	g_free(self->chunk);
+	g_free(self->address);
+	g_free(self);
+}
+
+bool netif_agent_client_drain(struct netif_agent_client *self,
+		netif_agent_remove_func remove, netif_sample_func sample,
+		gpointer data, gint64 *time)
+{
+	if (!self->fresh)
+		return false;
+
+	for (guint i = 0; i < self->removed->len; i++)
+		remove(g_array_index(self->removed, guint, i), data);
+	g_array_set_size(self->removed, 0);
+
+	/* every link, unchanged counters make a zero rate */
+	for (guint i = 0; i < self->wire.links->len; i++) {
+		const struct netif_wire_link *link = &g_array_index(self->wire.links,
+				struct netif_wire_link, i);
+		struct netif_sample s = {
+			.ifindex = link->ifindex,
+			.ifname = link->ifname,
+			.rx_bytes = link->counters[NETIF_WIRE_RX_BYTES],
+			.tx_bytes = link->counters[NETIF_WIRE_TX_BYTES],
+			.rx_packets = link->counters[NETIF_WIRE_RX_PACKETS],
+			.tx_packets = link->counters[NETIF_WIRE_TX_PACKETS],
+		};
+
+		sample(&s, data);
+	}
+
+	*time = self->wire.time;
+	self->fresh = false;
+
+	return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+
+#include "netif-source.h"
+
+G_BEGIN_DECLS
+
+#define NETIF_AGENT_PORT	7447
+
+/*
+ * Serve dumps of @source_spec every @interval_ms to any number of viewers
+ * on @listen, "[ADDRESS:]PORT" or NULL for NETIF_AGENT_PORT, until SIGINT
+ * or SIGTERM. Without an address only loopback is served. See
+ * netif-wire.h for the stream.
+ */
+int netif_agent_run(const char *source_spec, const char *listen, guint interval_ms);
+
+struct netif_agent_client;
+
+typedef void (*netif_agent_remove_func)(guint ifindex, gpointer data);
+
+/* Keep a connection to the agent at "HOST[:PORT]", reconnecting as needed */
+struct netif_agent_client *netif_agent_client_new(const char *address);
+void netif_agent_client_free(struct netif_agent_client *client);
+
+/*
+ * Report the interfaces gone since the last call to @remove, then every
+ * present one to @sample. Returns false if no frame arrived in between.
+ * *@time is the frame's agent monotonic time in usec.
+ */
+bool netif_agent_client_drain(struct netif_agent_client *client,
+		netif_agent_remove_func remove, netif_sample_func sample,
+		gpointer data, gint64 *time);
+
+G_END_DECLS
@@ -0,0 +1,661 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <adwaita.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "netif-chart.h"
+#include "netif-history.h"
+
+/* samples kept per series, a power of two so the ring wraps cheaply */
+#define CHART_SAMPLES	1024
+#define CHART_MASK	(CHART_SAMPLES - 1)
+
+/*
+ * Lines are built once per CHUNK samples and only moved afterwards, so a
+ * tick costs one short path per series instead of every visible segment.
+ */
+#define CHUNK		32
+#define CHUNKS		(CHART_SAMPLES / CHUNK)
+
+#define X_STEP		2.0f
+#define LEGEND_HEIGHT	20
+
+/*
+ * Spans the scroll wheel steps through, in seconds. The first is the live
+ * ring; the others are drawn from the history tier that fits the width.
+ */
+static const struct {
+	gint64 span;
+	const char *label;
+} chart_zooms[] = {
+	{ 0, NULL },
+	{ 10 * 60, "10 min" },
+	{ 60 * 60, "1 h" },
+	{ 24 * 60 * 60, "1 day" },
+	{ 30 * 24 * 60 * 60, "30 days" },
+};
+
+static const GdkRGBA chart_colors[] = {
+	{ 0.21, 0.52, 0.89, 1 }, { 0.93, 0.20, 0.23, 1 }, { 0.20, 0.82, 0.48, 1 },
+	{ 0.96, 0.76, 0.07, 1 }, { 0.57, 0.25, 0.67, 1 }, { 1.00, 0.47, 0.00, 1 },
+	{ 0.38, 0.21, 0.03, 1 }, { 0.47, 0.68, 0.91, 1 }, { 0.87, 0.48, 0.69, 1 },
+	{ 0.53, 0.53, 0.53, 1 },
+};
+
+struct chart_chunk {
+	/* generation and chunk number the node was built for */
+	guint generation;
+	guint64 id;
+	guint64 end;
+	GskRenderNode *node;
+};
+
+struct chart_series {
+	NetifLinkStats *netif;
+	GdkRGBA color;
+	guint64 rate[2][CHART_SAMPLES];
+	struct chart_chunk chunks[CHUNKS];
+
+	/* byte counters of netif_chart_sample(), the last pushed ones and when */
+	guint64 bytes[2];
+	guint64 last_bytes[2];
+	gint64 last_time;
+	bool sampled;
+
+	/* the legend entry, laid out for this name */
+	PangoLayout *legend;
+	char *legend_name;
+};
+
+struct _NetifChart {
+	GtkWidget base;
+
+	GPtrArray *series;
+
+	/* samples pushed so far, the newest is count - 1, and their wall clock time */
+	guint64 count;
+	gint64 time[CHART_SAMPLES];
+	gint64 push_time;
+	gint64 push_interval;
+
+	/* legend and scale layouts are valid for this pango context serial */
+	guint pango_serial;
+	PangoLayout *scale;
+	guint64 scale_ymax;
+	guint scale_zoom;
+
+	/* cached chunk nodes are valid for one height and y scale */
+	guint generation;
+	int height;
+	guint64 ymax;
+
+	/*
+	 * index into chart_zooms, and past the live ring the lines read from
+	 * history, rebuilt once per slot of the tier shown or on resize
+	 */
+	guint zoom;
+	GskRenderNode *history_node;
+	gint64 history_slot;
+	int history_width;
+	int history_height;
+
+	guint tick_id;
+};
+
+G_DEFINE_FINAL_TYPE(NetifChart, netif_chart, GTK_TYPE_WIDGET)
+
+static void chart_series_free(gpointer data)
+{
+	struct chart_series *series = data;
+
+	for (guint i = 0; i < CHUNKS; i++)
+		g_clear_pointer(&series->chunks[i].node, gsk_render_node_unref);
+	g_clear_object(&series->legend);
+	g_free(series->legend_name);
+	g_object_unref(series->netif);
+	g_free(series);
+}
+
+static struct chart_series *chart_series_new(NetifChart *self, NetifLinkStats *netif)
+{
+	struct chart_series *series = g_new0(struct chart_series, 1);
+	struct netif_history *history = netif->link ? netif->link->history : NULL;
+
+	series->netif = g_object_ref(netif);
+
+	/* backfill what the seconds tier still has, at the time of each sample */
+	guint64 first = self->count > CHART_SAMPLES ? self->count - CHART_SAMPLES : 0;
+
+	for (guint64 i = first; history && i < self->count; i++) {
+		const struct netif_history_slot *slot = netif_history_lookup(history,
+				NETIF_HISTORY_SECONDS, self->time[i & CHART_MASK] / G_USEC_PER_SEC);
+
+		if (!slot)
+			continue;
+
+		series->rate[0][i & CHART_MASK] = slot->sum[NETIF_HISTORY_RX_BYTES] / slot->count;
+		series->rate[1][i & CHART_MASK] = slot->sum[NETIF_HISTORY_TX_BYTES] / slot->count;
+	}
+
+	return series;
+}
+
+static float chart_y(NetifChart *self, guint64 rate)
+{
+	int height = self->height - LEGEND_HEIGHT;
+
+	return LEGEND_HEIGHT + height - (double)rate * height / self->ymax;
+}
+
+/* Stroke samples [first, end) of one series, x relative to @first */
+static GskRenderNode *chart_build_chunk(NetifChart *self, struct chart_series *series,
+		guint64 first, guint64 end)
+{
+	GtkSnapshot *snapshot = gtk_snapshot_new();
+
+	for (int dir = 0; dir < 2; dir++) {
+		GskPathBuilder *builder = gsk_path_builder_new();
+		GskStroke *stroke = gsk_stroke_new(dir ? 1.0 : 1.5);
+		GdkRGBA color = series->color;
+
+		for (guint64 i = first; i < end; i++) {
+			float x = (i - first) * X_STEP;
+			float y = chart_y(self, series->rate[dir][i & CHART_MASK]);
+
+			if (i == first)
+				gsk_path_builder_move_to(builder, x, y);
+			else
+				gsk_path_builder_line_to(builder, x, y);
+		}
+
+		/* tx is drawn lighter over the same color */
+		if (dir)
+			color.alpha = 0.5;
+
+		GskPath *path = gsk_path_builder_free_to_path(builder);
+		gtk_snapshot_append_stroke(snapshot, path, stroke, &color);
+		gsk_path_unref(path);
+		gsk_stroke_free(stroke);
+	}
+
+	return gtk_snapshot_free_to_node(snapshot);
+}
+
+static GskRenderNode *chart_chunk_node(NetifChart *self, struct chart_series *series,
+		guint64 id)
+{
+	struct chart_chunk *chunk = &series->chunks[id % CHUNKS];
+	/* one past the chunk, so consecutive chunks join up */
+	guint64 end = MIN((id + 1) * CHUNK + 1, self->count);
+
+	if (chunk->node && chunk->generation == self->generation &&
+	    chunk->id == id && chunk->end == end)
+		return chunk->node;
+
+	g_clear_pointer(&chunk->node, gsk_render_node_unref);
+	chunk->node = chart_build_chunk(self, series, id * CHUNK, end);
+	chunk->generation = self->generation;
+	chunk->id = id;
+	chunk->end = end;
+
+	return chunk->node;
+}
+
+/* Power of two above the largest visible rate, so it rarely changes */
+static guint64 chart_ymax(NetifChart *self, guint64 first)
+{
+	guint64 max = 1024;
+
+	for (guint s = 0; s < self->series->len; s++) {
+		struct chart_series *series = self->series->pdata[s];
+
+		for (guint64 i = first; i < self->count; i++)
+			max = MAX(max, MAX(series->rate[0][i & CHART_MASK],
+						series->rate[1][i & CHART_MASK]));
+	}
+
+	return 1ull << (64 - __builtin_clzll(max - 1));
+}
+
+static void netif_chart_text(GtkSnapshot *snapshot, PangoLayout *layout,
+		float x, float y, const GdkRGBA *color)
+{
+	gtk_snapshot_save(snapshot);
+	gtk_snapshot_translate(snapshot, &GRAPHENE_POINT_INIT(x, y));
+	gtk_snapshot_append_layout(snapshot, layout, color);
+	gtk_snapshot_restore(snapshot);
+}
+
+/* Laid out once per name, and again only when fonts or scale change */
+static PangoLayout *chart_series_legend(NetifChart *self, struct chart_series *series)
+{
+	struct netif_link *link = series->netif->link;
+	const char *name = link && link->ifname ? link->ifname : "";
+
+	if (series->legend && g_strcmp0(name, series->legend_name) == 0)
+		return series->legend;
+
+	g_clear_object(&series->legend);
+	g_free(series->legend_name);
+	series->legend = gtk_widget_create_pango_layout(GTK_WIDGET(self), name);
+	series->legend_name = g_strdup(name);
+
+	return series->legend;
+}
+
+static void netif_chart_context_changed(NetifChart *self)
+{
+	PangoContext *context = gtk_widget_get_pango_context(GTK_WIDGET(self));
+	guint serial = pango_context_get_serial(context);
+
+	if (serial == self->pango_serial)
+		return;
+
+	self->pango_serial = serial;
+	g_clear_object(&self->scale);
+	for (guint s = 0; s < self->series->len; s++) {
+		struct chart_series *series = self->series->pdata[s];
+
+		g_clear_object(&series->legend);
+	}
+}
+
+/* Mean per-second byte rate of @slot in direction @dir */
+static guint64 chart_slot_rate(const struct netif_history_slot *slot, int dir)
+{
+	return slot->sum[dir ? NETIF_HISTORY_TX_BYTES : NETIF_HISTORY_RX_BYTES] / slot->count;
+}
+
+/*
+ * The lines of every series over the zoomed span, one point per slot of
+ * the finest tier that fits the width. Gaps in the history break the line.
+ */
+static GskRenderNode *chart_build_history(NetifChart *self, int width,
+		enum netif_history_tier tier, gint64 end)
+{
+	gint64 span = chart_zooms[self->zoom].span;
+	gint64 step = netif_history_step(tier);
+	gint64 start = end - span;
+	GtkSnapshot *snapshot = gtk_snapshot_new();
+	guint64 max = 1024;
+
+	for (guint s = 0; s < self->series->len; s++) {
+		struct chart_series *series = self->series->pdata[s];
+		struct netif_link *link = series->netif->link;
+
+		for (gint64 t = start; link && link->history && t < end; t += step) {
+			const struct netif_history_slot *slot = netif_history_lookup(link->history,
+					tier, t);
+
+			if (slot)
+				max = MAX(max, MAX(chart_slot_rate(slot, 0), chart_slot_rate(slot, 1)));
+		}
+	}
+	self->ymax = 1ull << (64 - __builtin_clzll(max - 1));
+
+	for (guint s = 0; s < self->series->len; s++) {
+		struct chart_series *series = self->series->pdata[s];
+		struct netif_link *link = series->netif->link;
+
+		if (!link || !link->history)
+			continue;
+
+		for (int dir = 0; dir < 2; dir++) {
+			GskPathBuilder *builder = gsk_path_builder_new();
+			GskStroke *stroke = gsk_stroke_new(dir ? 1.0 : 1.5);
+			GdkRGBA color = series->color;
+			bool gap = true;
+
+			for (gint64 t = start; t < end; t += step) {
+				const struct netif_history_slot *slot = netif_history_lookup(link->history,
+						tier, t);
+				float x = (double)(t - start) * width / span;
+				float y;
+
+				if (!slot) {
+					gap = true;
+					continue;
+				}
+
+				y = chart_y(self, chart_slot_rate(slot, dir));
+				if (gap)
+					gsk_path_builder_move_to(builder, x, y);
+				else
+					gsk_path_builder_line_to(builder, x, y);
+				gap = false;
+			}
+
+			if (dir)
+				color.alpha = 0.5;
+
+			GskPath *path = gsk_path_builder_free_to_path(builder);
+			gtk_snapshot_append_stroke(snapshot, path, stroke, &color);
+			gsk_path_unref(path);
+			gsk_stroke_free(stroke);
+		}
+	}
+
+	return gtk_snapshot_free_to_node(snapshot);
+}
+
+static void chart_snapshot_history(NetifChart *self, GtkSnapshot *snapshot,
+		int width, int height)
+{
+	enum netif_history_tier tier = netif_history_tier_for(chart_zooms[self->zoom].span,
+			MAX(width, 1));
+	gint64 step = netif_history_step(tier);
+	gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+	/* the slot being filled is left out, its mean is still moving */
+	gint64 slot = now - now % step;
+
+	if (!self->history_node || self->history_slot != slot ||
+	    self->history_width != width || self->history_height != height) {
+		g_clear_pointer(&self->history_node, gsk_render_node_unref);
+		self->height = height;
+		self->history_node = chart_build_history(self, width, tier, slot);
+		self->history_slot = slot;
+		self->history_width = width;
+		self->history_height = height;
+		/* the live chunks were built for another scale */
+		self->generation++;
+	}
+
+	gtk_snapshot_append_node(snapshot, self->history_node);
+}
+
+static void chart_snapshot_live(NetifChart *self, GtkSnapshot *snapshot,
+		int width, int height)
+{
+	guint64 visible = MIN((guint64)(width / X_STEP) + 2, CHART_SAMPLES - CHUNK);
+	guint64 first = self->count > visible ? self->count - visible : 0;
+	guint64 ymax = chart_ymax(self, first);
+	float scroll = 0;
+
+	if (height != self->height || ymax != self->ymax) {
+		self->height = height;
+		self->ymax = ymax;
+		self->generation++;
+	}
+
+	/* slide between pushes instead of jumping a step per sample */
+	if (self->push_interval > 0)
+		scroll = MIN((float)(g_get_monotonic_time() - self->push_time) /
+				self->push_interval, 1.0f) * X_STEP;
+
+	for (guint s = 0; self->count && s < self->series->len; s++) {
+		struct chart_series *series = self->series->pdata[s];
+
+		for (guint64 id = first / CHUNK; id * CHUNK < self->count; id++) {
+			float x = width - (self->count - 1 - id * CHUNK) * X_STEP - scroll;
+
+			gtk_snapshot_save(snapshot);
+			gtk_snapshot_translate(snapshot, &GRAPHENE_POINT_INIT(x, 0));
+			gtk_snapshot_append_node(snapshot, chart_chunk_node(self, series, id));
+			gtk_snapshot_restore(snapshot);
+		}
+	}
+}
+
+static void netif_chart_snapshot(GtkWidget *widget, GtkSnapshot *snapshot)
+{
+	NetifChart *self = NETIF_CHART(widget);
+	int width = gtk_widget_get_width(widget);
+	int height = gtk_widget_get_height(widget);
+	GdkRGBA fg;
+
+	gtk_widget_get_color(widget, &fg);
+	netif_chart_context_changed(self);
+
+	gtk_snapshot_push_clip(snapshot, &GRAPHENE_RECT_INIT(0, 0, width, height));
+	if (self->zoom)
+		chart_snapshot_history(self, snapshot, width, height);
+	else
+		chart_snapshot_live(self, snapshot, width, height);
+	gtk_snapshot_pop(snapshot);
+
+	/* legend and scale */
+	float x = 0;
+	for (guint s = 0; s < self->series->len; s++) {
+		struct chart_series *series = self->series->pdata[s];
+
+		gtk_snapshot_append_color(snapshot, &series->color,
+				&GRAPHENE_RECT_INIT(x, 6, 8, 8));
+		netif_chart_text(snapshot, chart_series_legend(self, series), x + 12, 0, &fg);
+		x += 100;
+	}
+
+	/* ymax is a power of two of at least 1 KiB */
+	if (!self->scale || self->scale_ymax != self->ymax || self->scale_zoom != self->zoom) {
+		static const char *const units[] = { "KiB/s", "MiB/s", "GiB/s", "TiB/s" };
+		int shift = __builtin_ctzll(self->ymax) - 10;
+		int unit = MIN(shift / 10, (int)G_N_ELEMENTS(units) - 1);
+		char label[48];
+
+		snprintf(label, sizeof(label), "%"PRIu64" %s%s%s",
+				self->ymax >> (10 + unit * 10), units[unit],
+				self->zoom ? ", " : "",
+				self->zoom ? chart_zooms[self->zoom].label : "");
+		g_clear_object(&self->scale);
+		self->scale = gtk_widget_create_pango_layout(widget, label);
+		self->scale_ymax = self->ymax;
+		self->scale_zoom = self->zoom;
+	}
+	netif_chart_text(snapshot, self->scale, MAX(width - 140, x), 0, &fg);
+}
+
+/* The wheel steps out through the history tiers and back to the live ring */
+static gboolean netif_chart_scroll(GtkEventControllerScroll *controller,
+		double dx, double dy, gpointer data)
+{
+	NetifChart *self = data;
+	guint zoom = self->zoom;
+
+	if (dy > 0 && zoom + 1 < G_N_ELEMENTS(chart_zooms))
+		zoom++;
+	else if (dy < 0 && zoom > 0)
+		zoom--;
+
+	if (zoom == self->zoom)
+		return FALSE;
+
+	self->zoom = zoom;
+	g_clear_pointer(&self->history_node, gsk_render_node_unref);
+	self->generation++;
+	gtk_widget_queue_draw(GTK_WIDGET(self));
+
+	return TRUE;
+}
+
+static gboolean netif_chart_tick(GtkWidget *widget, GdkFrameClock *clock, gpointer data)
+{
+	gtk_widget_queue_draw(widget);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void netif_chart_update_tick(NetifChart *self)
+{
+	bool animate = self->series->len && gtk_widget_get_mapped(GTK_WIDGET(self));
+
+	if (animate && !self->tick_id) {
+		self->tick_id = gtk_widget_add_tick_callback(GTK_WIDGET(self),
+				netif_chart_tick, NULL, NULL);
+	} else if (!animate && self->tick_id) {
+		gtk_widget_remove_tick_callback(GTK_WIDGET(self), self->tick_id);
+		self->tick_id = 0;
+	}
+}
+
+void netif_chart_set_links(NetifChart *self, GPtrArray *links)
+{
+	g_autoptr(GPtrArray) series = g_ptr_array_new_with_free_func(chart_series_free);
+
+	for (guint i = 0; i < links->len; i++) {
+		struct chart_series *found = NULL;
+
+		for (guint s = 0; s < self->series->len; s++) {
+			struct chart_series *old = self->series->pdata[s];
+
+			if (old && old->netif == links->pdata[i]) {
+				found = g_ptr_array_steal_index(self->series, s);
+				break;
+			}
+		}
+
+		if (!found)
+			found = chart_series_new(self, links->pdata[i]);
+
+		/* the color is baked into the nodes */
+		found->color = chart_colors[i % G_N_ELEMENTS(chart_colors)];
+		for (guint c = 0; c < CHUNKS; c++)
+			g_clear_pointer(&found->chunks[c].node, gsk_render_node_unref);
+
+		g_ptr_array_add(series, found);
+	}
+
+	g_ptr_array_unref(self->series);
+	self->series = g_steal_pointer(&series);
+	g_clear_pointer(&self->history_node, gsk_render_node_unref);
+
+	netif_chart_update_tick(self);
+	gtk_widget_queue_draw(GTK_WIDGET(self));
+}
+
+void netif_chart_sample(NetifChart *self, struct netif_link *link,
+		guint64 rx_bytes, guint64 tx_bytes)
+{
+	for (guint s = 0; s < self->series->len; s++) {
+		struct chart_series *series = self->series->pdata[s];
+
+		if (series->netif->link != link)
+			continue;
+
+		series->bytes[0] = rx_bytes;
+		series->bytes[1] = tx_bytes;
+		series->sampled = true;
+	}
+}
+
+/* Rate since the previous sample of @series, 0 across a counter reset */
+static guint64 chart_series_rate(struct chart_series *series, int dir, gint64 now)
+{
+	if (!series->last_time || now <= series->last_time ||
+	    series->bytes[dir] < series->last_bytes[dir])
+		return 0;
+
+	return (series->bytes[dir] - series->last_bytes[dir]) * G_USEC_PER_SEC /
+		(now - series->last_time);
+}
+
+void netif_chart_push(NetifChart *self)
+{
+	gint64 now = g_get_monotonic_time();
+
+	for (guint s = 0; s < self->series->len; s++) {
+		struct chart_series *series = self->series->pdata[s];
+		struct netif_link *link = series->netif->link;
+		guint64 *rate[2] = {
+			&series->rate[0][self->count & CHART_MASK],
+			&series->rate[1][self->count & CHART_MASK],
+		};
+
+		if (series->sampled) {
+			for (int dir = 0; dir < 2; dir++) {
+				*rate[dir] = chart_series_rate(series, dir, now);
+				series->last_bytes[dir] = series->bytes[dir];
+			}
+			series->last_time = now;
+			series->sampled = false;
+			continue;
+		}
+
+		/* a removed interface flatlines until it is deselected */
+		*rate[0] = link ? netif_link_col(link, rx_rate) : 0;
+		*rate[1] = link ? netif_link_col(link, tx_rate) : 0;
+		series->last_time = 0;
+	}
+
+	self->time[self->count & CHART_MASK] = g_get_real_time();
+	if (self->push_time)
+		self->push_interval = now - self->push_time;
+	self->push_time = now;
+	self->count++;
+
+	gtk_widget_queue_draw(GTK_WIDGET(self));
+}
+
+static void netif_chart_measure(GtkWidget *widget, GtkOrientation orientation,
+		int for_size, int *minimum, int *natural,
+		int *minimum_baseline, int *natural_baseline)
+{
+	*minimum = orientation == GTK_ORIENTATION_HORIZONTAL ? 100 : 80;
+	*natural = orientation == GTK_ORIENTATION_HORIZONTAL ? 600 : 200;
+}
+
+static void netif_chart_map(GtkWidget *widget)
+{
+	GTK_WIDGET_CLASS(netif_chart_parent_class)->map(widget);
+	netif_chart_update_tick(NETIF_CHART(widget));
+}
+
+static void netif_chart_unmap(GtkWidget *widget)
+{
+	GTK_WIDGET_CLASS(netif_chart_parent_class)->unmap(widget);
+	netif_chart_update_tick(NETIF_CHART(widget));
+}
+
+static void netif_chart_dispose(GObject *object)
+{
+	NetifChart *self = NETIF_CHART(object);
+
+	g_clear_pointer(&self->series, g_ptr_array_unref);
+	g_clear_pointer(&self->history_node, gsk_render_node_unref);
+	g_clear_object(&self->scale);
+
+	G_OBJECT_CLASS(netif_chart_parent_class)->dispose(object);
+}
+
+static void netif_chart_class_init(NetifChartClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(class);
+	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(class);
+
+	object_class->dispose = netif_chart_dispose;
+
+	widget_class->snapshot = netif_chart_snapshot;
+	widget_class->measure = netif_chart_measure;
+	widget_class->map = netif_chart_map;
+	widget_class->unmap = netif_chart_unmap;
+}
+
+static void netif_chart_init(NetifChart *self)
+{
+	GtkEventController *scroll;
+
+	self->series = g_ptr_array_new_with_free_func(chart_series_free);
+	self->ymax = 1;
+
+	scroll = gtk_event_controller_scroll_new(GTK_EVENT_CONTROLLER_SCROLL_VERTICAL |
+			GTK_EVENT_CONTROLLER_SCROLL_DISCRETE);
+	g_signal_connect(scroll, "scroll", G_CALLBACK(netif_chart_scroll), self);
+	gtk_widget_add_controller(GTK_WIDGET(self), scroll);
+}
+
+GtkWidget *netif_chart_new(void)
+{
+	return g_object_new(NETIF_TYPE_CHART, NULL);
+}
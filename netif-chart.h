@@ -0,0 +1,31 @@
+#pragma once
+
+#include <adwaita.h>
+
+#include "netif-link-stats.h"
+
+G_BEGIN_DECLS
+
+#define NETIF_TYPE_CHART	(netif_chart_get_type())
+
+G_DECLARE_FINAL_TYPE(NetifChart, netif_chart, NETIF, CHART, GtkWidget)
+
+GtkWidget *netif_chart_new(void);
+
+/*
+ * Plot exactly @links, keeping the samples of series already shown and
+ * seeding new ones from their 1 s history.
+ */
+void netif_chart_set_links(NetifChart *self, GPtrArray *links);
+
+/* Counters of @link for the next push, sampled more often than the table */
+void netif_chart_sample(NetifChart *self, struct netif_link *link,
+		guint64 rx_bytes, guint64 tx_bytes);
+
+/*
+ * Append one sample per series: the rate since its last netif_chart_sample()
+ * counters if it got new ones, else the current rate of its table row.
+ */
+void netif_chart_push(NetifChart *self);
+
+G_END_DECLS
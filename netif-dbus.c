@@ -0,0 +1,425 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+
+#include "netif-dbus.h"
+#include "netif-link-table.h"
+#include "netif-perf.h"
+
+static const char netif_dbus_xml[] =
+	"<node>"
+	"  <interface name='" NETIF_DBUS_INTERFACE "'>"
+	"    <method name='GetSnapshot'>"
+	"      <arg type='t' name='tick' direction='out'/>"
+	"      <arg type='au' name='ifindex' direction='out'/>"
+	"      <arg type='as' name='ifname' direction='out'/>"
+	"      <arg type='at' name='rx_bytes' direction='out'/>"
+	"      <arg type='at' name='tx_bytes' direction='out'/>"
+	"      <arg type='at' name='rx_packets' direction='out'/>"
+	"      <arg type='at' name='tx_packets' direction='out'/>"
+	"      <arg type='at' name='rx_rate' direction='out'/>"
+	"      <arg type='at' name='tx_rate' direction='out'/>"
+	"    </method>"
+	"    <method name='Subscribe'>"
+	"      <arg type='d' name='max_rate' direction='in'/>"
+	"    </method>"
+	"    <method name='Unsubscribe'/>"
+	"    <method name='GetPerf'>"
+	"      <arg type='a(tutxxxxxx)' name='ticks' direction='out'/>"
+	"    </method>"
+	"    <signal name='Changed'>"
+	"      <arg type='t' name='tick'/>"
+	"      <arg type='au' name='ifindex'/>"
+	"      <arg type='as' name='ifname'/>"
+	"      <arg type='at' name='rx_bytes'/>"
+	"      <arg type='at' name='tx_bytes'/>"
+	"      <arg type='at' name='rx_packets'/>"
+	"      <arg type='at' name='tx_packets'/>"
+	"      <arg type='at' name='rx_rate'/>"
+	"      <arg type='at' name='tx_rate'/>"
+	"      <arg type='au' name='removed'/>"
+	"    </signal>"
+	"  </interface>"
+	"</node>";
+
+enum {
+	COL_RX_BYTES,
+	COL_TX_BYTES,
+	COL_RX_PACKETS,
+	COL_TX_PACKETS,
+	COL_RX_RATE,
+	COL_TX_RATE,
+	NR_COLS,
+};
+
+struct netif_dbus_client {
+	struct netif_dbus *dbus;
+	char *name;
+	guint watch_id;
+
+	gint64 min_interval;
+	gint64 last_emit;
+	guint64 last_tick;
+};
+
+/* An interface that came or went after the batch of @tick was sent */
+struct netif_dbus_event {
+	guint64 tick;
+	guint32 ifindex;
+};
+
+struct netif_dbus {
+	GDBusConnection *conn;
+	char *path;
+	guint reg_id;
+	GHashTable *netif_ht;
+	const struct netif_perf *perf;
+	guint64 tick;
+
+	/* unique bus name -> struct netif_dbus_client */
+	GHashTable *clients;
+
+	/* struct netif_dbus_event, kept until every client got them */
+	GArray *added;
+	GArray *removed;
+};
+
+/* Packed columns, one array per counter rather than a struct per interface */
+struct netif_dbus_columns {
+	GArray *ifindex;
+	GPtrArray *ifname;
+	GArray *col[NR_COLS];
+};
+
+static void netif_dbus_columns_init(struct netif_dbus_columns *c, guint size, bool names)
+{
+	c->ifindex = g_array_sized_new(FALSE, FALSE, sizeof(guint32), size);
+	c->ifname = names ? g_ptr_array_sized_new(size + 1) : NULL;
+	for (int i = 0; i < NR_COLS; i++)
+		c->col[i] = g_array_sized_new(FALSE, FALSE, sizeof(guint64), size);
+}
+
+static void netif_dbus_columns_add(struct netif_dbus_columns *c, struct netif_link *netif,
+		bool name)
+{
+	guint32 ifindex = netif->ifindex;
+	guint64 val[NR_COLS] = {
+		[COL_RX_BYTES] = netif_link_col(netif, rx_bytes),
+		[COL_TX_BYTES] = netif_link_col(netif, tx_bytes),
+		[COL_RX_PACKETS] = netif_link_col(netif, rx_packets),
+		[COL_TX_PACKETS] = netif_link_col(netif, tx_packets),
+		[COL_RX_RATE] = netif_link_col(netif, rx_rate),
+		[COL_TX_RATE] = netif_link_col(netif, tx_rate),
+	};
+
+	g_array_append_val(c->ifindex, ifindex);
+	if (c->ifname)
+		g_ptr_array_add(c->ifname, name && netif->ifname ? netif->ifname : "");
+	for (int i = 0; i < NR_COLS; i++)
+		g_array_append_val(c->col[i], val[i]);
+}
+
+static void netif_dbus_columns_clear(struct netif_dbus_columns *c)
+{
+	g_array_unref(c->ifindex);
+	if (c->ifname)
+		g_ptr_array_unref(c->ifname);
+	for (int i = 0; i < NR_COLS; i++)
+		g_array_unref(c->col[i]);
+}
+
+/* Consumes @c and returns the floating (t au [as] at... [au]) tuple */
+static GVariant *netif_dbus_columns_finish(struct netif_dbus_columns *c, guint64 tick,
+		GArray *removed)
+{
+	GVariant *children[2 + 1 + NR_COLS + 1];
+	int n = 0;
+
+	children[n++] = g_variant_new_uint64(tick);
+	children[n++] = g_variant_new_fixed_array(G_VARIANT_TYPE_UINT32,
+			c->ifindex->data, c->ifindex->len, sizeof(guint32));
+	if (c->ifname) {
+		g_ptr_array_add(c->ifname, NULL);
+		children[n++] = g_variant_new_strv((const char *const *)c->ifname->pdata, -1);
+	}
+	for (int i = 0; i < NR_COLS; i++)
+		children[n++] = g_variant_new_fixed_array(G_VARIANT_TYPE_UINT64,
+				c->col[i]->data, c->col[i]->len, sizeof(guint64));
+	if (removed)
+		children[n++] = g_variant_new_fixed_array(G_VARIANT_TYPE_UINT32,
+				removed->data, removed->len, sizeof(guint32));
+	netif_dbus_columns_clear(c);
+
+	return g_variant_new_tuple(children, n);
+}
+
+static GVariant *netif_dbus_snapshot(struct netif_dbus *dbus)
+{
+	struct netif_dbus_columns c;
+	GHashTableIter iter;
+	struct netif_link *netif;
+
+	netif_dbus_columns_init(&c, g_hash_table_size(dbus->netif_ht), true);
+
+	g_hash_table_iter_init(&iter, dbus->netif_ht);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&netif))
+		netif_dbus_columns_add(&c, netif, true);
+
+	return netif_dbus_columns_finish(&c, dbus->tick, NULL);
+}
+
+/* Oldest first: tick, messages, bytes, then dump, read, parse, update, format, total nsec */
+static GVariant *netif_dbus_perf(struct netif_dbus *dbus)
+{
+	GVariantBuilder builder;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("a(tutxxxxxx)"));
+	for (guint n = dbus->perf->len; n-- > 0;) {
+		const struct netif_perf_tick *t = netif_perf_get(dbus->perf, n);
+
+		g_variant_builder_add(&builder, "(tutxxxxxx)", t->tick, t->messages,
+				t->bytes, t->dump_ns, t->read_ns, t->parse_ns,
+				t->update_ns, t->format_ns, t->total_ns);
+	}
+
+	return g_variant_new("(a(tutxxxxxx))", &builder);
+}
+
+static void netif_dbus_client_free(gpointer data)
+{
+	struct netif_dbus_client *client = data;
+
+	g_bus_unwatch_name(client->watch_id);
+	g_free(client->name);
+	g_free(client);
+}
+
+static void netif_dbus_client_vanished(GDBusConnection *conn, const char *name,
+		gpointer data)
+{
+	struct netif_dbus_client *client = data;
+
+	g_hash_table_remove(client->dbus->clients, name);
+}
+
+static void netif_dbus_subscribe(struct netif_dbus *dbus, const char *sender,
+		double max_rate)
+{
+	struct netif_dbus_client *client = g_hash_table_lookup(dbus->clients, sender);
+
+	if (!client) {
+		client = g_new0(struct netif_dbus_client, 1);
+		client->dbus = dbus;
+		client->name = g_strdup(sender);
+		client->last_tick = dbus->tick;
+		g_hash_table_insert(dbus->clients, client->name, client);
+
+		client->watch_id = g_bus_watch_name_on_connection(dbus->conn, sender,
+				G_BUS_NAME_WATCHER_FLAGS_NONE, NULL,
+				netif_dbus_client_vanished, client, NULL);
+	}
+
+	client->min_interval = max_rate > 0 ? (gint64)(G_USEC_PER_SEC / max_rate) : 0;
+}
+
+static void netif_dbus_method_call(GDBusConnection *conn, const char *sender,
+		const char *path, const char *interface, const char *method,
+		GVariant *params, GDBusMethodInvocation *invocation, gpointer data)
+{
+	struct netif_dbus *dbus = data;
+
+	if (g_strcmp0(method, "GetSnapshot") == 0) {
+		g_dbus_method_invocation_return_value(invocation, netif_dbus_snapshot(dbus));
+	} else if (g_strcmp0(method, "Subscribe") == 0) {
+		double max_rate;
+
+		g_variant_get(params, "(d)", &max_rate);
+		if (max_rate < 0) {
+			g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR,
+					G_DBUS_ERROR_INVALID_ARGS, "negative max_rate");
+			return;
+		}
+
+		netif_dbus_subscribe(dbus, sender, max_rate);
+		g_dbus_method_invocation_return_value(invocation, NULL);
+	} else if (g_strcmp0(method, "Unsubscribe") == 0) {
+		g_hash_table_remove(dbus->clients, sender);
+		g_dbus_method_invocation_return_value(invocation, NULL);
+	} else if (g_strcmp0(method, "GetPerf") == 0) {
+		g_dbus_method_invocation_return_value(invocation, netif_dbus_perf(dbus));
+	}
+}
+
+static const GDBusInterfaceVTable netif_dbus_vtable = {
+	.method_call = netif_dbus_method_call,
+};
+
+/* Events are appended in tick order, return the first one after batch @tick */
+static guint netif_dbus_events_since(GArray *events, guint64 tick)
+{
+	guint i = events->len;
+
+	while (i > 0 && g_array_index(events, struct netif_dbus_event, i - 1).tick >= tick)
+		i--;
+
+	return i;
+}
+
+void netif_dbus_link_added(struct netif_dbus *dbus, guint ifindex)
+{
+	struct netif_dbus_event event = { dbus->tick, ifindex };
+
+	if (g_hash_table_size(dbus->clients))
+		g_array_append_val(dbus->added, event);
+}
+
+void netif_dbus_link_removed(struct netif_dbus *dbus, guint ifindex)
+{
+	struct netif_dbus_event event = { dbus->tick, ifindex };
+
+	if (g_hash_table_size(dbus->clients))
+		g_array_append_val(dbus->removed, event);
+}
+
+bool netif_dbus_active(struct netif_dbus *dbus)
+{
+	return g_hash_table_size(dbus->clients);
+}
+
+/*
+ * Send @client every interface whose counters changed since the last
+ * batch it received, addressed to it alone so each subscriber gets its
+ * own rate. Interfaces new to it carry their name, the others an empty
+ * one, and those that went away since are listed in removed.
+ */
+static void netif_dbus_emit(struct netif_dbus *dbus, struct netif_dbus_client *client)
+{
+	struct netif_dbus_columns c;
+	GHashTableIter iter;
+	struct netif_link *netif;
+	g_autoptr(GHashTable) added = NULL;
+	g_autoptr(GArray) removed = g_array_new(FALSE, FALSE, sizeof(guint32));
+	g_autoptr(GError) error = NULL;
+	guint i;
+
+	i = netif_dbus_events_since(dbus->added, client->last_tick);
+	if (i < dbus->added->len) {
+		added = g_hash_table_new(g_direct_hash, g_direct_equal);
+		for (; i < dbus->added->len; i++)
+			g_hash_table_add(added, GUINT_TO_POINTER(g_array_index(dbus->added,
+					struct netif_dbus_event, i).ifindex));
+	}
+
+	i = netif_dbus_events_since(dbus->removed, client->last_tick);
+	for (; i < dbus->removed->len; i++)
+		g_array_append_val(removed, g_array_index(dbus->removed,
+				struct netif_dbus_event, i).ifindex);
+
+	netif_dbus_columns_init(&c, 64, true);
+
+	g_hash_table_iter_init(&iter, dbus->netif_ht);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&netif))
+		if (netif_link_col(netif, change_tick) > client->last_tick)
+			netif_dbus_columns_add(&c, netif, added &&
+					g_hash_table_contains(added, GUINT_TO_POINTER(netif->ifindex)));
+
+	if (c.ifindex->len == 0 && removed->len == 0) {
+		netif_dbus_columns_clear(&c);
+		return;
+	}
+
+	if (!g_dbus_connection_emit_signal(dbus->conn, client->name, dbus->path,
+				NETIF_DBUS_INTERFACE, "Changed",
+				netif_dbus_columns_finish(&c, dbus->tick, removed), &error))
+		g_warning("emit Changed to %s: %s", client->name, error->message);
+}
+
+/* Drop the events every client has been sent */
+static void netif_dbus_events_prune(GArray *events, guint64 tick)
+{
+	guint i = 0;
+
+	while (i < events->len && g_array_index(events, struct netif_dbus_event, i).tick < tick)
+		i++;
+	if (i)
+		g_array_remove_range(events, 0, i);
+}
+
+void netif_dbus_tick(struct netif_dbus *dbus, guint64 tick)
+{
+	gint64 now = g_get_monotonic_time();
+	GHashTableIter iter;
+	struct netif_dbus_client *client;
+	guint64 oldest = tick;
+
+	dbus->tick = tick;
+
+	g_hash_table_iter_init(&iter, dbus->clients);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&client)) {
+		if (now - client->last_emit >= client->min_interval) {
+			netif_dbus_emit(dbus, client);
+			client->last_emit = now;
+			client->last_tick = tick;
+		}
+		oldest = MIN(oldest, client->last_tick);
+	}
+
+	netif_dbus_events_prune(dbus->added, oldest);
+	netif_dbus_events_prune(dbus->removed, oldest);
+}
+
+struct netif_dbus *netif_dbus_new(GDBusConnection *conn, const char *path,
+		GHashTable *netif_ht, const struct netif_perf *perf, GError **error)
+{
+	g_autoptr(GDBusNodeInfo) info = g_dbus_node_info_new_for_xml(netif_dbus_xml, error);
+	struct netif_dbus *dbus;
+
+	if (!info)
+		return NULL;
+
+	dbus = g_new0(struct netif_dbus, 1);
+	dbus->conn = g_object_ref(conn);
+	dbus->path = g_strdup(path);
+	dbus->netif_ht = g_hash_table_ref(netif_ht);
+	dbus->perf = perf;
+	dbus->clients = g_hash_table_new_full(g_str_hash, g_str_equal,
+			NULL, netif_dbus_client_free);
+	dbus->added = g_array_new(FALSE, FALSE, sizeof(struct netif_dbus_event));
+	dbus->removed = g_array_new(FALSE, FALSE, sizeof(struct netif_dbus_event));
+
+	dbus->reg_id = g_dbus_connection_register_object(conn, path,
+			g_dbus_node_info_lookup_interface(info, NETIF_DBUS_INTERFACE),
+			&netif_dbus_vtable, dbus, NULL, error);
+	if (!dbus->reg_id) {
+		netif_dbus_free(dbus);
+		return NULL;
+	}
+
+	return dbus;
+}
+
+void netif_dbus_free(struct netif_dbus *dbus)
+{
+	if (dbus->reg_id)
+		g_dbus_connection_unregister_object(dbus->conn, dbus->reg_id);
+	g_hash_table_destroy(dbus->clients);
+	g_array_unref(dbus->added);
+	g_array_unref(dbus->removed);
+	g_hash_table_unref(dbus->netif_ht);
+	g_object_unref(dbus->conn);
+	g_free(dbus->path);
+	g_free(dbus);
+}
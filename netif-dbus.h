@@ -0,0 +1,28 @@
+#pragma once
+
+#include <gio/gio.h>
+#include <stdbool.h>
+
+G_BEGIN_DECLS
+
+#define NETIF_DBUS_INTERFACE	"cc.call.netifstat.Stats"
+
+struct netif_dbus;
+struct netif_perf;
+
+/*
+ * Export the struct netif_link values of @netif_ht and the tick costs in
+ * @perf on @conn at @path. Both are read, never modified; call
+ * netif_dbus_tick() after each dump.
+ */
+struct netif_dbus *netif_dbus_new(GDBusConnection *conn, const char *path,
+		GHashTable *netif_ht, const struct netif_perf *perf, GError **error);
+void netif_dbus_tick(struct netif_dbus *dbus, guint64 tick);
+/* Report a link of @netif_ht in the next batch as new or gone */
+void netif_dbus_link_added(struct netif_dbus *dbus, guint ifindex);
+void netif_dbus_link_removed(struct netif_dbus *dbus, guint ifindex);
+/* Whether any client is subscribed to Changed */
+bool netif_dbus_active(struct netif_dbus *dbus);
+void netif_dbus_free(struct netif_dbus *dbus);
+
+G_END_DECLS
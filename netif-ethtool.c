@@ -0,0 +1,91 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include <netlink/socket.h>
+#include <netlink/netlink.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+#include <netlink/genl/genl.h>
+#include <netlink/genl/ctrl.h>
+#include <linux/ethtool.h>
+#include <linux/ethtool_netlink.h>
+#include <errno.h>
+
+#include "netif-ethtool.h"
+
+int netif_ethtool_family(struct nl_sock *sock)
+{
+	int family = genl_ctrl_resolve(sock, ETHTOOL_GENL_NAME);
+
+	return family < 0 ? -EOPNOTSUPP : family;
+}
+
+int netif_ethtool_request(struct nl_sock *sock, int family, guint ifindex)
+{
+	struct nl_msg *msg = nlmsg_alloc();
+	struct nlattr *header;
+	int err = -ENOMEM;
+
+	if (!msg)
+		return -ENOMEM;
+
+	if (!genlmsg_put(msg, NL_AUTO_PORT, NL_AUTO_SEQ, family, 0, 0,
+			ETHTOOL_MSG_LINKMODES_GET, ETHTOOL_GENL_VERSION))
+		goto out;
+
+	/* ethtool parses strictly, nests have to say so */
+	header = nla_nest_start(msg, ETHTOOL_A_LINKMODES_HEADER | NLA_F_NESTED);
+	if (!header ||
+	    nla_put_u32(msg, ETHTOOL_A_HEADER_DEV_INDEX, ifindex) < 0 ||
+	    /* the mode bitsets are not used, keep them short */
+	    nla_put_u32(msg, ETHTOOL_A_HEADER_FLAGS, ETHTOOL_FLAG_COMPACT_BITSETS) < 0)
+		goto out;
+	nla_nest_end(msg, header);
+
+	err = nl_send_auto(sock, msg) < 0 ? -EIO : 0;
+out:
+	nlmsg_free(msg);
+	return err;
+}
+
+int netif_ethtool_parse(struct nlmsghdr *hdr, struct netif_ethtool_speed *speed)
+{
+	struct nlattr *tb[ETHTOOL_A_LINKMODES_MAX + 1];
+	struct nlattr *header[ETHTOOL_A_HEADER_MAX + 1];
+	struct genlmsghdr *genl = nlmsg_data(hdr);
+	guint32 mbps;
+
+	if (genlmsg_parse(hdr, 0, tb, ETHTOOL_A_LINKMODES_MAX, NULL) < 0 ||
+	    genl->cmd != ETHTOOL_MSG_LINKMODES_GET_REPLY ||
+	    !tb[ETHTOOL_A_LINKMODES_HEADER] ||
+	    nla_parse_nested(header, ETHTOOL_A_HEADER_MAX,
+			tb[ETHTOOL_A_LINKMODES_HEADER], NULL) < 0 ||
+	    !header[ETHTOOL_A_HEADER_DEV_INDEX])
+		return -EINVAL;
+
+	mbps = tb[ETHTOOL_A_LINKMODES_SPEED] ?
+		nla_get_u32(tb[ETHTOOL_A_LINKMODES_SPEED]) : (guint32)SPEED_UNKNOWN;
+
+	*speed = (struct netif_ethtool_speed){
+		.ifindex = nla_get_u32(header[ETHTOOL_A_HEADER_DEV_INDEX]),
+		.speed = mbps == (guint32)SPEED_UNKNOWN ? 0 : mbps,
+		.half_duplex = tb[ETHTOOL_A_LINKMODES_DUPLEX] &&
+			nla_get_u8(tb[ETHTOOL_A_LINKMODES_DUPLEX]) == DUPLEX_HALF,
+	};
+
+	return 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+
+struct nl_sock;
+struct nlmsghdr;
+
+G_BEGIN_DECLS
+
+/* Negotiated speed and duplex from an ETHTOOL_MSG_LINKMODES_GET reply */
+struct netif_ethtool_speed {
+	guint ifindex;
+	guint32 speed;		/* Mb/s, 0 if unknown such as without carrier */
+	bool half_duplex;
+};
+
+/* Id of the ethtool generic netlink family on @sock, -errno before 5.6 */
+int netif_ethtool_family(struct nl_sock *sock);
+
+/* Ask for the link modes of @ifindex, the reply arrives on @sock */
+int netif_ethtool_request(struct nl_sock *sock, int family, guint ifindex);
+
+/* Fill @speed from a reply, -EINVAL if it is not one */
+int netif_ethtool_parse(struct nlmsghdr *hdr, struct netif_ethtool_speed *speed);
+
+G_END_DECLS
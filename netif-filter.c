@@ -0,0 +1,274 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <adwaita.h>
+
+#include "netif-filter.h"
+#include "netif-link-model.h"
+
+enum netif_filter_field {
+	NETIF_FILTER_NAME,
+	NETIF_FILTER_STATE,
+	NETIF_FILTER_NETNS,
+	NETIF_FILTER_HOST,
+};
+
+struct _NetifFilter {
+	GtkFilter base;
+
+	char *text;
+	enum netif_filter_field field;
+
+	/* exactly one is set while the filter is active */
+	char *needle;
+	GPatternSpec *glob;
+	GRegex *regex;
+	bool invalid;
+
+	/* bumped on every pattern change, 0 is never a valid serial */
+	guint serial;
+};
+
+G_DEFINE_FINAL_TYPE(NetifFilter, netif_filter, GTK_TYPE_FILTER)
+
+static const char *netif_filter_value(NetifFilter *self, struct netif_link *netif,
+		char *buf, size_t size)
+{
+	switch (self->field) {
+	case NETIF_FILTER_STATE:
+		return netif->state;
+	case NETIF_FILTER_NETNS:
+		if (netif->netnsid < 0)
+			return NULL;
+		snprintf(buf, size, "%d", netif->netnsid);
+		return buf;
+	case NETIF_FILTER_HOST:
+		return netif->host;
+	case NETIF_FILTER_NAME:
+	default:
+		return netif->ifname;
+	}
+}
+
+static bool netif_filter_eval(NetifFilter *self, struct netif_link *netif)
+{
+	char buf[16];
+	const char *value = netif_filter_value(self, netif, buf, sizeof(buf));
+
+	if (self->invalid || !value)
+		return false;
+	if (self->needle)
+		return strstr(value, self->needle) != NULL;
+	if (self->glob)
+		return g_pattern_spec_match_string(self->glob, value);
+	if (self->regex)
+		return g_regex_match(self->regex, value, 0, NULL);
+
+	return true;
+}
+
+static bool netif_filter_match_link(NetifFilter *self, struct netif_link *netif)
+{
+	if (netif->match_serial == self->serial)
+		return netif->match;
+
+	netif->match = netif_filter_eval(self, netif);
+	netif->match_serial = self->serial;
+
+	return netif->match;
+}
+
+/* An aggregate row stays visible while it or any member matches */
+static bool netif_filter_match_group(NetifFilter *self, struct netif_link *group)
+{
+	struct netif_link *netif;
+
+	if (netif_filter_eval(self, group))
+		return true;
+
+	for (guint i = 0; (netif = netif_link_model_get_link(group->children, i)); i++)
+		if (netif_filter_match_link(self, netif))
+			return true;
+
+	return false;
+}
+
+static gboolean netif_filter_match(GtkFilter *filter, gpointer item)
+{
+	NetifFilter *self = NETIF_FILTER(filter);
+	g_autoptr(GObject) object = NULL;
+	struct netif_link *netif;
+
+	if (!netif_filter_is_active(self))
+		return TRUE;
+
+	if (GTK_IS_TREE_LIST_ROW(item)) {
+		object = gtk_tree_list_row_get_item(GTK_TREE_LIST_ROW(item));
+		item = object;
+	}
+
+	/* a row whose interface just went away */
+	netif = NETIF_LINK_STATS(item)->link;
+	if (!netif)
+		return FALSE;
+
+	if (netif->children)
+		return netif_filter_match_group(self, netif);
+
+	/* qdisc rows go with their interface */
+	if (netif->dev)
+		netif = netif->dev;
+
+	return netif_filter_match_link(self, netif);
+}
+
+static GtkFilterMatch netif_filter_get_strictness(GtkFilter *filter)
+{
+	NetifFilter *self = NETIF_FILTER(filter);
+
+	return netif_filter_is_active(self) ? GTK_FILTER_MATCH_SOME : GTK_FILTER_MATCH_ALL;
+}
+
+static void netif_filter_clear(NetifFilter *self)
+{
+	g_clear_pointer(&self->needle, g_free);
+	g_clear_pointer(&self->glob, g_pattern_spec_free);
+	g_clear_pointer(&self->regex, g_regex_unref);
+	self->invalid = false;
+}
+
+static void netif_filter_finalize(GObject *object)
+{
+	NetifFilter *self = NETIF_FILTER(object);
+
+	netif_filter_clear(self);
+	g_free(self->text);
+
+	G_OBJECT_CLASS(netif_filter_parent_class)->finalize(object);
+}
+
+static void netif_filter_class_init(NetifFilterClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(class);
+	GtkFilterClass *filter_class = GTK_FILTER_CLASS(class);
+
+	object_class->finalize = netif_filter_finalize;
+
+	filter_class->match = netif_filter_match;
+	filter_class->get_strictness = netif_filter_get_strictness;
+}
+
+static void netif_filter_init(NetifFilter *self)
+{
+	self->serial = 1;
+}
+
+NetifFilter *netif_filter_new(void)
+{
+	return g_object_new(NETIF_TYPE_FILTER, NULL);
+}
+
+const char *netif_filter_get_text(NetifFilter *self)
+{
+	return self->text;
+}
+
+gboolean netif_filter_is_active(NetifFilter *self)
+{
+	return self->text != NULL;
+}
+
+/*
+ * Substring patterns on the same field can tell GtkFilterListModel to
+ * only recheck current matches (narrowing) or current misses (widening).
+ */
+static GtkFilterChange netif_filter_change(const char *old_needle,
+		enum netif_filter_field old_field, NetifFilter *self)
+{
+	if (!old_needle || !self->needle || old_field != self->field)
+		return GTK_FILTER_CHANGE_DIFFERENT;
+	if (strstr(self->needle, old_needle))
+		return GTK_FILTER_CHANGE_MORE_STRICT;
+	if (strstr(old_needle, self->needle))
+		return GTK_FILTER_CHANGE_LESS_STRICT;
+
+	return GTK_FILTER_CHANGE_DIFFERENT;
+}
+
+void netif_filter_set_text(NetifFilter *self, const char *text)
+{
+	static const struct {
+		const char *prefix;
+		enum netif_filter_field field;
+	} fields[] = {
+		{ "name:", NETIF_FILTER_NAME },
+		{ "state:", NETIF_FILTER_STATE },
+		{ "netns:", NETIF_FILTER_NETNS },
+		{ "host:", NETIF_FILTER_HOST },
+	};
+	g_autofree char *old_needle = g_steal_pointer(&self->needle);
+	enum netif_filter_field old_field = self->field;
+	bool was_active = netif_filter_is_active(self);
+	GtkFilterChange change;
+	const char *pattern;
+
+	if (text && !*text)
+		text = NULL;
+
+	if (g_strcmp0(text, self->text) == 0) {
+		self->needle = g_steal_pointer(&old_needle);
+		return;
+	}
+
+	netif_filter_clear(self);
+	g_free(self->text);
+	self->text = g_strdup(text);
+	self->field = NETIF_FILTER_NAME;
+
+	if (!text) {
+		change = GTK_FILTER_CHANGE_LESS_STRICT;
+		goto out;
+	}
+
+	pattern = text;
+	for (guint i = 0; i < G_N_ELEMENTS(fields); i++) {
+		if (g_str_has_prefix(text, fields[i].prefix)) {
+			self->field = fields[i].field;
+			pattern = text + strlen(fields[i].prefix);
+			break;
+		}
+	}
+
+	/* all three kinds are case-sensitive, as interface names are */
+	if (pattern[0] == '/') {
+		self->regex = g_regex_new(pattern + 1, G_REGEX_OPTIMIZE, 0, NULL);
+		self->invalid = self->regex == NULL;
+	} else if (strpbrk(pattern, "*?")) {
+		self->glob = g_pattern_spec_new(pattern);
+	} else {
+		self->needle = g_strdup(pattern);
+	}
+
+	if (!was_active)
+		change = GTK_FILTER_CHANGE_MORE_STRICT;
+	else
+		change = netif_filter_change(old_needle, old_field, self);
+
+out:
+	if (++self->serial == 0)
+		self->serial = 1;
+
+	gtk_filter_changed(GTK_FILTER(self), change);
+}
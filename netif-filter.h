@@ -0,0 +1,29 @@
+#pragma once
+
+#include <adwaita.h>
+
+#include "netif-link-stats.h"
+
+G_BEGIN_DECLS
+
+#define NETIF_TYPE_FILTER	(netif_filter_get_type())
+
+G_DECLARE_FINAL_TYPE(NetifFilter, netif_filter, NETIF, FILTER, GtkFilter)
+
+/*
+ * Filter text is "[name:|state:|netns:|host:]PATTERN". A PATTERN starting with
+ * '/' is a regex, one containing '*' or '?' a glob, anything else a
+ * substring.
+ */
+NetifFilter *netif_filter_new(void);
+void netif_filter_set_text(NetifFilter *self, const char *text);
+const char *netif_filter_get_text(NetifFilter *self);
+gboolean netif_filter_is_active(NetifFilter *self);
+
+/* Forget the cached result after a rename or state change */
+static inline void netif_filter_invalidate(struct netif_link *netif)
+{
+	netif->match_serial = 0;
+}
+
+G_END_DECLS
@@ -0,0 +1,260 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <adwaita.h>
+
+#include <math.h>
+
+#include "netif-heatmap.h"
+#include "netif-histogram.h"
+#include "netif-link-table.h"
+
+/* bit length of the rate, 0 to NETIF_HIST_MAX_BITS */
+#define HEATMAP_BINS	(NETIF_HIST_MAX_BITS + 1)
+
+#define CELL_WIDTH	10
+#define ROW_HEIGHT	18
+#define NAME_WIDTH	110
+#define AXIS_HEIGHT	20
+
+struct _NetifHeatmap {
+	GtkWidget base;
+
+	GHashTable *netif_ht;
+	struct netif_link_table *table;
+	gboolean tx;
+
+	/* struct netif_link sorted by name, valid while serial is the table's */
+	GPtrArray *rows;
+	guint serial;
+
+	guint timeout_id;
+	GtkAdjustment *vadjustment;
+};
+
+G_DEFINE_FINAL_TYPE(NetifHeatmap, netif_heatmap, GTK_TYPE_WIDGET)
+
+static int heatmap_row_cmp(gconstpointer a, gconstpointer b)
+{
+	const struct netif_link *x = *(struct netif_link **)a;
+	const struct netif_link *y = *(struct netif_link **)b;
+
+	return g_strcmp0(x->ifname, y->ifname);
+}
+
+/* Links are freed only after the serial moved, so cached rows stay valid */
+static GPtrArray *netif_heatmap_rows(NetifHeatmap *self)
+{
+	GHashTableIter iter;
+	struct netif_link *netif;
+
+	if (self->serial == self->table->serial)
+		return self->rows;
+
+	g_ptr_array_set_size(self->rows, 0);
+	g_hash_table_iter_init(&iter, self->netif_ht);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&netif))
+		if (netif->hist)
+			g_ptr_array_add(self->rows, netif);
+
+	g_ptr_array_sort(self->rows, heatmap_row_cmp);
+	self->serial = self->table->serial;
+
+	return self->rows;
+}
+
+/* Rows [*first, *last) show through the scrolled window, all without one */
+static void netif_heatmap_visible(NetifHeatmap *self, guint n, guint *first, guint *last)
+{
+	GtkWidget *scrolled = gtk_widget_get_ancestor(GTK_WIDGET(self),
+			GTK_TYPE_SCROLLED_WINDOW);
+	graphene_point_t top;
+	float height;
+
+	*first = 0;
+	*last = n;
+
+	if (!scrolled || !gtk_widget_compute_point(scrolled, GTK_WIDGET(self),
+				&GRAPHENE_POINT_INIT(0, 0), &top))
+		return;
+
+	height = gtk_widget_get_height(scrolled);
+	*first = MIN(n, (guint)MAX(top.y / ROW_HEIGHT, 0));
+	*last = MIN(n, (guint)MAX(ceilf((top.y + height) / ROW_HEIGHT), 0));
+}
+
+static void netif_heatmap_text(NetifHeatmap *self, GtkSnapshot *snapshot,
+		const char *text, float x, float y)
+{
+	PangoLayout *layout = gtk_widget_create_pango_layout(GTK_WIDGET(self), text);
+	GdkRGBA color;
+
+	gtk_widget_get_color(GTK_WIDGET(self), &color);
+
+	gtk_snapshot_save(snapshot);
+	gtk_snapshot_translate(snapshot, &GRAPHENE_POINT_INIT(x, y));
+	gtk_snapshot_append_layout(snapshot, layout, &color);
+	gtk_snapshot_restore(snapshot);
+
+	g_object_unref(layout);
+}
+
+static void netif_heatmap_snapshot(GtkWidget *widget, GtkSnapshot *snapshot)
+{
+	NetifHeatmap *self = NETIF_HEATMAP(widget);
+	GPtrArray *rows = netif_heatmap_rows(self);
+	static const char *const units[] = { "1K", "1M", "1G", "1T" };
+	guint first, last;
+
+	netif_heatmap_visible(self, rows->len, &first, &last);
+
+	for (guint r = first; r < last; r++) {
+		struct netif_link *netif = rows->pdata[r];
+		const struct netif_hist *hist = &netif->hist[self->tx];
+		guint64 bins[HEATMAP_BINS] = { 0 };
+		guint64 max = 0;
+		float y = r * ROW_HEIGHT;
+
+		for (guint i = 0; i < NETIF_HIST_BUCKETS; i++) {
+			guint64 lower = netif_hist_lower(i);
+			guint bin = lower ? 64 - __builtin_clzll(lower) : 0;
+
+			bins[bin] += netif_hist_bucket(hist, i);
+		}
+		for (guint b = 0; b < HEATMAP_BINS; b++)
+			max = MAX(max, bins[b]);
+
+		netif_heatmap_text(self, snapshot, netif->ifname, 0, y);
+
+		for (guint b = 0; max && b < HEATMAP_BINS; b++) {
+			/* log scale so rare rates stay visible next to the common one */
+			GdkRGBA color = { 0.21, 0.52, 0.89, log1p(bins[b]) / log1p(max) };
+
+			if (!bins[b])
+				continue;
+
+			gtk_snapshot_append_color(snapshot, &color,
+					&GRAPHENE_RECT_INIT(NAME_WIDTH + b * CELL_WIDTH, y + 1,
+						CELL_WIDTH - 1, ROW_HEIGHT - 2));
+		}
+	}
+
+	/* 2^10 has bit length 11 */
+	for (guint u = 0; u < G_N_ELEMENTS(units); u++)
+		netif_heatmap_text(self, snapshot, units[u],
+				NAME_WIDTH + (11 + 10 * u) * CELL_WIDTH, rows->len * ROW_HEIGHT);
+}
+
+static void netif_heatmap_measure(GtkWidget *widget, GtkOrientation orientation,
+		int for_size, int *minimum, int *natural,
+		int *minimum_baseline, int *natural_baseline)
+{
+	NetifHeatmap *self = NETIF_HEATMAP(widget);
+
+	if (orientation == GTK_ORIENTATION_HORIZONTAL) {
+		*minimum = *natural = NAME_WIDTH + HEATMAP_BINS * CELL_WIDTH;
+	} else {
+		GPtrArray *rows = netif_heatmap_rows(self);
+
+		*minimum = *natural = rows->len * ROW_HEIGHT + AXIS_HEIGHT;
+	}
+}
+
+static gboolean netif_heatmap_timeout(gpointer data)
+{
+	NetifHeatmap *self = data;
+
+	/* rows come and go, so the height may change too */
+	if (self->serial != self->table->serial)
+		gtk_widget_queue_resize(GTK_WIDGET(self));
+	else
+		gtk_widget_queue_draw(GTK_WIDGET(self));
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void netif_heatmap_map(GtkWidget *widget)
+{
+	NetifHeatmap *self = NETIF_HEATMAP(widget);
+	GtkWidget *scrolled = gtk_widget_get_ancestor(widget, GTK_TYPE_SCROLLED_WINDOW);
+
+	GTK_WIDGET_CLASS(netif_heatmap_parent_class)->map(widget);
+
+	self->timeout_id = g_timeout_add_seconds(1, netif_heatmap_timeout, self);
+
+	/* scrolling reuses the last render node, draw the rows coming into view */
+	if (scrolled) {
+		self->vadjustment = g_object_ref(gtk_scrolled_window_get_vadjustment(
+				GTK_SCROLLED_WINDOW(scrolled)));
+		g_signal_connect_swapped(self->vadjustment, "value-changed",
+				G_CALLBACK(gtk_widget_queue_draw), self);
+	}
+}
+
+static void netif_heatmap_unmap(GtkWidget *widget)
+{
+	NetifHeatmap *self = NETIF_HEATMAP(widget);
+
+	g_clear_handle_id(&self->timeout_id, g_source_remove);
+
+	if (self->vadjustment) {
+		g_signal_handlers_disconnect_by_data(self->vadjustment, self);
+		g_clear_object(&self->vadjustment);
+	}
+
+	GTK_WIDGET_CLASS(netif_heatmap_parent_class)->unmap(widget);
+}
+
+static void netif_heatmap_finalize(GObject *object)
+{
+	NetifHeatmap *self = NETIF_HEATMAP(object);
+
+	g_hash_table_unref(self->netif_ht);
+	g_ptr_array_unref(self->rows);
+
+	G_OBJECT_CLASS(netif_heatmap_parent_class)->finalize(object);
+}
+
+static void netif_heatmap_class_init(NetifHeatmapClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(class);
+	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(class);
+
+	object_class->finalize = netif_heatmap_finalize;
+
+	widget_class->snapshot = netif_heatmap_snapshot;
+	widget_class->measure = netif_heatmap_measure;
+	widget_class->map = netif_heatmap_map;
+	widget_class->unmap = netif_heatmap_unmap;
+}
+
+static void netif_heatmap_init(NetifHeatmap *self)
+{
+	self->rows = g_ptr_array_new();
+}
+
+GtkWidget *netif_heatmap_new(GHashTable *netif_ht, struct netif_link_table *table,
+		gboolean tx)
+{
+	NetifHeatmap *self = g_object_new(NETIF_TYPE_HEATMAP, NULL);
+
+	self->netif_ht = g_hash_table_ref(netif_ht);
+	self->table = table;
+	/* serial 0 is a valid table serial, sort on first use regardless */
+	self->serial = table->serial - 1;
+	self->tx = !!tx;
+
+	return GTK_WIDGET(self);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <adwaita.h>
+
+G_BEGIN_DECLS
+
+struct netif_link_table;
+
+#define NETIF_TYPE_HEATMAP	(netif_heatmap_get_type())
+
+G_DECLARE_FINAL_TYPE(NetifHeatmap, netif_heatmap, NETIF, HEATMAP, GtkWidget)
+
+/*
+ * One row per struct netif_link of @netif_ht with a histogram, one column per
+ * power of two of the rx (or @tx) rate, shaded by the share of seconds
+ * spent there. Redrawn every second while mapped, the rows are sorted
+ * again only when the serial of @table moves.
+ */
+GtkWidget *netif_heatmap_new(GHashTable *netif_ht, struct netif_link_table *table,
+		gboolean tx);
+
+G_END_DECLS
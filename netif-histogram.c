@@ -0,0 +1,89 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "netif-histogram.h"
+
+guint32 *netif_hist_page(struct netif_hist *hist, guint index)
+{
+	guint32 **page;
+
+	if (!hist->page)
+		hist->page = g_new0(guint32 *, NETIF_HIST_PAGES);
+
+	page = &hist->page[index / NETIF_HIST_SUB];
+	if (!*page)
+		*page = g_new0(guint32, NETIF_HIST_SUB);
+
+	return *page;
+}
+
+void netif_hist_clear(struct netif_hist *hist)
+{
+	for (guint i = 0; hist->page && i < NETIF_HIST_PAGES; i++)
+		g_free(hist->page[i]);
+	g_free(hist->page);
+	memset(hist, 0, sizeof(*hist));
+}
+
+guint64 netif_hist_lower(guint index)
+{
+	guint e;
+
+	if (index < NETIF_HIST_SUB)
+		return index;
+
+	e = index / NETIF_HIST_SUB + NETIF_HIST_SUB_BITS - 1;
+
+	return (guint64)(NETIF_HIST_SUB + index % NETIF_HIST_SUB) << (e - NETIF_HIST_SUB_BITS);
+}
+
+guint64 netif_hist_percentile(const struct netif_hist *hist, double percentile)
+{
+	guint64 rank = (guint64)(hist->count * CLAMP(percentile, 0, 100) / 100.0);
+	guint64 seen = 0;
+
+	if (!hist->count)
+		return 0;
+
+	for (guint i = 0; i < NETIF_HIST_BUCKETS; i++) {
+		seen += netif_hist_bucket(hist, i);
+		if (seen > rank)
+			return i + 1 < NETIF_HIST_BUCKETS ?
+				MIN(netif_hist_lower(i + 1) - 1, hist->max) : hist->max;
+	}
+
+	return hist->max;
+}
+
+void netif_hist_write_csv(const struct netif_hist *hist, const char *ifname,
+		const char *dir, FILE *out)
+{
+	for (guint i = 0; i < NETIF_HIST_BUCKETS; i++) {
+		guint32 count = netif_hist_bucket(hist, i);
+		guint64 upper;
+
+		if (!count)
+			continue;
+
+		upper = i + 1 < NETIF_HIST_BUCKETS ? netif_hist_lower(i + 1) - 1 : G_MAXUINT64;
+		fprintf(out, "%s,%s,%"PRIu64",%"PRIu64",%"PRIu32"\n",
+				ifname, dir, netif_hist_lower(i), upper, count);
+	}
+}
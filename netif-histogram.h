@@ -0,0 +1,100 @@
+#pragma once
+
+#include <glib.h>
+#include <stdio.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Log-linear histogram of byte rates: values below 2^SUB_BITS get a bucket
+ * each, every power of two above is split into 2^SUB_BITS linear buckets,
+ * so a bucket is within 1/16 of its values. Rates at or above 2^MAX_BITS
+ * (256 TiB/s) land in the last bucket.
+ *
+ * Buckets are allocated a page of NETIF_HIST_SUB at a time, on the first
+ * sample that lands in one. Most interfaces of a large host are idle and
+ * only ever count zeros, which have a field of their own.
+ */
+#define NETIF_HIST_SUB_BITS	4
+#define NETIF_HIST_SUB		(1u << NETIF_HIST_SUB_BITS)
+#define NETIF_HIST_MAX_BITS	48
+#define NETIF_HIST_PAGES	(NETIF_HIST_MAX_BITS - NETIF_HIST_SUB_BITS + 1)
+#define NETIF_HIST_BUCKETS	(NETIF_HIST_SUB * NETIF_HIST_PAGES)
+
+struct netif_hist {
+	guint64 count;
+	guint64 max;
+	/* bucket 0 */
+	guint32 zero;
+	/* NETIF_HIST_PAGES pointers, NULL until a non-zero sample */
+	guint32 **page;
+};
+
+static inline guint netif_hist_index(guint64 value)
+{
+	guint e;
+
+	if (value < NETIF_HIST_SUB)
+		return value;
+
+	e = 63 - __builtin_clzll(value);
+	if (e >= NETIF_HIST_MAX_BITS)
+		return NETIF_HIST_BUCKETS - 1;
+
+	return NETIF_HIST_SUB * (e - NETIF_HIST_SUB_BITS + 1) +
+		((value >> (e - NETIF_HIST_SUB_BITS)) & (NETIF_HIST_SUB - 1));
+}
+
+/* Allocate the page of bucket @index, and the page table if needed */
+guint32 *netif_hist_page(struct netif_hist *hist, guint index);
+
+/* Count @value @n times, once per second it held for */
+static inline void netif_hist_record_n(struct netif_hist *hist, guint64 value, guint n)
+{
+	guint index = netif_hist_index(value);
+	guint32 *bucket = &hist->zero;
+
+	if (index) {
+		guint32 *page = hist->page ? hist->page[index / NETIF_HIST_SUB] : NULL;
+
+		if (G_UNLIKELY(!page))
+			page = netif_hist_page(hist, index);
+		bucket = &page[index % NETIF_HIST_SUB];
+	}
+
+	*bucket = MIN((guint64)*bucket + n, G_MAXUINT32);
+	hist->count += n;
+	hist->max = MAX(hist->max, value);
+}
+
+static inline void netif_hist_record(struct netif_hist *hist, guint64 value)
+{
+	netif_hist_record_n(hist, value, 1);
+}
+
+/* Samples counted in bucket @index */
+static inline guint32 netif_hist_bucket(const struct netif_hist *hist, guint index)
+{
+	const guint32 *page;
+
+	if (!index)
+		return hist->zero;
+
+	page = hist->page ? hist->page[index / NETIF_HIST_SUB] : NULL;
+	return page ? page[index % NETIF_HIST_SUB] : 0;
+}
+
+/* Free the buckets, the histogram is empty afterwards */
+void netif_hist_clear(struct netif_hist *hist);
+
+/* Lowest value counted in bucket @index */
+guint64 netif_hist_lower(guint index);
+
+/* Value below which @percentile (0-100) of the samples fall */
+guint64 netif_hist_percentile(const struct netif_hist *hist, double percentile);
+
+/* One "ifname,dir,lower,upper,count" CSV line per non-empty bucket */
+void netif_hist_write_csv(const struct netif_hist *hist, const char *ifname,
+		const char *dir, FILE *out);
+
+G_END_DECLS
@@ -0,0 +1,213 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "netif-history.h"
+
+#define NETIF_HISTORY_MAGIC	"NIFHIST1"
+
+static const struct {
+	guint step;
+	guint slots;
+	guint offset;
+} netif_history_tiers[NETIF_HISTORY_TIERS] = {
+	[NETIF_HISTORY_SECONDS] = { 1, 600, 0 },
+	[NETIF_HISTORY_MINUTES] = { 60, 1440, 600 },
+	[NETIF_HISTORY_HOURS] = { 3600, 720, 600 + 1440 },
+};
+
+#define NETIF_HISTORY_NR_SLOTS	(600 + 1440 + 720)
+
+/*
+ * The on-disk layout, slots of a tier form a ring indexed by time so
+ * nothing but the slots themselves needs to be kept consistent.
+ */
+struct netif_history_map {
+	char magic[8];
+	guint32 size;
+	guint32 reserved;
+	struct netif_history_slot slots[NETIF_HISTORY_NR_SLOTS];
+};
+
+struct netif_history {
+	struct netif_history_map *map;
+};
+
+static struct netif_history_map *netif_history_map_file(const char *dir, const char *ifname,
+		bool *fresh)
+{
+	g_autofree char *name = g_strconcat(ifname, ".history", NULL);
+	g_autofree char *path = g_build_filename(dir, name, NULL);
+	struct netif_history_map *map;
+	struct stat st;
+	int fd;
+
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		g_warning("%s: %s", path, g_strerror(errno));
+		return NULL;
+	}
+
+	/* a file of another size or layout is started over, sparse and zeroed */
+	*fresh = fstat(fd, &st) < 0 || st.st_size != sizeof(*map);
+	if (*fresh) {
+		if (ftruncate(fd, 0) < 0 || ftruncate(fd, sizeof(*map)) < 0) {
+			g_warning("%s: %s", path, g_strerror(errno));
+			close(fd);
+			return NULL;
+		}
+	}
+
+	map = mmap(NULL, sizeof(*map), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		g_warning("mmap %s: %s", path, g_strerror(errno));
+		return NULL;
+	}
+
+	/* slots are touched a few at a time, readahead would fault in whole rings */
+	madvise(map, sizeof(*map), MADV_RANDOM);
+
+	return map;
+}
+
+struct netif_history *netif_history_open(const char *dir, const char *ifname)
+{
+	struct netif_history_map *map;
+	struct netif_history *history;
+	bool fresh;
+
+	map = netif_history_map_file(dir, ifname, &fresh);
+	if (!map)
+		return NULL;
+
+	/* only pages written to become resident, leave the zeroed ones be */
+	if (fresh || memcmp(map->magic, NETIF_HISTORY_MAGIC, sizeof(map->magic)) != 0 ||
+	    map->size != sizeof(*map)) {
+		if (!fresh)
+			memset(map, 0, sizeof(*map));
+		memcpy(map->magic, NETIF_HISTORY_MAGIC, sizeof(map->magic));
+		map->size = sizeof(*map);
+	}
+
+	history = g_new0(struct netif_history, 1);
+	history->map = map;
+
+	return history;
+}
+
+void netif_history_close(struct netif_history *history)
+{
+	munmap(history->map, sizeof(*history->map));
+	g_free(history);
+}
+
+void netif_history_prune(const char *dir)
+{
+	gint64 span = (gint64)netif_history_tiers[NETIF_HISTORY_HOURS].step *
+		netif_history_tiers[NETIF_HISTORY_HOURS].slots;
+	gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+	g_autoptr(GDir) gdir = g_dir_open(dir, 0, NULL);
+	const char *name;
+
+	if (!gdir)
+		return;
+
+	/* writes through the mapping update the mtime like write() does */
+	while ((name = g_dir_read_name(gdir))) {
+		g_autofree char *path = NULL;
+		struct stat st;
+
+		if (!g_str_has_suffix(name, ".history"))
+			continue;
+
+		path = g_build_filename(dir, name, NULL);
+		if (stat(path, &st) == 0 && S_ISREG(st.st_mode) && now - st.st_mtime > span &&
+		    unlink(path) < 0)
+			g_warning("%s: %s", path, g_strerror(errno));
+	}
+}
+
+guint netif_history_step(enum netif_history_tier tier)
+{
+	return netif_history_tiers[tier].step;
+}
+
+static struct netif_history_slot *netif_history_slot(struct netif_history *history,
+		enum netif_history_tier tier, gint64 start)
+{
+	guint step = netif_history_tiers[tier].step;
+	guint slots = netif_history_tiers[tier].slots;
+
+	return &history->map->slots[netif_history_tiers[tier].offset + (start / step) % slots];
+}
+
+void netif_history_update(struct netif_history *history, gint64 time,
+		const guint64 rates[NETIF_HISTORY_COUNTERS])
+{
+	for (int tier = 0; tier < NETIF_HISTORY_TIERS; tier++) {
+		gint64 start = time - time % netif_history_tiers[tier].step;
+		struct netif_history_slot *slot = netif_history_slot(history, tier, start);
+
+		/* the ring came round, or the clock went back */
+		if (slot->time != start) {
+			slot->time = start;
+			slot->count = 0;
+		}
+
+		for (int c = 0; c < NETIF_HISTORY_COUNTERS; c++) {
+			if (!slot->count) {
+				slot->min[c] = slot->max[c] = slot->sum[c] = rates[c];
+				continue;
+			}
+
+			slot->min[c] = MIN(slot->min[c], rates[c]);
+			slot->max[c] = MAX(slot->max[c], rates[c]);
+			slot->sum[c] += rates[c];
+		}
+		slot->count++;
+	}
+}
+
+const struct netif_history_slot *netif_history_lookup(struct netif_history *history,
+		enum netif_history_tier tier, gint64 time)
+{
+	gint64 start = time - time % netif_history_tiers[tier].step;
+	const struct netif_history_slot *slot = netif_history_slot(history, tier, start);
+
+	return slot->time == start && slot->count ? slot : NULL;
+}
+
+enum netif_history_tier netif_history_tier_for(gint64 span, guint max_points)
+{
+	for (int tier = 0; tier < NETIF_HISTORY_TIERS - 1; tier++) {
+		gint64 step = netif_history_tiers[tier].step;
+
+		if (span <= step * netif_history_tiers[tier].slots &&
+		    span <= step * max_points)
+			return tier;
+	}
+
+	return NETIF_HISTORY_HOURS;
+}
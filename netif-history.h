@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+enum netif_history_counter {
+	NETIF_HISTORY_RX_BYTES,
+	NETIF_HISTORY_TX_BYTES,
+	NETIF_HISTORY_RX_PACKETS,
+	NETIF_HISTORY_TX_PACKETS,
+	NETIF_HISTORY_COUNTERS,
+};
+
+/* 1 s for 10 minutes, 1 min for a day, 1 h for 30 days */
+enum netif_history_tier {
+	NETIF_HISTORY_SECONDS,
+	NETIF_HISTORY_MINUTES,
+	NETIF_HISTORY_HOURS,
+	NETIF_HISTORY_TIERS,
+};
+
+/* Per-second rates over one period of a tier */
+struct netif_history_slot {
+	gint64 time;		/* unix time the period starts, 0 if unused */
+	guint32 count;
+	guint32 reserved;
+	guint64 min[NETIF_HISTORY_COUNTERS];
+	guint64 max[NETIF_HISTORY_COUNTERS];
+	guint64 sum[NETIF_HISTORY_COUNTERS];
+};
+
+struct netif_history;
+
+/*
+ * Map the history of @ifname from @dir, creating it if needed. Files are
+ * keyed by name, so an interface that reuses a name continues its history.
+ */
+struct netif_history *netif_history_open(const char *dir, const char *ifname);
+void netif_history_close(struct netif_history *history);
+
+/* Delete the files of @dir not written for longer than the hourly tier spans */
+void netif_history_prune(const char *dir);
+
+/* Fold one sample of per-second @rates taken at unix time @time into every tier */
+void netif_history_update(struct netif_history *history, gint64 time,
+		const guint64 rates[NETIF_HISTORY_COUNTERS]);
+
+/* Seconds one slot of @tier covers */
+guint netif_history_step(enum netif_history_tier tier);
+
+/* The slot of @tier covering @time, NULL if nothing was recorded then */
+const struct netif_history_slot *netif_history_lookup(struct netif_history *history,
+		enum netif_history_tier tier, gint64 time);
+
+/* Finest tier that still covers @span seconds in at most @max_points slots */
+enum netif_history_tier netif_history_tier_for(gint64 span, guint max_points);
+
+G_END_DECLS
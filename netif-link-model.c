@@ -0,0 +1,187 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+
+#include "netif-link-model.h"
+#include "netif-link-stats.h"
+
+struct _NetifLinkModel {
+	GObject base;
+
+	GPtrArray *links;
+
+	/* while frozen, links past the first reported ones are pending appends */
+	guint frozen;
+	guint reported;
+};
+
+static void netif_link_model_list_model_init(GListModelInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE(NetifLinkModel, netif_link_model, G_TYPE_OBJECT,
+		G_IMPLEMENT_INTERFACE(G_TYPE_LIST_MODEL, netif_link_model_list_model_init))
+
+static GType netif_link_model_get_item_type(GListModel *list)
+{
+	return NETIF_TYPE_LINK_STATS;
+}
+
+static guint netif_link_model_get_n_items(GListModel *list)
+{
+	return NETIF_LINK_MODEL(list)->links->len;
+}
+
+static gpointer netif_link_model_get_item(GListModel *list, guint position)
+{
+	NetifLinkModel *self = NETIF_LINK_MODEL(list);
+
+	if (position >= self->links->len)
+		return NULL;
+
+	return netif_link_stats_get(g_ptr_array_index(self->links, position));
+}
+
+static void netif_link_model_list_model_init(GListModelInterface *iface)
+{
+	iface->get_item_type = netif_link_model_get_item_type;
+	iface->get_n_items = netif_link_model_get_n_items;
+	iface->get_item = netif_link_model_get_item;
+}
+
+/* Report the pending appends, so that views agree on the length again */
+static void netif_link_model_flush(NetifLinkModel *self)
+{
+	guint reported = self->reported;
+
+	if (self->links->len == reported)
+		return;
+
+	self->reported = self->links->len;
+	g_list_model_items_changed(G_LIST_MODEL(self), reported, 0,
+			self->links->len - reported);
+}
+
+/*
+ * Called before the change at @position is made. Changes to pending
+ * appends are folded into them, others flush them and go out as is.
+ */
+static bool netif_link_model_pass(NetifLinkModel *self, guint position)
+{
+	if (!self->frozen)
+		return true;
+	if (position >= self->reported)
+		return false;
+
+	netif_link_model_flush(self);
+
+	return true;
+}
+
+void netif_link_model_freeze(NetifLinkModel *self)
+{
+	if (self->frozen++)
+		return;
+
+	self->reported = self->links->len;
+}
+
+void netif_link_model_thaw(NetifLinkModel *self)
+{
+	g_return_if_fail(self->frozen > 0);
+
+	if (--self->frozen)
+		return;
+
+	netif_link_model_flush(self);
+}
+
+struct netif_link *netif_link_model_get_link(NetifLinkModel *self, guint position)
+{
+	if (position >= self->links->len)
+		return NULL;
+
+	return g_ptr_array_index(self->links, position);
+}
+
+void netif_link_model_append(NetifLinkModel *self, struct netif_link *link)
+{
+	bool pass = netif_link_model_pass(self, self->links->len);
+
+	g_ptr_array_add(self->links, link);
+	if (pass)
+		g_list_model_items_changed(G_LIST_MODEL(self), self->links->len - 1, 0, 1);
+}
+
+void netif_link_model_remove(NetifLinkModel *self, struct netif_link *link)
+{
+	guint pos;
+	bool pass;
+
+	if (!g_ptr_array_find(self->links, link, &pos))
+		return;
+
+	pass = netif_link_model_pass(self, pos);
+	g_ptr_array_remove_index(self->links, pos);
+	if (!pass)
+		return;
+
+	if (self->frozen)
+		self->reported--;
+	g_list_model_items_changed(G_LIST_MODEL(self), pos, 1, 0);
+}
+
+void netif_link_model_refresh(NetifLinkModel *self, struct netif_link *link)
+{
+	guint pos;
+
+	if (g_ptr_array_find(self->links, link, &pos) && netif_link_model_pass(self, pos))
+		g_list_model_items_changed(G_LIST_MODEL(self), pos, 1, 1);
+}
+
+gboolean netif_link_model_is_watched(NetifLinkModel *self)
+{
+	static guint items_changed;
+
+	if (!items_changed)
+		items_changed = g_signal_lookup("items-changed", G_TYPE_LIST_MODEL);
+
+	return g_signal_has_handler_pending(self, items_changed, 0, TRUE);
+}
+
+static void netif_link_model_finalize(GObject *object)
+{
+	NetifLinkModel *self = NETIF_LINK_MODEL(object);
+
+	g_ptr_array_unref(self->links);
+
+	G_OBJECT_CLASS(netif_link_model_parent_class)->finalize(object);
+}
+
+static void netif_link_model_class_init(NetifLinkModelClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(class);
+
+	object_class->finalize = netif_link_model_finalize;
+}
+
+static void netif_link_model_init(NetifLinkModel *self)
+{
+	self->links = g_ptr_array_new();
+}
+
+NetifLinkModel *netif_link_model_new(void)
+{
+	return g_object_new(NETIF_TYPE_LINK_MODEL, NULL);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <gio/gio.h>
+
+#include "netif-link-table.h"
+
+G_BEGIN_DECLS
+
+#define NETIF_TYPE_LINK_MODEL	(netif_link_model_get_type())
+
+G_DECLARE_FINAL_TYPE(NetifLinkModel, netif_link_model, NETIF, LINK_MODEL, GObject)
+
+/*
+ * List of table rows that hands out NetifLinkStats only for the positions
+ * asked for. It does not own the links, remove them before freeing.
+ */
+NetifLinkModel *netif_link_model_new(void);
+
+struct netif_link *netif_link_model_get_link(NetifLinkModel *self, guint position);
+void netif_link_model_append(NetifLinkModel *self, struct netif_link *link);
+void netif_link_model_remove(NetifLinkModel *self, struct netif_link *link);
+
+/* Report @link as replaced in place, so views and filters re-read it */
+void netif_link_model_refresh(NetifLinkModel *self, struct netif_link *link);
+
+/* Whether a view is listening, such as a GtkTreeListModel with the row expanded */
+gboolean netif_link_model_is_watched(NetifLinkModel *self);
+
+/*
+ * Between freeze() and the matching thaw() appends are applied at once
+ * but reported as a single items-changed at the tail. Removals and
+ * refreshes are still reported as they happen, after the appends so far.
+ * Nested calls are counted.
+ */
+void netif_link_model_freeze(NetifLinkModel *self);
+void netif_link_model_thaw(NetifLinkModel *self);
+
+G_END_DECLS
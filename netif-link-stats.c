@@ -0,0 +1,236 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+
+#include "netif-link-stats.h"
+
+G_DEFINE_FINAL_TYPE(NetifLinkStats, netif_link_stats, G_TYPE_OBJECT)
+
+enum {
+	PROP_0,
+	PROP_IFINDEX,
+	PROP_IFNAME,
+	PROP_HOST,
+	PROP_RX_PACKETS,
+	PROP_TX_PACKETS,
+	PROP_RX_BYTES,
+	PROP_TX_BYTES,
+	PROP_RX_RATE,
+	PROP_TX_RATE,
+	PROP_CPU_RX_RATE,
+	PROP_CPU_TX_RATE,
+	PROP_UTILIZATION,
+	PROP_STATE,
+	PROP_STATE_SINCE,
+	PROP_FLAPS,
+	N_PROPS,
+};
+
+static GParamSpec *props[N_PROPS];
+
+static void netif_link_stats_get_property(GObject *object,
+		guint prop_id, GValue *value, GParamSpec *spec)
+{
+	NetifLinkStats *self = NETIF_LINK_STATS(object);
+	struct netif_link *link = self->link;
+
+	if (!link)
+		return;
+
+	switch (prop_id) {
+	case PROP_RX_BYTES:
+		g_value_set_uint64(value, netif_link_col(link, rx_bytes));
+		break;
+	case PROP_TX_BYTES:
+		g_value_set_uint64(value, netif_link_col(link, tx_bytes));
+		break;
+	case PROP_RX_PACKETS:
+		g_value_set_uint64(value, netif_link_col(link, rx_packets));
+		break;
+	case PROP_TX_PACKETS:
+		g_value_set_uint64(value, netif_link_col(link, tx_packets));
+		break;
+	case PROP_IFINDEX:
+		g_value_set_uint(value, link->ifindex);
+		break;
+	case PROP_IFNAME:
+		g_value_set_string(value, link->ifname);
+		break;
+	case PROP_HOST:
+		g_value_set_string(value, link->host);
+		break;
+	case PROP_RX_RATE:
+		g_value_set_uint64(value, netif_link_col(link, rx_rate));
+		break;
+	case PROP_TX_RATE:
+		g_value_set_uint64(value, netif_link_col(link, tx_rate));
+		break;
+	case PROP_CPU_RX_RATE:
+		g_value_set_uint64(value, link->cpu_rx_rate);
+		break;
+	case PROP_CPU_TX_RATE:
+		g_value_set_uint64(value, link->cpu_tx_rate);
+		break;
+	case PROP_UTILIZATION:
+		g_value_set_uint(value, netif_link_col(link, util));
+		break;
+	case PROP_STATE:
+		g_value_set_string(value, link->state);
+		break;
+	case PROP_STATE_SINCE:
+		g_value_set_int64(value, link->state_since);
+		break;
+	case PROP_FLAPS:
+		g_value_set_uint(value, link->flaps);
+		break;
+	}
+}
+
+static void netif_link_stats_finalize(GObject *object)
+{
+	NetifLinkStats *self = NETIF_LINK_STATS(object);
+
+	if (self->link) {
+		g_ptr_array_remove_fast(self->link->table->items, self);
+		self->link->item = NULL;
+	}
+
+	G_OBJECT_CLASS(netif_link_stats_parent_class)->finalize(object);
+}
+
+gpointer netif_link_stats_get(gpointer data)
+{
+	struct netif_link *link = data;
+	NetifLinkStats *self;
+
+	if (link->item)
+		return g_object_ref(link->item);
+
+	self = g_object_new(NETIF_TYPE_LINK_STATS, NULL);
+	self->link = link;
+	link->item = self;
+	g_ptr_array_add(link->table->items, self);
+
+	return self;
+}
+
+void netif_link_notify(struct netif_link *link)
+{
+	GObject *object = (GObject *)link->item;
+
+	if (!object)
+		return;
+
+	g_object_freeze_notify(object);
+	for (guint i = 1; i < N_PROPS; i++)
+		g_object_notify_by_pspec(object, props[i]);
+	g_object_thaw_notify(object);
+}
+
+void netif_link_table_notify(struct netif_link_table *table, guint64 tick)
+{
+	g_autoptr(GPtrArray) items = g_ptr_array_new_with_free_func(g_object_unref);
+
+	/* hold them, a handler dropping the last reference would edit table->items */
+	for (guint i = 0; i < table->items->len; i++) {
+		NetifLinkStats *self = table->items->pdata[i];
+
+		if (netif_link_col(self->link, change_tick) == tick)
+			g_ptr_array_add(items, g_object_ref(self));
+	}
+
+	for (guint i = 0; i < items->len; i++) {
+		NetifLinkStats *self = items->pdata[i];
+
+		if (self->link)
+			netif_link_notify(self->link);
+	}
+}
+
+static void netif_link_stats_class_init(NetifLinkStatsClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(class);
+
+	object_class->get_property = netif_link_stats_get_property;
+	object_class->finalize = netif_link_stats_finalize;
+
+	props[PROP_IFINDEX] = g_param_spec_uint("ifindex", "ifindex", "interface index",
+			0, G_MAXUINT, 0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_IFNAME] = g_param_spec_string("ifname", "ifname", "interface name",
+			NULL,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_HOST] = g_param_spec_string("host", "host", "machine the interface is on",
+			NULL,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_RX_BYTES] = g_param_spec_uint64("rx-bytes", "rx bytes", "rx bytes",
+			0, G_MAXUINT64, 0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_TX_BYTES] = g_param_spec_uint64("tx-bytes", "tx bytes", "tx bytes",
+			0, G_MAXUINT64, 0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_RX_PACKETS] = g_param_spec_uint64("rx-packets", "rx packets", "rx packets",
+			0, G_MAXUINT64, 0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_TX_PACKETS] = g_param_spec_uint64("tx-packets", "tx packets", "tx packets",
+			0, G_MAXUINT64, 0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_RX_RATE] = g_param_spec_uint64("rx-rate", "rx rate", "rx rate",
+			0, G_MAXUINT64, 0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_TX_RATE] = g_param_spec_uint64("tx-rate", "tx rate", "tx rate",
+			0, G_MAXUINT64, 0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_CPU_RX_RATE] = g_param_spec_uint64("cpu-rx-rate", "cpu rx rate", "rx rate of CPU-hit traffic",
+			0, G_MAXUINT64, 0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_CPU_TX_RATE] = g_param_spec_uint64("cpu-tx-rate", "cpu tx rate", "tx rate of CPU-hit traffic",
+			0, G_MAXUINT64, 0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_UTILIZATION] = g_param_spec_uint("utilization", "utilization",
+			"hundredths of a percent of the link speed in use",
+			0, G_MAXUINT, 0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_STATE] = g_param_spec_string("state", "state", "operational state",
+			NULL,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_STATE_SINCE] = g_param_spec_int64("state-since", "state since", "last state change",
+			0, G_MAXINT64, 0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_FLAPS] = g_param_spec_uint("flaps", "flaps", "state changes seen",
+			0, G_MAXUINT, 0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties(object_class, N_PROPS, props);
+}
+
+static void netif_link_stats_init(NetifLinkStats *self)
+{
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <gio/gio.h>
+#include <stdbool.h>
+
+#include "netif-link-table.h"
+
+G_BEGIN_DECLS
+
+#define NETIF_TYPE_LINK_STATS	(netif_link_stats_get_type())
+G_DECLARE_FINAL_TYPE(NetifLinkStats, netif_link_stats, NETIF, LINK_STATS, GObject)
+
+/*
+ * Read-only view of one table row, made on demand for list views. Its
+ * properties read through to the link, NULL once the link is gone.
+ */
+struct _NetifLinkStats {
+	GObject base;
+
+	struct netif_link *link;
+};
+
+/* The item of @link, created if no one holds it, as a new reference */
+gpointer netif_link_stats_get(gpointer link);
+
+/* Have the item of @link, if any, re-read every property */
+void netif_link_notify(struct netif_link *link);
+
+/* Same for every item whose counters changed in @tick */
+void netif_link_table_notify(struct netif_link_table *table, guint64 tick);
+
+G_END_DECLS
@@ -0,0 +1,329 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "netif-link-stats.h"
+#include "netif-link-table.h"
+
+struct netif_link_table *netif_link_table_new(void)
+{
+	struct netif_link_table *table = g_new0(struct netif_link_table, 1);
+
+	table->free_slots = g_array_new(FALSE, FALSE, sizeof(guint));
+	table->items = g_ptr_array_new();
+
+	return table;
+}
+
+void netif_link_table_free(struct netif_link_table *table)
+{
+	g_array_unref(table->free_slots);
+	g_ptr_array_unref(table->items);
+	g_free(table->link);
+	g_free(table->rx_packets);
+	g_free(table->tx_packets);
+	g_free(table->rx_bytes);
+	g_free(table->tx_bytes);
+	g_free(table->rx_rate);
+	g_free(table->tx_rate);
+	g_free(table->rx_packets_delta);
+	g_free(table->tx_packets_delta);
+	g_free(table->rx_bytes_delta);
+	g_free(table->tx_bytes_delta);
+	g_free(table->interval);
+	g_free(table->rx_rate_delta);
+	g_free(table->tx_rate_delta);
+	g_free(table->rx_pps);
+	g_free(table->tx_pps);
+	g_free(table->rx_size);
+	g_free(table->tx_size);
+	g_free(table->flags);
+	g_free(table->util);
+	g_free(table->sample_time);
+	g_free(table->sample_tick);
+	g_free(table->change_tick);
+	g_free(table);
+}
+
+static void netif_link_table_grow(struct netif_link_table *table)
+{
+	guint size = MAX(table->size * 2, 64);
+
+	table->link = g_renew(struct netif_link *, table->link, size);
+	table->rx_packets = g_renew(guint64, table->rx_packets, size);
+	table->tx_packets = g_renew(guint64, table->tx_packets, size);
+	table->rx_bytes = g_renew(guint64, table->rx_bytes, size);
+	table->tx_bytes = g_renew(guint64, table->tx_bytes, size);
+	table->rx_rate = g_renew(guint64, table->rx_rate, size);
+	table->tx_rate = g_renew(guint64, table->tx_rate, size);
+	table->rx_packets_delta = g_renew(guint64, table->rx_packets_delta, size);
+	table->tx_packets_delta = g_renew(guint64, table->tx_packets_delta, size);
+	table->rx_bytes_delta = g_renew(guint64, table->rx_bytes_delta, size);
+	table->tx_bytes_delta = g_renew(guint64, table->tx_bytes_delta, size);
+	table->interval = g_renew(gint64, table->interval, size);
+	table->rx_rate_delta = g_renew(guint64, table->rx_rate_delta, size);
+	table->tx_rate_delta = g_renew(guint64, table->tx_rate_delta, size);
+	table->rx_pps = g_renew(guint64, table->rx_pps, size);
+	table->tx_pps = g_renew(guint64, table->tx_pps, size);
+	table->rx_size = g_renew(guint32, table->rx_size, size);
+	table->tx_size = g_renew(guint32, table->tx_size, size);
+	table->flags = g_renew(guint32, table->flags, size);
+	table->util = g_renew(guint32, table->util, size);
+	table->sample_time = g_renew(gint64, table->sample_time, size);
+	table->sample_tick = g_renew(guint64, table->sample_tick, size);
+	table->change_tick = g_renew(guint64, table->change_tick, size);
+	table->size = size;
+}
+
+static guint netif_link_table_alloc(struct netif_link_table *table)
+{
+	guint slot;
+
+	if (table->free_slots->len) {
+		slot = g_array_index(table->free_slots, guint, table->free_slots->len - 1);
+		g_array_set_size(table->free_slots, table->free_slots->len - 1);
+	} else {
+		if (table->len == table->size)
+			netif_link_table_grow(table);
+		slot = table->len++;
+	}
+
+	table->rx_packets[slot] = 0;
+	table->tx_packets[slot] = 0;
+	table->rx_bytes[slot] = 0;
+	table->tx_bytes[slot] = 0;
+	table->rx_rate[slot] = 0;
+	table->tx_rate[slot] = 0;
+	table->rx_packets_delta[slot] = 0;
+	table->tx_packets_delta[slot] = 0;
+	table->rx_bytes_delta[slot] = 0;
+	table->tx_bytes_delta[slot] = 0;
+	table->interval[slot] = 0;
+	table->rx_rate_delta[slot] = 0;
+	table->tx_rate_delta[slot] = 0;
+	table->rx_pps[slot] = 0;
+	table->tx_pps[slot] = 0;
+	table->rx_size[slot] = 0;
+	table->tx_size[slot] = 0;
+	table->flags[slot] = 0;
+	table->util[slot] = 0;
+	table->sample_time[slot] = 0;
+	table->sample_tick[slot] = 0;
+	table->change_tick[slot] = 0;
+
+	return slot;
+}
+
+struct netif_link *netif_link_new(struct netif_link_table *table,
+		guint ifindex, const char *ifname)
+{
+	struct netif_link *link = g_new0(struct netif_link, 1);
+
+	link->table = table;
+	link->slot = netif_link_table_alloc(table);
+	link->ifindex = ifindex;
+	link->ifname = g_strdup(ifname);
+	link->netnsid = -1;
+	link->carrier = -1;
+	table->link[link->slot] = link;
+	table->serial++;
+
+	return link;
+}
+
+void netif_link_free(gpointer data)
+{
+	struct netif_link *link = data;
+	struct netif_link_table *table = link->table;
+
+	/* an item that outlives its link reads as empty */
+	if (link->item) {
+		g_ptr_array_remove_fast(table->items, link->item);
+		link->item->link = NULL;
+	}
+
+	table->link[link->slot] = NULL;
+	g_array_append_val(table->free_slots, link->slot);
+	table->serial++;
+
+	g_free(link->ifname);
+	g_free(link->state);
+	if (link->hist) {
+		netif_hist_clear(&link->hist[0]);
+		netif_hist_clear(&link->hist[1]);
+		g_free(link->hist);
+	}
+	g_clear_pointer(&link->history, netif_history_close);
+	g_clear_object(&link->children);
+	g_free(link->qdisc);
+	g_clear_object(&link->qdiscs);
+	g_free(link);
+}
+
+void netif_link_counters_get(struct netif_link *link, struct netif_counters *c)
+{
+	c->rx_packets = netif_link_col(link, rx_packets);
+	c->tx_packets = netif_link_col(link, tx_packets);
+	c->rx_bytes = netif_link_col(link, rx_bytes);
+	c->tx_bytes = netif_link_col(link, tx_bytes);
+	c->rx_rate = netif_link_col(link, rx_rate);
+	c->tx_rate = netif_link_col(link, tx_rate);
+}
+
+void netif_link_counters_set(struct netif_link *link, const struct netif_counters *c)
+{
+	netif_link_col(link, rx_packets) = c->rx_packets;
+	netif_link_col(link, tx_packets) = c->tx_packets;
+	netif_link_col(link, rx_bytes) = c->rx_bytes;
+	netif_link_col(link, tx_bytes) = c->tx_bytes;
+	netif_link_col(link, rx_rate) = c->rx_rate;
+	netif_link_col(link, tx_rate) = c->tx_rate;
+}
+
+void netif_link_sample(struct netif_link *link, const struct netif_counters *c,
+		gint64 time, guint64 tick)
+{
+	struct netif_link_table *table = link->table;
+	guint slot = link->slot;
+
+	/* a link's first sample has nothing before it */
+	if (table->sample_tick[slot]) {
+		table->rx_packets_delta[slot] = c->rx_packets - table->rx_packets[slot];
+		table->tx_packets_delta[slot] = c->tx_packets - table->tx_packets[slot];
+		table->rx_bytes_delta[slot] = c->rx_bytes - table->rx_bytes[slot];
+		table->tx_bytes_delta[slot] = c->tx_bytes - table->tx_bytes[slot];
+		table->interval[slot] = time - table->sample_time[slot];
+	}
+
+	table->rx_packets[slot] = c->rx_packets;
+	table->tx_packets[slot] = c->tx_packets;
+	table->rx_bytes[slot] = c->rx_bytes;
+	table->tx_bytes[slot] = c->tx_bytes;
+	table->sample_time[slot] = time;
+	table->sample_tick[slot] = tick;
+}
+
+/* RssAnon and RssFile of this process in KiB */
+static int bench_rss(gint64 *anon, gint64 *file)
+{
+	g_autofree char *status = NULL;
+	const char *p;
+
+	if (!g_file_get_contents("/proc/self/status", &status, NULL, NULL))
+		return -EIO;
+
+	p = strstr(status, "RssAnon:");
+	*anon = p ? g_ascii_strtoll(p + 8, NULL, 10) : 0;
+	p = strstr(status, "RssFile:");
+	*file = p ? g_ascii_strtoll(p + 8, NULL, 10) : 0;
+
+	return 0;
+}
+
+static void bench_report(FILE *out, const char *what, guint links,
+		gint64 anon0, gint64 file0)
+{
+	gint64 anon, file;
+
+	if (bench_rss(&anon, &file) < 0)
+		return;
+
+	fprintf(out, "%-24s anon %8"PRId64" KiB %7.0f B/interface  file %8"PRId64" KiB %7.0f B/interface\n",
+			what, anon - anon0, (anon - anon0) * 1024.0 / links,
+			file - file0, (file - file0) * 1024.0 / links);
+}
+
+/*
+ * One second of a busy host: one link in five carries traffic anywhere up
+ * to line rate, the others stay idle
+ */
+static void bench_second(struct netif_link_table *table, GRand *rand, gint64 time)
+{
+	for (guint i = 0; i < table->len; i++) {
+		struct netif_link *link = table->link[i];
+		guint64 rate = i % 5 == 0 ?
+			(guint64)g_rand_int_range(rand, 1, 1250000) << g_rand_int_range(rand, 0, 10) : 0;
+		guint64 rates[NETIF_HISTORY_COUNTERS] = {
+			rate, rate / 2, rate / 800, rate / 1600,
+		};
+
+		netif_hist_record(&link->hist[0], rates[NETIF_HISTORY_RX_BYTES]);
+		netif_hist_record(&link->hist[1], rates[NETIF_HISTORY_TX_BYTES]);
+		if (link->history)
+			netif_history_update(link->history, time, rates);
+	}
+}
+
+int netif_link_table_bench(FILE *out, guint links, const char *history_dir)
+{
+	struct netif_link_table *table;
+	g_autoptr(GRand) rand = g_rand_new_with_seed(1);
+	gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+	gint64 anon0, file0;
+	int err;
+
+	err = bench_rss(&anon0, &file0);
+	if (err < 0)
+		return err;
+
+	table = netif_link_table_new();
+	for (guint i = 0; i < links; i++) {
+		g_autofree char *name = g_strdup_printf("bench%u", i);
+		struct netif_link *link = netif_link_new(table, i + 1, name);
+
+		/* as the widget gives them to every interface */
+		link->hist = g_new0(struct netif_hist, 2);
+		if (history_dir)
+			link->history = netif_history_open(history_dir, name);
+	}
+
+	fprintf(out, "%u interfaces%s\n", links, history_dir ? ", with history" : "");
+	bench_report(out, "created", links, anon0, file0);
+
+	for (gint64 t = 0; t < 600; t++)
+		bench_second(table, rand, now + t);
+	bench_report(out, "after 10 minutes", links, anon0, file0);
+
+	/* the rest fills the minute and hour rings, one sample per slot will do */
+	if (history_dir) {
+		for (gint64 t = 600; t < 24 * 3600; t += 60)
+			bench_second(table, rand, now + t);
+		bench_report(out, "after a day", links, anon0, file0);
+
+		for (gint64 t = 24 * 3600; t < 30 * 24 * 3600; t += 3600)
+			bench_second(table, rand, now + t);
+		bench_report(out, "after 30 days", links, anon0, file0);
+	}
+
+	for (guint i = 0; i < table->len; i++) {
+		g_autofree char *path = NULL;
+		struct netif_link *link = table->link[i];
+
+		if (link->history) {
+			path = g_strdup_printf("%s/%s.history", history_dir, link->ifname);
+			unlink(path);
+		}
+		netif_link_free(link);
+	}
+	netif_link_table_free(table);
+
+	return 0;
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "netif-histogram.h"
+#include "netif-history.h"
+
+G_BEGIN_DECLS
+
+struct netif_counters {
+	guint64 rx_packets;
+	guint64 tx_packets;
+	guint64 rx_bytes;
+	guint64 tx_bytes;
+	guint64 rx_rate;
+	guint64 tx_rate;
+};
+
+struct netif_link_table;
+struct netif_qdisc;
+typedef struct _NetifLinkModel NetifLinkModel;
+typedef struct _NetifLinkStats NetifLinkStats;
+
+/* One interface or aggregate row, its counters live in the table */
+struct netif_link {
+	struct netif_link_table *table;
+	guint slot;
+
+	guint ifindex;
+	char *ifname;
+
+	/* machine the interface is on, not owned, NULL on aggregate rows */
+	const char *host;
+
+	/* software path share, set when the source reports offload xstats */
+	bool offload;
+	guint64 cpu_rx_bytes;
+	guint64 cpu_tx_bytes;
+	guint64 cpu_rx_rate;
+	guint64 cpu_tx_rate;
+
+	bool mpls;
+	guint64 mpls_rx_packets;
+	guint64 mpls_tx_packets;
+
+	/* rx and tx rate distribution and rollups, NULL on aggregate rows */
+	struct netif_hist *hist;
+	struct netif_history *history;
+
+	/* IFLA_OPERSTATE name and IFLA_LINK_NETNSID of the peer, -1 if none */
+	char *state;
+	int netnsid;
+
+	/* ifi_flags and IFLA_CARRIER (-1 if unknown) behind the state */
+	guint flags;
+	int carrier;
+
+	/* wall clock time in usec of the last state change, and their count */
+	gint64 state_since;
+	guint flaps;
+
+	/* NetifFilter result, valid while match_serial is the filter's */
+	guint match_serial;
+	bool match;
+
+	/* aggregate row this interface is a member of */
+	struct netif_link *group;
+
+	/* set on aggregate rows only */
+	NetifLinkModel *children;
+	bool dirty;
+
+	/* set on qdisc rows: the stats, the interface and the row listed under */
+	struct netif_qdisc *qdisc;
+	struct netif_link *dev;
+	struct netif_link *up;
+
+	/* qdisc rows below this interface or qdisc, made when a view asks */
+	NetifLinkModel *qdiscs;
+	/* poll them even while no view shows them, see --qdisc */
+	bool qdisc_watch;
+
+	/* ethtool link speed in Mb/s, 0 if unknown, and duplex */
+	guint32 speed;
+	bool half_duplex;
+
+	/* sampled every tick even while off screen, see --pin */
+	bool pinned;
+	/* NetifWidget tick it was last queued for a targeted sample in */
+	guint64 poll_tick;
+	/* queued for a sample after a state change */
+	bool dump_queued;
+
+	/* row object while a view holds one, see netif_link_stats_get() */
+	NetifLinkStats *item;
+};
+
+/*
+ * Per-interface counters, one array per column indexed by slot. A tick
+ * writes contiguous arrays instead of setting GObject properties, and row
+ * objects only exist for the rows a view asked for. Slots of removed
+ * links are reused, so a link keeps its slot for life.
+ */
+struct netif_link_table {
+	guint size;
+	guint len;
+	GArray *free_slots;
+
+	struct netif_link **link;
+
+	guint64 *rx_packets;
+	guint64 *tx_packets;
+	guint64 *rx_bytes;
+	guint64 *tx_bytes;
+	guint64 *rx_rate;
+	guint64 *tx_rate;
+
+	/* counter deltas and usec since the sample before, see netif_link_sample() */
+	guint64 *rx_packets_delta;
+	guint64 *tx_packets_delta;
+	guint64 *rx_bytes_delta;
+	guint64 *tx_bytes_delta;
+	gint64 *interval;
+
+	/*
+	 * derived by netif_rates_compute(): how much the rates moved, for the
+	 * group totals, packets/s and mean packet size
+	 */
+	guint64 *rx_rate_delta;
+	guint64 *tx_rate_delta;
+	guint64 *rx_pps;
+	guint64 *tx_pps;
+	guint32 *rx_size;
+	guint32 *tx_size;
+	guint32 *flags;
+
+	/* hundredths of a percent of the link speed in use, 0 if unknown */
+	guint32 *util;
+
+	/* monotonic time of the last sample, and its NetifWidget tick */
+	gint64 *sample_time;
+	guint64 *sample_tick;
+
+	/* NetifWidget tick in which the counters last changed */
+	guint64 *change_tick;
+
+	/* the alive NetifLinkStats */
+	GPtrArray *items;
+
+	/* bumped when a link comes, goes or is renamed */
+	guint serial;
+};
+
+/* Column @col of @link, an lvalue */
+#define netif_link_col(link, col)	((link)->table->col[(link)->slot])
+
+struct netif_link_table *netif_link_table_new(void);
+void netif_link_table_free(struct netif_link_table *table);
+
+struct netif_link *netif_link_new(struct netif_link_table *table,
+		guint ifindex, const char *ifname);
+void netif_link_free(gpointer data);
+
+void netif_link_counters_get(struct netif_link *link, struct netif_counters *c);
+void netif_link_counters_set(struct netif_link *link, const struct netif_counters *c);
+
+/* Store the counters in @c and their deltas to the current ones, for the rate pass */
+void netif_link_sample(struct netif_link *link, const struct netif_counters *c,
+		gint64 time, guint64 tick);
+
+/*
+ * Resident memory of @links interfaces with their histograms, and their
+ * history files in @history_dir if set, see --bench-memory
+ */
+int netif_link_table_bench(FILE *out, guint links, const char *history_dir);
+
+G_END_DECLS
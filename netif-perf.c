@@ -0,0 +1,116 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#ifdef HAVE_SYSPROF
+#include <sysprof-capture.h>
+#endif
+
+#include "netif-perf.h"
+
+void netif_perf_push(struct netif_perf *perf, const struct netif_perf_tick *t)
+{
+	perf->head = (perf->head + 1) % NETIF_PERF_TICKS;
+	perf->ring[perf->head] = *t;
+	if (perf->len < NETIF_PERF_TICKS)
+		perf->len++;
+}
+
+const struct netif_perf_tick *netif_perf_get(const struct netif_perf *perf, guint n)
+{
+	if (n >= perf->len)
+		return NULL;
+
+	return &perf->ring[(perf->head + NETIF_PERF_TICKS - n) % NETIF_PERF_TICKS];
+}
+
+#define PERF_FIELDS(X) \
+	X(messages) X(bytes) X(dump_ns) X(read_ns) X(parse_ns) \
+	X(update_ns) X(format_ns) X(total_ns)
+
+void netif_perf_summary(const struct netif_perf *perf,
+		struct netif_perf_tick *avg, struct netif_perf_tick *max)
+{
+	*avg = (struct netif_perf_tick){ 0 };
+	*max = (struct netif_perf_tick){ 0 };
+
+	if (!perf->len)
+		return;
+
+	for (guint i = 0; i < perf->len; i++) {
+		const struct netif_perf_tick *t = &perf->ring[i];
+
+#define X(f)	avg->f += t->f; max->f = MAX(max->f, t->f);
+		PERF_FIELDS(X)
+#undef X
+	}
+
+#define X(f)	avg->f /= perf->len;
+	PERF_FIELDS(X)
+#undef X
+
+	avg->tick = max->tick = netif_perf_get(perf, 0)->tick;
+}
+
+static double ms(gint64 ns)
+{
+	return ns / 1e6;
+}
+
+char *netif_perf_format(const struct netif_perf *perf)
+{
+	const struct netif_perf_tick *t = netif_perf_get(perf, 0);
+	struct netif_perf_tick avg, max;
+	g_autofree char *size = NULL;
+
+	if (!t)
+		return g_strdup("no dump yet");
+
+	netif_perf_summary(perf, &avg, &max);
+	size = g_format_size_full(t->bytes, G_FORMAT_SIZE_IEC_UNITS);
+
+	return g_strdup_printf(
+			"tick %"G_GUINT64_FORMAT"   %u msgs   %s\n"
+			"          last    avg    max (ms)\n"
+			"read   %7.2f %6.2f %6.2f\n"
+			"parse  %7.2f %6.2f %6.2f\n"
+			"update %7.2f %6.2f %6.2f\n"
+			"format %7.2f %6.2f %6.2f\n"
+			"total  %7.2f %6.2f %6.2f",
+			t->tick, t->messages, size,
+			ms(t->read_ns), ms(avg.read_ns), ms(max.read_ns),
+			ms(t->parse_ns), ms(avg.parse_ns), ms(max.parse_ns),
+			ms(t->update_ns), ms(avg.update_ns), ms(max.update_ns),
+			ms(t->format_ns), ms(avg.format_ns), ms(max.format_ns),
+			ms(t->total_ns), ms(avg.total_ns), ms(max.total_ns));
+}
+
+void netif_perf_mark(gint64 begin, const char *name, const char *format, ...)
+{
+#ifdef HAVE_SYSPROF
+	g_autofree char *message = NULL;
+	va_list args;
+
+	if (!sysprof_collector_is_active())
+		return;
+
+	va_start(args, format);
+	message = g_strdup_vprintf(format, args);
+	va_end(args);
+
+	sysprof_collector_mark(begin, netif_perf_now() - begin, "netifstat", name, message);
+#endif
+}
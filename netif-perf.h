@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glib.h>
+#include <time.h>
+
+G_BEGIN_DECLS
+
+/* Where the time of one NetifWidget tick went, all times in nsec */
+struct netif_perf_tick {
+	guint64 tick;
+
+	/* records and bytes the source read, see struct netif_source_stats */
+	guint messages;
+	guint64 bytes;
+
+	gint64 dump_ns;		/* netif_source_dump() as a whole */
+	gint64 read_ns;		/* waiting for and copying in kernel data */
+	gint64 parse_ns;	/* turning it into samples */
+	gint64 update_ns;	/* columns, groups, models and notifications */
+	gint64 format_ns;	/* labels of the rows on screen */
+	gint64 total_ns;
+};
+
+/* The last minute at the default interval */
+#define NETIF_PERF_TICKS	60
+
+struct netif_perf {
+	struct netif_perf_tick ring[NETIF_PERF_TICKS];
+	guint head;
+	guint len;
+};
+
+/* CLOCK_MONOTONIC in nsec, the clock sysprof marks are on */
+static inline gint64 netif_perf_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (gint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void netif_perf_push(struct netif_perf *perf, const struct netif_perf_tick *t);
+
+/* @n-th most recent tick, 0 is the last one, NULL past the history */
+const struct netif_perf_tick *netif_perf_get(const struct netif_perf *perf, guint n);
+
+/* Field-wise mean and maximum over the kept ticks */
+void netif_perf_summary(const struct netif_perf *perf,
+		struct netif_perf_tick *avg, struct netif_perf_tick *max);
+
+/* Multi-line text for the debug overlay */
+char *netif_perf_format(const struct netif_perf *perf);
+
+/*
+ * Add a sysprof capture mark from @begin to now when running under
+ * sysprof, a no-op otherwise or when built without sysprof-capture.
+ */
+void netif_perf_mark(gint64 begin, const char *name, const char *format, ...)
+	G_GNUC_PRINTF(3, 4);
+
+G_END_DECLS
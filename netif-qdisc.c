@@ -0,0 +1,112 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include <netlink/socket.h>
+#include <netlink/netlink.h>
+#include <netlink/errno.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+#include <linux/rtnetlink.h>
+#include <linux/pkt_sched.h>
+#include <linux/gen_stats.h>
+#include <errno.h>
+#include <string.h>
+
+#include "netif-qdisc.h"
+
+int netif_qdisc_request(struct nl_sock *sock)
+{
+	struct tcmsg tcm = { .tcm_family = AF_UNSPEC };
+	int err;
+
+	/* the kernel ignores tcm_ifindex in dumps, the caller filters */
+	err = nl_send_simple(sock, RTM_GETQDISC, NLM_F_DUMP, &tcm, sizeof(tcm));
+
+	return err < 0 ? -EIO : 0;
+}
+
+int netif_qdisc_parse(struct nlmsghdr *hdr, struct netif_qdisc *qdisc)
+{
+	struct tcmsg *tcm = nlmsg_data(hdr);
+	struct nlattr *tb[TCA_MAX + 1];
+	struct nlattr *st[TCA_STATS_MAX + 1];
+
+	if (hdr->nlmsg_type != RTM_NEWQDISC ||
+	    nlmsg_parse(hdr, sizeof(*tcm), tb, TCA_MAX, NULL) < 0)
+		return -EINVAL;
+
+	*qdisc = (struct netif_qdisc){
+		.ifindex = tcm->tcm_ifindex,
+		.handle = tcm->tcm_handle,
+		.parent = tcm->tcm_parent,
+	};
+
+	if (tb[TCA_KIND])
+		nla_strlcpy(qdisc->kind, tb[TCA_KIND], sizeof(qdisc->kind));
+
+	if (!tb[TCA_STATS2] || nla_parse_nested(st, TCA_STATS_MAX, tb[TCA_STATS2], NULL) < 0)
+		return 0;
+
+	if (st[TCA_STATS_BASIC]) {
+		struct gnet_stats_basic basic = { 0 };
+
+		memcpy(&basic, nla_data(st[TCA_STATS_BASIC]),
+				MIN((size_t)nla_len(st[TCA_STATS_BASIC]), sizeof(basic)));
+		qdisc->bytes = basic.bytes;
+		qdisc->packets = basic.packets;
+	}
+
+	/* the basic packet count is 32 bit, 5.5 and later add this one */
+	if (st[TCA_STATS_PKT64])
+		qdisc->packets = nla_get_u64(st[TCA_STATS_PKT64]);
+
+	if (st[TCA_STATS_QUEUE]) {
+		struct gnet_stats_queue queue = { 0 };
+
+		memcpy(&queue, nla_data(st[TCA_STATS_QUEUE]),
+				MIN((size_t)nla_len(st[TCA_STATS_QUEUE]), sizeof(queue)));
+		qdisc->qlen = queue.qlen;
+		qdisc->backlog = queue.backlog;
+		qdisc->drops = queue.drops;
+		qdisc->requeues = queue.requeues;
+		qdisc->overlimits = queue.overlimits;
+	}
+
+	return 0;
+}
+
+guint32 netif_qdisc_up(const struct netif_qdisc *qdisc)
+{
+	if (qdisc->parent == TC_H_ROOT || qdisc->parent == TC_H_INGRESS ||
+	    qdisc->parent == TC_H_UNSPEC)
+		return 0;
+
+	/* the parent is a class, which lives in the qdisc of its major */
+	return TC_H_MAJ(qdisc->parent);
+}
+
+char *netif_qdisc_name(const struct netif_qdisc *qdisc)
+{
+	if (qdisc->handle)
+		return g_strdup_printf("%s %x:", qdisc->kind, TC_H_MAJ(qdisc->handle) >> 16);
+
+	/* default qdiscs under mq have no handle, tell them apart by queue */
+	if (netif_qdisc_up(qdisc))
+		return g_strdup_printf("%s :%x", qdisc->kind, TC_H_MIN(qdisc->parent));
+
+	return g_strdup(qdisc->kind);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glib.h>
+#include <net/if.h>
+#include <stdbool.h>
+
+struct nl_sock;
+struct nlmsghdr;
+
+G_BEGIN_DECLS
+
+/* One queueing discipline from an RTM_NEWQDISC message, TCA_STATS2 counters */
+struct netif_qdisc {
+	guint ifindex;
+	guint32 handle;
+	guint32 parent;
+	char kind[IF_NAMESIZE];
+
+	guint64 bytes;
+	guint64 packets;
+	guint32 drops;
+	guint32 overlimits;
+	guint32 requeues;
+	guint32 backlog;	/* bytes queued */
+	guint32 qlen;		/* packets queued */
+
+	/* NetifWidget qdisc dump it was last seen in */
+	guint serial;
+};
+
+/* Ask for every qdisc of every interface, replies arrive on @sock */
+int netif_qdisc_request(struct nl_sock *sock);
+
+/* Fill @qdisc from an RTM_NEWQDISC, -EINVAL if it is not one */
+int netif_qdisc_parse(struct nlmsghdr *hdr, struct netif_qdisc *qdisc);
+
+/* Handle of the qdisc @qdisc is attached under, 0 for a root or ingress one */
+guint32 netif_qdisc_up(const struct netif_qdisc *qdisc);
+
+/* "htb 1:", "fq_codel 8001:" */
+char *netif_qdisc_name(const struct netif_qdisc *qdisc);
+
+G_END_DECLS
@@ -0,0 +1,293 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include "netif-perf.h"
+#include "netif-rates.h"
+
+/*
+ * x86 has no SIMD 64-bit integer division, and no 64-bit integer to
+ * double conversion before AVX-512. Values below 2^52 convert exactly by
+ * placing them in the mantissa of 2^52 and subtracting it again, which is
+ * an OR and a subtraction in any vector width. Anything at or above 2^52 bytes or
+ * packets in one tick is a counter going backwards.
+ */
+#define U52		(G_GUINT64_CONSTANT(1) << 52)
+#define U52_DOUBLE	4503599627370496.0
+
+static inline double u52_to_double(guint64 x)
+{
+	guint64 bits = x | G_GUINT64_CONSTANT(0x4330000000000000);
+	double d;
+
+	memcpy(&d, &bits, sizeof(d));
+	return d - U52_DOUBLE;
+}
+
+/*
+ * Rounds to nearest, @d must not be negative. Past 2^52 the exponent grows
+ * and the result is no longer exact, but stays above 2^52 B/s, which no
+ * rate reaches. Clamping would cost a compare and a blend per column.
+ */
+static inline guint64 double_to_u52(double d)
+{
+	guint64 bits;
+
+	d += U52_DOUBLE;
+	memcpy(&bits, &d, sizeof(bits));
+	return bits - G_GUINT64_CONSTANT(0x4330000000000000);
+}
+
+/* @a where @mask is set, @b elsewhere */
+static inline guint64 blend(guint64 mask, guint64 a, guint64 b)
+{
+	return (a & mask) | (b & ~mask);
+}
+
+static inline guint64 rate_of(guint64 delta, double scale)
+{
+	return double_to_u52(u52_to_double(delta) * scale);
+}
+
+/*
+ * SSE2 has no 64-bit compares, so the baseline build stays scalar. The
+ * loader picks a vectorized clone on CPUs that have them.
+ */
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define NETIF_RATES_CLONES \
+	__attribute__((target_clones("avx512f", "avx2", "sse4.2", "default")))
+#else
+#define NETIF_RATES_CLONES
+#endif
+
+NETIF_RATES_CLONES
+void netif_rates_compute(struct netif_link_table *table, guint begin, guint end,
+		guint64 tick)
+{
+	/* columns never alias, without saying so gcc gives up on the alias checks */
+	const guint64 *restrict rx_bytes = table->rx_bytes_delta;
+	const guint64 *restrict tx_bytes = table->tx_bytes_delta;
+	const guint64 *restrict rx_packets = table->rx_packets_delta;
+	const guint64 *restrict tx_packets = table->tx_packets_delta;
+	const gint64 *restrict interval = table->interval;
+	const guint64 *restrict sample_tick = table->sample_tick;
+	guint64 *restrict rx_rate = table->rx_rate;
+	guint64 *restrict tx_rate = table->tx_rate;
+	guint64 *restrict rx_rate_delta = table->rx_rate_delta;
+	guint64 *restrict tx_rate_delta = table->tx_rate_delta;
+	guint64 *restrict rx_pps = table->rx_pps;
+	guint64 *restrict tx_pps = table->tx_pps;
+	guint32 *restrict rx_size = table->rx_size;
+	guint32 *restrict tx_size = table->tx_size;
+	guint32 *restrict flags = table->flags;
+
+	/*
+	 * Every slot is computed and the results selected, a ?: on the columns
+	 * turns into a branch and stops the vectorizer. A slot not sampled in
+	 * @tick still holds the deltas of its last sample, so it comes out the
+	 * same, only its flags are left alone.
+	 */
+#pragma GCC ivdep
+	for (guint i = begin; i < end; i++) {
+		guint64 drb = rx_bytes[i];
+		guint64 dtb = tx_bytes[i];
+		guint64 drp = rx_packets[i];
+		guint64 dtp = tx_packets[i];
+		gint64 dt = interval[i];
+		guint64 any = drb | dtb | drp | dtp;
+		/* bytes with no packets have no mean size */
+		guint64 rx_sized = -(guint64)(drp != 0);
+		guint64 tx_sized = -(guint64)(dtp != 0);
+
+		/* all ones or all zeros */
+		guint64 sampled = -(guint64)(sample_tick[i] == tick);
+		guint64 valid = -(guint64)(dt > 0);
+		guint64 reset = valid & -(guint64)(any >> 52 != 0);
+
+		/* a reset zeroes the deltas, and so the rates */
+		drb &= ~reset;
+		dtb &= ~reset;
+		drp &= ~reset;
+		dtp &= ~reset;
+
+		/*
+		 * Division is the slowest op here, so take one reciprocal of the
+		 * interval times both packet counts. Slots without a valid interval
+		 * divide by 1, idle ones by 1 packet.
+		 */
+		double usec = u52_to_double(blend(valid, MIN(dt, (gint64)U52 - 1), 1));
+		double rxn = u52_to_double(drp ? drp : 1);
+		double txn = u52_to_double(dtp ? dtp : 1);
+		double inv = 1 / (usec * rxn * txn);
+		double scale = 1e6 * rxn * txn * inv;
+
+		/* no interval leaves them as they were */
+		guint64 rxr = blend(valid, rate_of(drb, scale), rx_rate[i]);
+		guint64 txr = blend(valid, rate_of(dtb, scale), tx_rate[i]);
+		guint64 rxp = blend(valid, rate_of(drp, scale), rx_pps[i]);
+		guint64 txp = blend(valid, rate_of(dtp, scale), tx_pps[i]);
+		guint32 rxs = blend(valid, rate_of(drb, usec * txn * inv) & rx_sized, rx_size[i]);
+		guint32 txs = blend(valid, rate_of(dtb, usec * rxn * inv) & tx_sized, tx_size[i]);
+		guint32 changed = (any != 0) | (rxr != rx_rate[i]) | (txr != tx_rate[i]);
+		guint32 f = (valid & NETIF_RATE_VALID) | (reset & NETIF_RATE_RESET) |
+			changed * NETIF_RATE_CHANGED;
+
+		/* unsigned, a falling rate wraps and subtracts when added */
+		rx_rate_delta[i] = rxr - rx_rate[i];
+		tx_rate_delta[i] = txr - tx_rate[i];
+		rx_rate[i] = rxr;
+		tx_rate[i] = txr;
+		rx_pps[i] = rxp;
+		tx_pps[i] = txp;
+		rx_size[i] = rxs;
+		tx_size[i] = txs;
+		flags[i] = blend(sampled, f, flags[i]);
+	}
+}
+
+void netif_rates_compute_scalar(struct netif_link_table *table, guint begin, guint end,
+		guint64 tick)
+{
+	for (guint i = begin; i < end; i++) {
+		guint64 drb = table->rx_bytes_delta[i];
+		guint64 dtb = table->tx_bytes_delta[i];
+		guint64 drp = table->rx_packets_delta[i];
+		guint64 dtp = table->tx_packets_delta[i];
+		gint64 dt = table->interval[i];
+		guint64 rxr, txr;
+		guint flags = 0;
+
+		if (table->sample_tick[i] != tick)
+			continue;
+
+		if (dt <= 0) {
+			table->rx_rate_delta[i] = 0;
+			table->tx_rate_delta[i] = 0;
+			table->flags[i] = (drb | dtb | drp | dtp) ? NETIF_RATE_CHANGED : 0;
+			continue;
+		}
+
+		flags |= NETIF_RATE_VALID;
+		if ((drb | dtb | drp | dtp) >= U52) {
+			flags |= NETIF_RATE_RESET | NETIF_RATE_CHANGED;
+			drb = dtb = drp = dtp = 0;
+		}
+
+		rxr = drb * G_USEC_PER_SEC / dt;
+		txr = dtb * G_USEC_PER_SEC / dt;
+		if ((drb | dtb | drp | dtp) || rxr != table->rx_rate[i] || txr != table->tx_rate[i])
+			flags |= NETIF_RATE_CHANGED;
+
+		table->rx_rate_delta[i] = rxr - table->rx_rate[i];
+		table->tx_rate_delta[i] = txr - table->tx_rate[i];
+		table->rx_rate[i] = rxr;
+		table->tx_rate[i] = txr;
+		table->rx_pps[i] = drp * G_USEC_PER_SEC / dt;
+		table->tx_pps[i] = dtp * G_USEC_PER_SEC / dt;
+		table->rx_size[i] = drp ? drb / drp : 0;
+		table->tx_size[i] = dtp ? dtb / dtp : 0;
+		table->flags[i] = flags;
+	}
+}
+
+/*
+ * Counters moving like a busy host: most links idle, a few at line rate,
+ * and now and then bytes counted with no packets
+ */
+static void bench_sample(struct netif_link_table *table, GRand *rand, guint64 tick,
+		gint64 time)
+{
+	for (guint i = 0; i < table->len; i++) {
+		guint64 bytes = g_rand_int_range(rand, 0, 100) < 20 ?
+			g_rand_int_range(rand, 0, 1250000000) : 0;
+		guint64 packets = g_rand_int_range(rand, 0, 100) < 5 ? 0 : bytes / 800;
+		struct netif_link *link = table->link[i];
+
+		netif_link_sample(link, &(struct netif_counters){
+				.rx_bytes = netif_link_col(link, rx_bytes) + bytes,
+				.tx_bytes = netif_link_col(link, tx_bytes) + bytes / 2,
+				.rx_packets = netif_link_col(link, rx_packets) + packets,
+				.tx_packets = netif_link_col(link, tx_packets) + packets / 2,
+			}, time, tick);
+	}
+}
+
+static gint64 bench_run(struct netif_link_table *table, guint iterations,
+		void (*compute)(struct netif_link_table *, guint, guint, guint64))
+{
+	g_autoptr(GRand) rand = g_rand_new_with_seed(1);
+	gint64 best = G_MAXINT64;
+
+	for (guint n = 1; n <= iterations; n++) {
+		gint64 start;
+
+		bench_sample(table, rand, n, n * G_USEC_PER_SEC);
+
+		start = netif_perf_now();
+		compute(table, 0, table->len, n);
+		best = MIN(best, netif_perf_now() - start);
+	}
+
+	return best;
+}
+
+int netif_rates_bench(FILE *out, guint links, guint iterations)
+{
+	struct netif_link_table *batch = netif_link_table_new();
+	struct netif_link_table *scalar = netif_link_table_new();
+	gint64 batch_ns, scalar_ns;
+	guint diff = 0;
+
+	for (guint i = 0; i < links; i++) {
+		netif_link_new(batch, i + 1, "bench");
+		netif_link_new(scalar, i + 1, "bench");
+	}
+
+	scalar_ns = bench_run(scalar, iterations, netif_rates_compute_scalar);
+	batch_ns = bench_run(batch, iterations, netif_rates_compute);
+
+	/* same input, rates may only differ by the rounding */
+	for (guint i = 0; i < links; i++) {
+		gint64 rate = batch->rx_rate[i] - scalar->rx_rate[i];
+		gint64 rx_size = (gint64)batch->rx_size[i] - scalar->rx_size[i];
+		gint64 tx_size = (gint64)batch->tx_size[i] - scalar->tx_size[i];
+
+		if (rate < -1 || rate > 1 || rx_size < -1 || rx_size > 1 ||
+		    tx_size < -1 || tx_size > 1 || batch->flags[i] != scalar->flags[i])
+			diff++;
+	}
+
+	fprintf(out, "%u interfaces, best of %u ticks\n", links, iterations);
+	fprintf(out, "scalar %8.1f us  %6.2f ns/interface\n",
+			scalar_ns / 1e3, (double)scalar_ns / links);
+	fprintf(out, "batch  %8.1f us  %6.2f ns/interface  %.1fx\n",
+			batch_ns / 1e3, (double)batch_ns / links,
+			(double)scalar_ns / MAX(batch_ns, 1));
+	if (diff)
+		fprintf(out, "%u interfaces differ\n", diff);
+
+	for (guint i = 0; i < links; i++) {
+		netif_link_free(batch->link[i]);
+		netif_link_free(scalar->link[i]);
+	}
+	netif_link_table_free(batch);
+	netif_link_table_free(scalar);
+
+	return diff ? -EIO : 0;
+}
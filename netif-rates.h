@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glib.h>
+#include <stdio.h>
+
+#include "netif-link-table.h"
+
+G_BEGIN_DECLS
+
+/* netif_link_table flags, set by the rate pass on the slots it covers */
+enum {
+	NETIF_RATE_VALID = 1 << 0,	/* a previous sample to diff against */
+	NETIF_RATE_RESET = 1 << 1,	/* a counter went backwards, rates are 0 */
+	NETIF_RATE_CHANGED = 1 << 2,	/* counters or rates differ from before */
+};
+
+/*
+ * Rates, packet rates and mean packet sizes of the slots in [@begin, @end)
+ * from the deltas of their last sample, and the flags and rate deltas of
+ * those sampled in @tick. One branch-free pass the compiler turns into SIMD code, rates are
+ * rounded to the nearest unit per second.
+ */
+void netif_rates_compute(struct netif_link_table *table, guint begin, guint end,
+		guint64 tick);
+
+/* The same one slot at a time with integer division, for reference */
+void netif_rates_compute_scalar(struct netif_link_table *table, guint begin, guint end,
+		guint64 tick);
+
+/* Time both over a synthetic table of @links interfaces, see --bench-rates */
+int netif_rates_bench(FILE *out, guint links, guint iterations);
+
+G_END_DECLS
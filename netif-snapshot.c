@@ -0,0 +1,248 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include <net/if.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include "netif-source.h"
+#include "netif-snapshot.h"
+
+struct snapshot_row {
+	guint ifindex;
+	char ifname[IF_NAMESIZE];
+	guint64 counters[2][4];
+	bool seen[2];
+};
+
+enum {
+	SNAP_RX_BYTES,
+	SNAP_TX_BYTES,
+	SNAP_RX_PACKETS,
+	SNAP_TX_PACKETS,
+};
+
+struct snapshot {
+	GArray *rows;
+	GHashTable *index_ht;
+	int round;
+};
+
+static void snapshot_sample(const struct netif_sample *sample, gpointer data)
+{
+	struct snapshot *snap = data;
+	struct snapshot_row *row;
+	gpointer pos;
+
+	if (g_hash_table_lookup_extended(snap->index_ht,
+				GUINT_TO_POINTER(sample->ifindex), NULL, &pos)) {
+		row = &g_array_index(snap->rows, struct snapshot_row, GPOINTER_TO_UINT(pos));
+	} else {
+		g_hash_table_insert(snap->index_ht, GUINT_TO_POINTER(sample->ifindex),
+				GUINT_TO_POINTER(snap->rows->len));
+		g_array_set_size(snap->rows, snap->rows->len + 1);
+		row = &g_array_index(snap->rows, struct snapshot_row, snap->rows->len - 1);
+		row->ifindex = sample->ifindex;
+	}
+
+	if (sample->ifname)
+		g_strlcpy(row->ifname, sample->ifname, sizeof(row->ifname));
+
+	row->counters[snap->round][SNAP_RX_BYTES] = sample->rx_bytes;
+	row->counters[snap->round][SNAP_TX_BYTES] = sample->tx_bytes;
+	row->counters[snap->round][SNAP_RX_PACKETS] = sample->rx_packets;
+	row->counters[snap->round][SNAP_TX_PACKETS] = sample->tx_packets;
+	row->seen[snap->round] = true;
+}
+
+static gint64 timespec_nsec(const struct timespec *ts)
+{
+	return (gint64)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+static guint64 snapshot_rate(const struct snapshot_row *row, int counter, gint64 interval_ns)
+{
+	guint64 delta = row->counters[1][counter] - row->counters[0][counter];
+
+	return (guint64)((double)delta * 1e9 / (double)interval_ns + 0.5);
+}
+
+static void json_write_string(FILE *out, const char *str)
+{
+	fputc('"', out);
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			fprintf(out, "\\%c", *str);
+		else if ((unsigned char)*str < 0x20)
+			fprintf(out, "\\u%04x", *str);
+		else
+			fputc(*str, out);
+	}
+	fputc('"', out);
+}
+
+/* RFC 4180: quote fields holding a separator, quote or line break */
+static void csv_write_string(FILE *out, const char *str)
+{
+	if (!strpbrk(str, ",\"\r\n")) {
+		fputs(str, out);
+		return;
+	}
+
+	fputc('"', out);
+	for (; *str; str++) {
+		if (*str == '"')
+			fputc('"', out);
+		fputc(*str, out);
+	}
+	fputc('"', out);
+}
+
+/* The cost columns repeat the second dump's on every row */
+static void snapshot_write_csv(struct snapshot *snap, gint64 timestamp,
+		gint64 interval_ns, const struct netif_source_stats *dump, FILE *out)
+{
+	fputs("timestamp_us,interval_us,ifindex,ifname,rx_bytes,tx_bytes,rx_packets,tx_packets,"
+			"rx_rate,tx_rate,rx_pps,tx_pps,"
+			"dump_us,read_us,parse_us,dump_bytes,dump_messages\n", out);
+
+	for (guint i = 0; i < snap->rows->len; i++) {
+		struct snapshot_row *row = &g_array_index(snap->rows, struct snapshot_row, i);
+
+		if (!row->seen[0] || !row->seen[1])
+			continue;
+
+		fprintf(out, "%"PRId64",%"PRId64",%u,", timestamp, interval_ns / 1000,
+				row->ifindex);
+		csv_write_string(out, row->ifname);
+		fprintf(out, ",%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64
+				",%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64
+				",%"PRId64",%"PRId64",%"PRId64",%"PRIu64",%u\n",
+				row->counters[1][SNAP_RX_BYTES], row->counters[1][SNAP_TX_BYTES],
+				row->counters[1][SNAP_RX_PACKETS], row->counters[1][SNAP_TX_PACKETS],
+				snapshot_rate(row, SNAP_RX_BYTES, interval_ns),
+				snapshot_rate(row, SNAP_TX_BYTES, interval_ns),
+				snapshot_rate(row, SNAP_RX_PACKETS, interval_ns),
+				snapshot_rate(row, SNAP_TX_PACKETS, interval_ns),
+				dump->dump_ns / 1000, dump->read_ns / 1000, dump->parse_ns / 1000,
+				dump->bytes, dump->messages);
+	}
+}
+
+static void snapshot_write_json(struct snapshot *snap, gint64 timestamp,
+		gint64 interval_ns, const struct netif_source_stats *dump, FILE *out)
+{
+	bool first = true;
+
+	fprintf(out, "{\"timestamp_us\":%"PRId64",\"interval_us\":%"PRId64
+			",\"dump\":{\"dump_us\":%"PRId64",\"read_us\":%"PRId64
+			",\"parse_us\":%"PRId64",\"bytes\":%"PRIu64",\"messages\":%u}"
+			",\"interfaces\":[",
+			timestamp, interval_ns / 1000,
+			dump->dump_ns / 1000, dump->read_ns / 1000, dump->parse_ns / 1000,
+			dump->bytes, dump->messages);
+
+	for (guint i = 0; i < snap->rows->len; i++) {
+		struct snapshot_row *row = &g_array_index(snap->rows, struct snapshot_row, i);
+
+		if (!row->seen[0] || !row->seen[1])
+			continue;
+
+		fprintf(out, "%s\n{\"ifindex\":%u,\"ifname\":", first ? "" : ",", row->ifindex);
+		json_write_string(out, row->ifname);
+		fprintf(out, ",\"rx_bytes\":%"PRIu64",\"tx_bytes\":%"PRIu64
+				",\"rx_packets\":%"PRIu64",\"tx_packets\":%"PRIu64
+				",\"rx_rate\":%"PRIu64",\"tx_rate\":%"PRIu64
+				",\"rx_pps\":%"PRIu64",\"tx_pps\":%"PRIu64"}",
+				row->counters[1][SNAP_RX_BYTES], row->counters[1][SNAP_TX_BYTES],
+				row->counters[1][SNAP_RX_PACKETS], row->counters[1][SNAP_TX_PACKETS],
+				snapshot_rate(row, SNAP_RX_BYTES, interval_ns),
+				snapshot_rate(row, SNAP_TX_BYTES, interval_ns),
+				snapshot_rate(row, SNAP_RX_PACKETS, interval_ns),
+				snapshot_rate(row, SNAP_TX_PACKETS, interval_ns));
+		first = false;
+	}
+
+	fputs("\n]}\n", out);
+}
+
+int netif_snapshot_format_parse(const char *name, enum netif_snapshot_format *format)
+{
+	if (!name || g_ascii_strcasecmp(name, "csv") == 0)
+		*format = NETIF_SNAPSHOT_CSV;
+	else if (g_ascii_strcasecmp(name, "json") == 0)
+		*format = NETIF_SNAPSHOT_JSON;
+	else
+		return -EINVAL;
+
+	return 0;
+}
+
+int netif_snapshot_write(const char *source_spec, guint interval_ms,
+		enum netif_snapshot_format format, FILE *out)
+{
+	struct snapshot snap = { 0 };
+	struct netif_source *src;
+	struct timespec start[2], deadline;
+	gint64 timestamp, interval_ns;
+	int err;
+
+	err = netif_source_open(&src, source_spec, snapshot_sample, &snap);
+	if (err < 0)
+		return err;
+
+	src->timed = true;
+	snap.rows = g_array_sized_new(FALSE, TRUE, sizeof(struct snapshot_row), 256);
+	snap.index_ht = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	/*
+	 * Both dumps walk the interfaces in the same order, so the distance
+	 * between their start times is the interval each counter saw.
+	 */
+	for (snap.round = 0; snap.round < 2; snap.round++) {
+		if (snap.round == 1) {
+			gint64 ns = timespec_nsec(&start[0]) + (gint64)interval_ms * 1000000;
+
+			deadline.tv_sec = ns / 1000000000;
+			deadline.tv_nsec = ns % 1000000000;
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+				;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start[snap.round]);
+		err = netif_source_dump(src);
+		if (err < 0)
+			goto out;
+	}
+
+	timestamp = g_get_real_time();
+	interval_ns = MAX(timespec_nsec(&start[1]) - timespec_nsec(&start[0]), 1);
+
+	if (format == NETIF_SNAPSHOT_JSON)
+		snapshot_write_json(&snap, timestamp, interval_ns, &src->stats, out);
+	else
+		snapshot_write_csv(&snap, timestamp, interval_ns, &src->stats, out);
+
+	err = fflush(out) == 0 ? 0 : -errno;
+
+out:
+	g_hash_table_destroy(snap.index_ht);
+	g_array_unref(snap.rows);
+	netif_source_free(src);
+
+	return err;
+}
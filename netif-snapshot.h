@@ -0,0 +1,23 @@
+#pragma once
+
+#include <glib.h>
+#include <stdio.h>
+
+G_BEGIN_DECLS
+
+enum netif_snapshot_format {
+	NETIF_SNAPSHOT_CSV,
+	NETIF_SNAPSHOT_JSON,
+};
+
+int netif_snapshot_format_parse(const char *name, enum netif_snapshot_format *format);
+
+/*
+ * Take two dumps of @source_spec @interval_ms apart and write counters and
+ * per-second rates of the interfaces present in both to @out, along with
+ * the time and size of the second dump.
+ */
+int netif_snapshot_write(const char *source_spec, guint interval_ms,
+		enum netif_snapshot_format format, FILE *out);
+
+G_END_DECLS
@@ -0,0 +1,190 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <adwaita.h>
+
+#include "netif-softnet-view.h"
+
+#define ROW_HEIGHT	18
+#define CPU_WIDTH	60
+#define COL_WIDTH	100
+#define BAR_WIDTH	120
+#define SUMMARY_HEIGHT	40
+
+enum {
+	COL_PROCESSED,
+	COL_DROPPED,
+	COL_SQUEEZED,
+	COL_RPS,
+	COL_FLOW_LIMIT,
+	COL_BACKLOG,
+	N_COLS,
+};
+
+static const char *const col_titles[N_COLS] = {
+	"processed/s", "dropped/s", "squeezed/s", "rps/s", "flow limit/s", "backlog",
+};
+
+struct _NetifSoftnetView {
+	GtkWidget base;
+
+	/* copy of the last struct netif_softnet read */
+	GArray *cpus;
+	struct netif_softnet_cpu total;
+	guint64 rx_packets_rate;
+};
+
+G_DEFINE_FINAL_TYPE(NetifSoftnetView, netif_softnet_view, GTK_TYPE_WIDGET)
+
+static void softnet_view_text(NetifSoftnetView *self, GtkSnapshot *snapshot,
+		const char *text, float x, float y, const GdkRGBA *color)
+{
+	PangoLayout *layout = gtk_widget_create_pango_layout(GTK_WIDGET(self), text);
+	GdkRGBA fg;
+
+	if (!color) {
+		gtk_widget_get_color(GTK_WIDGET(self), &fg);
+		color = &fg;
+	}
+
+	gtk_snapshot_save(snapshot);
+	gtk_snapshot_translate(snapshot, &GRAPHENE_POINT_INIT(x, y));
+	gtk_snapshot_append_layout(snapshot, layout, color);
+	gtk_snapshot_restore(snapshot);
+
+	g_object_unref(layout);
+}
+
+static void softnet_view_row(NetifSoftnetView *self, GtkSnapshot *snapshot,
+		const struct netif_softnet_cpu *cpu, const char *name, float y)
+{
+	/* drops and squeezes are what this view is for, make them stand out */
+	static const GdkRGBA alert = { 0.88, 0.11, 0.14, 1 };
+	const guint64 val[N_COLS] = {
+		cpu->processed_rate, cpu->dropped_rate, cpu->time_squeeze_rate,
+		cpu->received_rps_rate, cpu->flow_limit_rate, cpu->backlog,
+	};
+
+	softnet_view_text(self, snapshot, name, 0, y, NULL);
+
+	for (int c = 0; c < N_COLS; c++) {
+		char text[24];
+		bool bad = val[c] && c != COL_PROCESSED && c != COL_RPS;
+
+		g_snprintf(text, sizeof(text), "%"G_GUINT64_FORMAT, val[c]);
+		softnet_view_text(self, snapshot, text, CPU_WIDTH + c * COL_WIDTH, y,
+				bad ? &alert : NULL);
+	}
+}
+
+static void netif_softnet_view_snapshot(GtkWidget *widget, GtkSnapshot *snapshot)
+{
+	NetifSoftnetView *self = NETIF_SOFTNET_VIEW(widget);
+	g_autofree char *summary = NULL;
+	float y = SUMMARY_HEIGHT;
+
+	/* the same tick, so a gap between the two is packets lost or not for us */
+	summary = g_strdup_printf("Interfaces rx %"G_GUINT64_FORMAT" packets/s, "
+			"backlog processed %"G_GUINT64_FORMAT"/s, dropped %"G_GUINT64_FORMAT"/s",
+			self->rx_packets_rate, self->total.processed_rate,
+			self->total.dropped_rate);
+	softnet_view_text(self, snapshot, summary, 0, 0, NULL);
+
+	softnet_view_text(self, snapshot, "CPU", 0, y, NULL);
+	for (int c = 0; c < N_COLS; c++)
+		softnet_view_text(self, snapshot, col_titles[c], CPU_WIDTH + c * COL_WIDTH, y, NULL);
+	softnet_view_text(self, snapshot, "share", CPU_WIDTH + N_COLS * COL_WIDTH, y, NULL);
+	y += ROW_HEIGHT;
+
+	for (guint i = 0; i < self->cpus->len; i++, y += ROW_HEIGHT) {
+		const struct netif_softnet_cpu *cpu = &g_array_index(self->cpus,
+				struct netif_softnet_cpu, i);
+		char name[16];
+
+		g_snprintf(name, sizeof(name), "%u", cpu->cpu);
+		softnet_view_row(self, snapshot, cpu, name, y);
+
+		/* an even spread means RPS or RSS is doing its job */
+		if (self->total.processed_rate) {
+			GdkRGBA color = { 0.21, 0.52, 0.89, 1 };
+			float share = (float)cpu->processed_rate / self->total.processed_rate;
+
+			gtk_snapshot_append_color(snapshot, &color,
+					&GRAPHENE_RECT_INIT(CPU_WIDTH + N_COLS * COL_WIDTH, y + 3,
+						share * BAR_WIDTH, ROW_HEIGHT - 6));
+		}
+	}
+
+	softnet_view_row(self, snapshot, &self->total, "all", y);
+}
+
+static void netif_softnet_view_measure(GtkWidget *widget, GtkOrientation orientation,
+		int for_size, int *minimum, int *natural,
+		int *minimum_baseline, int *natural_baseline)
+{
+	NetifSoftnetView *self = NETIF_SOFTNET_VIEW(widget);
+
+	if (orientation == GTK_ORIENTATION_HORIZONTAL)
+		*minimum = *natural = CPU_WIDTH + N_COLS * COL_WIDTH + BAR_WIDTH;
+	else	/* header, CPUs and the total */
+		*minimum = *natural = SUMMARY_HEIGHT + (self->cpus->len + 2) * ROW_HEIGHT;
+}
+
+static void netif_softnet_view_finalize(GObject *object)
+{
+	NetifSoftnetView *self = NETIF_SOFTNET_VIEW(object);
+
+	g_array_unref(self->cpus);
+
+	G_OBJECT_CLASS(netif_softnet_view_parent_class)->finalize(object);
+}
+
+static void netif_softnet_view_class_init(NetifSoftnetViewClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(class);
+	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(class);
+
+	object_class->finalize = netif_softnet_view_finalize;
+
+	widget_class->snapshot = netif_softnet_view_snapshot;
+	widget_class->measure = netif_softnet_view_measure;
+}
+
+static void netif_softnet_view_init(NetifSoftnetView *self)
+{
+	self->cpus = g_array_new(FALSE, TRUE, sizeof(struct netif_softnet_cpu));
+}
+
+GtkWidget *netif_softnet_view_new(void)
+{
+	return g_object_new(NETIF_TYPE_SOFTNET_VIEW, NULL);
+}
+
+void netif_softnet_view_update(NetifSoftnetView *self, const struct netif_softnet *softnet,
+		guint64 rx_packets_rate)
+{
+	guint len = self->cpus->len;
+
+	g_array_set_size(self->cpus, 0);
+	g_array_append_vals(self->cpus, softnet->cpus->data, softnet->cpus->len);
+	self->total = softnet->total;
+	self->rx_packets_rate = rx_packets_rate;
+
+	/* CPUs going on or offline change the height */
+	if (self->cpus->len != len)
+		gtk_widget_queue_resize(GTK_WIDGET(self));
+	else
+		gtk_widget_queue_draw(GTK_WIDGET(self));
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <adwaita.h>
+
+#include "netif-softnet.h"
+
+G_BEGIN_DECLS
+
+#define NETIF_TYPE_SOFTNET_VIEW	(netif_softnet_view_get_type())
+
+G_DECLARE_FINAL_TYPE(NetifSoftnetView, netif_softnet_view, NETIF, SOFTNET_VIEW, GtkWidget)
+
+/*
+ * One row per CPU with its softnet rates, a bar for its share of the
+ * packets processed and a total line next to the interfaces' rx rate.
+ */
+GtkWidget *netif_softnet_view_new(void);
+
+/* Show @softnet as read on the tick that summed @rx_packets_rate */
+void netif_softnet_view_update(NetifSoftnetView *self, const struct netif_softnet *softnet,
+		guint64 rx_packets_rate);
+
+G_END_DECLS
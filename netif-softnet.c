@@ -0,0 +1,166 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "netif-softnet.h"
+
+int netif_softnet_open(struct netif_softnet *softnet)
+{
+	*softnet = (struct netif_softnet){ 0 };
+
+	softnet->fd = open("/proc/net/softnet_stat", O_RDONLY | O_CLOEXEC);
+	if (softnet->fd < 0)
+		return -errno;
+
+	/* a line is 15 fields of 9 bytes on current kernels */
+	softnet->size = 16384;
+	softnet->buf = g_malloc(softnet->size);
+	softnet->cpus = g_array_new(FALSE, TRUE, sizeof(struct netif_softnet_cpu));
+	softnet->prev = g_array_new(FALSE, TRUE, sizeof(struct netif_softnet_cpu));
+
+	return 0;
+}
+
+void netif_softnet_close(struct netif_softnet *softnet)
+{
+	if (softnet->fd >= 0)
+		close(softnet->fd);
+	g_free(softnet->buf);
+	if (softnet->cpus)
+		g_array_unref(softnet->cpus);
+	if (softnet->prev)
+		g_array_unref(softnet->prev);
+	*softnet = (struct netif_softnet){ .fd = -1 };
+}
+
+static guint64 softnet_rate(guint64 cur, guint64 prev, gint64 dt)
+{
+	/* the kernel keeps most of these as unsigned int, let them wrap */
+	return (guint32)(cur - prev) * G_USEC_PER_SEC / dt;
+}
+
+static const struct netif_softnet_cpu *softnet_prev(GArray *prev, guint row, guint cpu)
+{
+	/* rows only shift when a CPU goes on or offline */
+	if (row < prev->len && g_array_index(prev, struct netif_softnet_cpu, row).cpu == cpu)
+		return &g_array_index(prev, struct netif_softnet_cpu, row);
+
+	for (guint i = 0; i < prev->len; i++)
+		if (g_array_index(prev, struct netif_softnet_cpu, i).cpu == cpu)
+			return &g_array_index(prev, struct netif_softnet_cpu, i);
+
+	return NULL;
+}
+
+int netif_softnet_read(struct netif_softnet *softnet, gint64 time)
+{
+	GArray *prev;
+	gint64 dt = time - softnet->time;
+	size_t len = 0;
+	char *p, *end;
+
+	/* a seq_file read stops at about a page, read on until EOF */
+	for (;;) {
+		ssize_t n;
+
+		if (len == softnet->size - 1) {
+			softnet->size *= 2;
+			softnet->buf = g_realloc(softnet->buf, softnet->size);
+		}
+
+		n = pread(softnet->fd, softnet->buf + len, softnet->size - 1 - len, len);
+		if (n < 0)
+			return -errno;
+		if (n == 0)
+			break;
+		len += n;
+	}
+	softnet->buf[len] = '\0';
+
+	/* swap, both arrays keep their allocation across reads */
+	prev = softnet->cpus;
+	softnet->cpus = softnet->prev;
+	softnet->prev = prev;
+	g_array_set_size(softnet->cpus, 0);
+	softnet->total = (struct netif_softnet_cpu){ 0 };
+
+	for (p = softnet->buf; *p; p = end) {
+		struct netif_softnet_cpu cpu = { 0 };
+		const struct netif_softnet_cpu *old;
+		guint64 val[13] = { 0 };
+		guint n = 0;
+
+		end = strchr(p, '\n');
+		if (end)
+			*end++ = '\0';
+		else
+			end = p + strlen(p);
+
+		/* hex fields, older kernels print fewer of them */
+		while (n < G_N_ELEMENTS(val)) {
+			char *next;
+
+			val[n] = g_ascii_strtoull(p, &next, 16);
+			if (next == p)
+				break;
+			p = next;
+			n++;
+		}
+		if (n < 3)
+			continue;
+
+		/* offline CPUs have no line, the id is only printed since 5.10 */
+		cpu.cpu = n > 12 ? val[12] : softnet->cpus->len;
+		cpu.processed = val[0];
+		cpu.dropped = val[1];
+		cpu.time_squeeze = val[2];
+		cpu.received_rps = val[9];
+		cpu.flow_limit = val[10];
+		cpu.backlog = val[11];
+
+		old = softnet_prev(prev, softnet->cpus->len, cpu.cpu);
+		if (old && dt > 0) {
+			cpu.processed_rate = softnet_rate(cpu.processed, old->processed, dt);
+			cpu.dropped_rate = softnet_rate(cpu.dropped, old->dropped, dt);
+			cpu.time_squeeze_rate = softnet_rate(cpu.time_squeeze, old->time_squeeze, dt);
+			cpu.received_rps_rate = softnet_rate(cpu.received_rps, old->received_rps, dt);
+			cpu.flow_limit_rate = softnet_rate(cpu.flow_limit, old->flow_limit, dt);
+		}
+
+		softnet->total.processed += cpu.processed;
+		softnet->total.dropped += cpu.dropped;
+		softnet->total.time_squeeze += cpu.time_squeeze;
+		softnet->total.received_rps += cpu.received_rps;
+		softnet->total.flow_limit += cpu.flow_limit;
+		softnet->total.backlog += cpu.backlog;
+		softnet->total.processed_rate += cpu.processed_rate;
+		softnet->total.dropped_rate += cpu.dropped_rate;
+		softnet->total.time_squeeze_rate += cpu.time_squeeze_rate;
+		softnet->total.received_rps_rate += cpu.received_rps_rate;
+		softnet->total.flow_limit_rate += cpu.flow_limit_rate;
+
+		g_array_append_val(softnet->cpus, cpu);
+	}
+
+	softnet->time = time;
+
+	return 0;
+}
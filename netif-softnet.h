@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+
+G_BEGIN_DECLS
+
+/* One row of /proc/net/softnet_stat, the counters are since boot */
+struct netif_softnet_cpu {
+	guint cpu;
+
+	guint64 processed;	/* packets taken off the backlog by NAPI */
+	guint64 dropped;	/* backlog full, netdev_max_backlog */
+	guint64 time_squeeze;	/* net_rx_action ran out of budget or time */
+	guint64 received_rps;	/* IPIs from RPS steering packets here */
+	guint64 flow_limit;	/* dropped by the per-flow limit */
+	guint backlog;		/* queued right now, 5.10 and later */
+
+	/* per second since the previous read, 0 on the first */
+	guint64 processed_rate;
+	guint64 dropped_rate;
+	guint64 time_squeeze_rate;
+	guint64 received_rps_rate;
+	guint64 flow_limit_rate;
+};
+
+/* Per-CPU softnet counters, /proc/net/softnet_stat read into a reused buffer */
+struct netif_softnet {
+	int fd;
+	char *buf;
+	gsize size;
+
+	/* struct netif_softnet_cpu of the online CPUs by row, now and last read */
+	GArray *cpus;
+	GArray *prev;
+	gint64 time;
+
+	/* sums over all CPUs */
+	struct netif_softnet_cpu total;
+};
+
+int netif_softnet_open(struct netif_softnet *softnet);
+void netif_softnet_close(struct netif_softnet *softnet);
+
+/* Read all CPUs and work out rates against the previous read at @time usec */
+int netif_softnet_read(struct netif_softnet *softnet, gint64 time);
+
+G_END_DECLS
@@ -0,0 +1,1120 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include <netlink/socket.h>
+#include <netlink/netlink.h>
+#include <netlink/errno.h>
+#include <netlink/msg.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+#include <linux/mpls.h>
+#include <net/if.h>
+#include <inttypes.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "netif-perf.h"
+#include "netif-source.h"
+
+void netif_source_emit(struct netif_source *src, const struct netif_sample *sample)
+{
+	if (src->record)
+		fprintf(src->record, "%u %s %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64"\n",
+				sample->ifindex, sample->ifname ? sample->ifname : "-",
+				sample->rx_bytes, sample->tx_bytes,
+				sample->rx_packets, sample->tx_packets);
+
+	if (src->func) {
+		gint64 start = src->timed ? netif_perf_now() : 0;
+
+		src->func(sample, src->data);
+		if (src->timed)
+			src->stats.emit_ns += netif_perf_now() - start;
+	}
+}
+
+/* Start of a parse section, see netif_source_parsed() */
+static gint64 netif_source_clock(struct netif_source *src, gint64 *emit_ns)
+{
+	*emit_ns = src->stats.emit_ns;
+
+	return src->timed ? netif_perf_now() : 0;
+}
+
+/* Charge the time since @start, less the sample callbacks in it, to parsing */
+static void netif_source_parsed(struct netif_source *src, gint64 start, gint64 emit_ns)
+{
+	if (src->timed)
+		src->stats.parse_ns += netif_perf_now() - start -
+			(src->stats.emit_ns - emit_ns);
+}
+
+/*
+ * netlink: RTM_GETSTATS dump with IFLA_STATS_LINK_64, plus
+ * IFLA_STATS_LINK_OFFLOAD_XSTATS and IFLA_STATS_AF_SPEC with "netlink:offload"
+ */
+
+/*
+ * Requests per send in dump_links. The kernel queues all the replies
+ * before we read any, so they have to fit the default receive buffer.
+ */
+#define NETLINK_BATCH	64
+
+struct netlink_source {
+	struct nl_sock *nlsock;
+	struct nl_msg *nlmsg;
+	/* non-dump request, ifindex filled in per call */
+	struct nl_msg *link_msg;
+	/* NETLINK_BATCH copies of link_msg, sent at once */
+	void *batch;
+	struct nl_cb *nlcb;
+	int count;
+
+	/* RTM_NEWSTATS carries no name, resolve it without a socket per call */
+	int ioctl_fd;
+};
+
+static const char *netlink_source_ifname(struct netlink_source *nl, guint ifindex,
+		char *ifname)
+{
+	struct ifreq ifr = { .ifr_ifindex = ifindex };
+
+	if (nl->ioctl_fd < 0 || ioctl(nl->ioctl_fd, SIOCGIFNAME, &ifr) < 0)
+		return if_indextoname(ifindex, ifname);
+
+	memcpy(ifname, ifr.ifr_name, IF_NAMESIZE);
+	ifname[IF_NAMESIZE - 1] = '\0';
+
+	return ifname;
+}
+
+static void netlink_parse_rta(struct rtattr **tb, int max, struct rtattr *rta, int rta_len)
+{
+	memset(tb, 0, sizeof(*tb) * (max + 1));
+
+	while (RTA_OK(rta, rta_len)) {
+		unsigned short type = rta->rta_type & NLA_TYPE_MASK;
+
+		if (type <= max && !tb[type])
+			tb[type] = rta;
+
+		rta = RTA_NEXT(rta, rta_len);
+	}
+}
+
+static void netlink_parse_offload(struct netif_sample *sample, struct rtattr *nest)
+{
+	struct rtattr *tb[IFLA_OFFLOAD_XSTATS_MAX + 1];
+	struct rtnl_link_stats64 *cpu;
+
+	netlink_parse_rta(tb, IFLA_OFFLOAD_XSTATS_MAX, RTA_DATA(nest), RTA_PAYLOAD(nest));
+	if (!tb[IFLA_OFFLOAD_XSTATS_CPU_HIT] ||
+	    RTA_PAYLOAD(tb[IFLA_OFFLOAD_XSTATS_CPU_HIT]) < sizeof(*cpu))
+		return;
+
+	cpu = RTA_DATA(tb[IFLA_OFFLOAD_XSTATS_CPU_HIT]);
+	sample->offload = true;
+	sample->cpu_rx_packets = cpu->rx_packets;
+	sample->cpu_tx_packets = cpu->tx_packets;
+	sample->cpu_rx_bytes = cpu->rx_bytes;
+	sample->cpu_tx_bytes = cpu->tx_bytes;
+}
+
+static void netlink_parse_af_spec(struct netif_sample *sample, struct rtattr *nest)
+{
+	struct rtattr *af[AF_MAX + 1];
+	struct rtattr *tb[MPLS_STATS_MAX + 1];
+	struct mpls_link_stats *mpls;
+
+	netlink_parse_rta(af, AF_MAX, RTA_DATA(nest), RTA_PAYLOAD(nest));
+	if (!af[AF_MPLS])
+		return;
+
+	netlink_parse_rta(tb, MPLS_STATS_MAX, RTA_DATA(af[AF_MPLS]), RTA_PAYLOAD(af[AF_MPLS]));
+	if (!tb[MPLS_STATS_LINK] || RTA_PAYLOAD(tb[MPLS_STATS_LINK]) < sizeof(*mpls))
+		return;
+
+	mpls = RTA_DATA(tb[MPLS_STATS_LINK]);
+	sample->mpls = true;
+	sample->mpls_rx_packets = mpls->rx_packets;
+	sample->mpls_tx_packets = mpls->tx_packets;
+}
+
+static int netlink_msg_handler(struct nl_msg *msg, void *arg)
+{
+	struct netif_source *src = arg;
+	struct netlink_source *nl = src->priv;
+	struct rtattr *tb[IFLA_STATS_MAX + 1];
+	struct nlmsghdr *nlmsghdr = nlmsg_hdr(msg);
+	struct rtattr *rta;
+	int rta_len;
+	struct rtnl_link_stats64 *stats;
+	struct if_stats_msg *stats_msg = nlmsg_data(nlmsghdr);
+	char ifname[IF_NAMESIZE];
+	gint64 start, emit_ns;
+
+	src->stats.messages++;
+	src->stats.bytes += nlmsghdr->nlmsg_len;
+
+	if (nlmsghdr->nlmsg_type != RTM_NEWSTATS) {
+		g_warning("%s: received type %d, not %d", __func__,
+				nlmsghdr->nlmsg_type, RTM_NEWSTATS);
+		return NL_SKIP;
+	}
+
+	start = netif_source_clock(src, &emit_ns);
+
+	rta = (void *)nlmsghdr + NLMSG_SPACE(sizeof(struct if_stats_msg));
+	rta_len = NLMSG_PAYLOAD(nlmsghdr, sizeof(struct if_stats_msg));
+	netlink_parse_rta(tb, IFLA_STATS_MAX, rta, rta_len);
+
+	g_assert(tb[IFLA_STATS_LINK_64]);
+	g_assert(tb[IFLA_STATS_LINK_64]->rta_len == RTA_LENGTH(sizeof(*stats)));
+	stats = RTA_DATA(tb[IFLA_STATS_LINK_64]);
+
+	struct netif_sample sample = {
+		.ifindex = stats_msg->ifindex,
+		.ifname = netlink_source_ifname(nl, stats_msg->ifindex, ifname),
+		.rx_packets = stats->rx_packets,
+		.tx_packets = stats->tx_packets,
+		.rx_bytes = stats->rx_bytes,
+		.tx_bytes = stats->tx_bytes,
+	};
+
+	if (tb[IFLA_STATS_LINK_OFFLOAD_XSTATS])
+		netlink_parse_offload(&sample, tb[IFLA_STATS_LINK_OFFLOAD_XSTATS]);
+	if (tb[IFLA_STATS_AF_SPEC])
+		netlink_parse_af_spec(&sample, tb[IFLA_STATS_AF_SPEC]);
+
+	netif_source_emit(src, &sample);
+	nl->count++;
+
+	netif_source_parsed(src, start, emit_ns);
+
+	return NL_OK;
+}
+
+static void netlink_source_close(struct netif_source *src)
+{
+	struct netlink_source *nl = src->priv;
+
+	if (nl->nlmsg)
+		nlmsg_free(nl->nlmsg);
+	if (nl->link_msg)
+		nlmsg_free(nl->link_msg);
+	g_free(nl->batch);
+	if (nl->nlsock) {
+		nl_close(nl->nlsock);
+		nl_socket_free(nl->nlsock);
+	}
+	if (nl->nlcb)
+		nl_cb_put(nl->nlcb);
+	if (nl->ioctl_fd >= 0)
+		close(nl->ioctl_fd);
+
+	g_free(nl);
+}
+
+static int netlink_source_open(struct netif_source *src, const char *arg)
+{
+	struct netlink_source *nl;
+	struct nlmsghdr *nlmsghdr;
+	struct if_stats_msg *stats_msg;
+	bool offload = false;
+	int err;
+
+	if (arg) {
+		if (strcmp(arg, "offload") != 0)
+			return -EINVAL;
+		offload = true;
+	}
+
+	nl = g_new0(struct netlink_source, 1);
+	src->priv = nl;
+	nl->ioctl_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+	nl->nlcb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!nl->nlcb)
+		return -ENOMEM;
+
+	nl_cb_set(nl->nlcb, NL_CB_VALID, NL_CB_CUSTOM, netlink_msg_handler, src);
+
+	nl->nlsock = nl_socket_alloc_cb(nl->nlcb);
+	if (!nl->nlsock)
+		return -ENOMEM;
+
+	err = nl_connect(nl->nlsock, NETLINK_ROUTE);
+	if (err < 0) {
+		g_warning("nl_connect error: %s", nl_geterror(err));
+		return -EIO;
+	}
+
+	nl_socket_set_nonblocking(nl->nlsock);
+	/* a single-link reply must be one datagram, without a trailing ACK */
+	nl_socket_disable_auto_ack(nl->nlsock);
+	nl_socket_set_peer_port(nl->nlsock, 0);
+	nl_socket_set_peer_groups(nl->nlsock, 0);
+
+	nl->nlmsg = nlmsg_alloc();
+	if (!nl->nlmsg)
+		return -ENOMEM;
+
+	nlmsghdr = nlmsg_put(nl->nlmsg, NL_AUTO_PID, NL_AUTO_SEQ, RTM_GETSTATS,
+			sizeof(struct if_stats_msg), NLM_F_REQUEST | NLM_F_DUMP);
+	stats_msg = nlmsg_data(nlmsghdr);
+
+	memset(stats_msg, 0, sizeof(*stats_msg));
+	stats_msg->family = AF_INET;
+	stats_msg->filter_mask = IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64);
+	if (offload)
+		stats_msg->filter_mask |= IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_OFFLOAD_XSTATS) |
+				IFLA_STATS_FILTER_BIT(IFLA_STATS_AF_SPEC);
+
+	nl->link_msg = nlmsg_alloc();
+	if (!nl->link_msg)
+		return -ENOMEM;
+
+	nlmsghdr = nlmsg_put(nl->link_msg, NL_AUTO_PID, NL_AUTO_SEQ, RTM_GETSTATS,
+			sizeof(struct if_stats_msg), NLM_F_REQUEST);
+	memcpy(nlmsg_data(nlmsghdr), stats_msg, sizeof(*stats_msg));
+	nl->batch = g_malloc0(NETLINK_BATCH * NLMSG_ALIGN(nlmsghdr->nlmsg_len));
+
+	return 0;
+}
+
+static int netlink_source_dump(struct netif_source *src)
+{
+	struct netlink_source *nl = src->priv;
+	struct nlmsghdr *nlmsghdr = nlmsg_hdr(nl->nlmsg);
+
+	nlmsghdr->nlmsg_seq = NL_AUTO_SEQ;
+	int err = nl_send_auto(nl->nlsock, nl->nlmsg);
+	if (err < 0) {
+		g_warning("nl_send_auto error %d\n", err);
+		return -EIO;
+	}
+
+	nl->count = 0;
+	nl_recvmsgs(nl->nlsock, nl->nlcb);
+
+	return nl->count;
+}
+
+/*
+ * Discard the replies still queued after a failed request. Sequence
+ * numbers are not checked, the next dump would parse them as its own.
+ * rtnetlink answers in the sender's context, so all are queued by now.
+ */
+static void netlink_source_drain(struct netlink_source *nl)
+{
+	char buf[64];
+
+	while (recv(nl_socket_get_fd(nl->nlsock), buf, sizeof(buf),
+			MSG_DONTWAIT | MSG_TRUNC) >= 0)
+		;
+}
+
+static int netlink_source_dump_link(struct netif_source *src, guint ifindex)
+{
+	struct netlink_source *nl = src->priv;
+	struct nlmsghdr *nlmsghdr = nlmsg_hdr(nl->link_msg);
+	struct if_stats_msg *stats_msg = nlmsg_data(nlmsghdr);
+
+	stats_msg->ifindex = ifindex;
+	nlmsghdr->nlmsg_seq = NL_AUTO_SEQ;
+	int err = nl_send_auto(nl->nlsock, nl->link_msg);
+	if (err < 0) {
+		g_warning("nl_send_auto error %d\n", err);
+		return -EIO;
+	}
+
+	/* the kernel always answers, don't leave it queued for the next dump */
+	struct pollfd pfd = { .fd = nl_socket_get_fd(nl->nlsock), .events = POLLIN };
+	if (poll(&pfd, 1, 100) <= 0)
+		return -ETIMEDOUT;
+
+	nl->count = 0;
+	err = nl_recvmsgs(nl->nlsock, nl->nlcb);
+	if (err < 0) {
+		netlink_source_drain(nl);
+		return err == -NLE_NODEV ? -ENODEV : -EIO;
+	}
+
+	return nl->count;
+}
+
+static int netlink_source_dump_links(struct netif_source *src, const guint *ifindex,
+		guint n)
+{
+	struct netlink_source *nl = src->priv;
+	struct nlmsghdr *link_hdr = nlmsg_hdr(nl->link_msg);
+	size_t size = NLMSG_ALIGN(link_hdr->nlmsg_len);
+	struct pollfd pfd = { .fd = nl_socket_get_fd(nl->nlsock), .events = POLLIN };
+	int count = 0;
+
+	for (guint i = 0; i < n; i += NETLINK_BATCH) {
+		guint len = MIN(n - i, NETLINK_BATCH);
+		guint replies = 0;
+
+		/* back to back in one datagram, the kernel answers each in turn */
+		for (guint j = 0; j < len; j++) {
+			struct nlmsghdr *nlmsghdr = nl->batch + j * size;
+			struct if_stats_msg *stats_msg = nlmsg_data(nlmsghdr);
+
+			memcpy(nlmsghdr, link_hdr, link_hdr->nlmsg_len);
+			nlmsghdr->nlmsg_pid = nl_socket_get_local_port(nl->nlsock);
+			nlmsghdr->nlmsg_seq = nl_socket_use_seq(nl->nlsock);
+			stats_msg->ifindex = ifindex[i + j];
+		}
+
+		int err = nl_sendto(nl->nlsock, nl->batch, len * size);
+		if (err < 0) {
+			g_warning("nl_sendto error %d\n", err);
+			return -EIO;
+		}
+
+		/* one datagram per reply, an interface gone since is an error reply */
+		while (replies < len) {
+			if (poll(&pfd, 1, 100) <= 0) {
+				netlink_source_drain(nl);
+				return -ETIMEDOUT;
+			}
+
+			nl->count = 0;
+			err = nl_recvmsgs_report(nl->nlsock, nl->nlcb);
+			if (err < 0 && err != -NLE_NODEV) {
+				netlink_source_drain(nl);
+				return -EIO;
+			}
+
+			replies += MAX(err, 1);
+			count += nl->count;
+		}
+	}
+
+	return count;
+}
+
+static const struct netif_source_ops netlink_source_ops = {
+	.name = "netlink",
+	.description = "RTM_GETSTATS dump over rtnetlink, \"netlink:offload\" adds offload xstats",
+	.open = netlink_source_open,
+	.dump = netlink_source_dump,
+	.dump_link = netlink_source_dump_link,
+	.dump_links = netlink_source_dump_links,
+	.close = netlink_source_close,
+};
+
+/*
+ * proc: /proc/net/dev, read with pread into a reused buffer
+ */
+
+struct proc_source {
+	int fd;
+	char *buf;
+	size_t size;
+
+	/*
+	 * ifname -> struct proc_index, /proc/net/dev only carries names. Each
+	 * dump moves the names it sees from index_ht into spare_ht and swaps
+	 * them, so names that are gone drop out.
+	 */
+	GHashTable *index_ht;
+	GHashTable *spare_ht;
+};
+
+struct proc_index {
+	guint ifindex;
+	/* line in the file, interfaces are listed in creation order */
+	guint line;
+};
+
+static void proc_source_close(struct netif_source *src)
+{
+	struct proc_source *proc = src->priv;
+
+	if (proc->fd >= 0)
+		close(proc->fd);
+	if (proc->index_ht)
+		g_hash_table_destroy(proc->index_ht);
+	if (proc->spare_ht)
+		g_hash_table_destroy(proc->spare_ht);
+	g_free(proc->buf);
+	g_free(proc);
+}
+
+static int proc_source_open(struct netif_source *src, const char *arg)
+{
+	struct proc_source *proc = g_new0(struct proc_source, 1);
+
+	src->priv = proc;
+
+	proc->fd = open(arg ? arg : "/proc/net/dev", O_RDONLY | O_CLOEXEC);
+	if (proc->fd < 0)
+		return -errno;
+
+	proc->size = 16384;
+	proc->buf = g_malloc(proc->size);
+	proc->index_ht = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	proc->spare_ht = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+	return 0;
+}
+
+/*
+ * A name seen on the same line as in the last dump keeps its ifindex. One
+ * that moved was renamed, recreated or had interfaces before it come or
+ * go, so look it up again.
+ */
+static guint proc_source_ifindex(struct proc_source *proc, const char *ifname,
+		guint line)
+{
+	struct proc_index *index;
+	char *key;
+
+	if (g_hash_table_steal_extended(proc->index_ht, ifname,
+			(gpointer *)&key, (gpointer *)&index)) {
+		if (index->line != line || !index->ifindex) {
+			index->ifindex = if_nametoindex(ifname);
+			index->line = line;
+		}
+	} else {
+		key = g_strdup(ifname);
+		index = g_new(struct proc_index, 1);
+		index->ifindex = if_nametoindex(ifname);
+		index->line = line;
+	}
+
+	g_hash_table_insert(proc->spare_ht, key, index);
+
+	return index->ifindex;
+}
+
+static int proc_source_dump(struct netif_source *src)
+{
+	struct proc_source *proc = src->priv;
+	GHashTable *index_ht;
+	size_t len = 0;
+	char *p, *end;
+	gint64 start, emit_ns;
+	guint line = 0;
+	int count = 0;
+
+	/* a seq_file read stops at about a page, read on until EOF */
+	for (;;) {
+		ssize_t n;
+
+		if (len == proc->size - 1) {
+			proc->size *= 2;
+			proc->buf = g_realloc(proc->buf, proc->size);
+		}
+
+		n = pread(proc->fd, proc->buf + len, proc->size - 1 - len, len);
+		if (n < 0)
+			return -errno;
+		if (n == 0)
+			break;
+		len += n;
+	}
+	proc->buf[len] = '\0';
+	src->stats.bytes = len;
+
+	start = netif_source_clock(src, &emit_ns);
+
+	/* skip the two header lines */
+	p = proc->buf;
+	for (int i = 0; i < 2 && p; i++) {
+		p = strchr(p, '\n');
+		if (p)
+			p++;
+	}
+
+	for (; p && *p; p = end) {
+		struct netif_sample sample = { 0 };
+		guint64 val[16];
+		char *name, *colon;
+
+		end = strchr(p, '\n');
+		if (end)
+			*end++ = '\0';
+		src->stats.messages++;
+
+		colon = strchr(p, ':');
+		if (!colon)
+			continue;
+		*colon = '\0';
+
+		name = p;
+		while (*name == ' ')
+			name++;
+
+		p = colon + 1;
+		for (int i = 0; i < 16; i++)
+			val[i] = g_ascii_strtoull(p, &p, 10);
+
+		/* rx: bytes packets errs drop fifo frame compressed multicast, tx: ... */
+		sample.ifindex = proc_source_ifindex(proc, name, line++);
+		sample.ifname = name;
+		sample.rx_bytes = val[0];
+		sample.rx_packets = val[1];
+		sample.tx_bytes = val[8];
+		sample.tx_packets = val[9];
+
+		if (!sample.ifindex)
+			continue;
+
+		netif_source_emit(src, &sample);
+		count++;
+	}
+
+	index_ht = proc->index_ht;
+	g_hash_table_remove_all(index_ht);
+	proc->index_ht = proc->spare_ht;
+	proc->spare_ht = index_ht;
+
+	netif_source_parsed(src, start, emit_ns);
+
+	return count;
+}
+
+static const struct netif_source_ops proc_source_ops = {
+	.name = "proc",
+	.description = "/proc/net/dev text table",
+	.open = proc_source_open,
+	.dump = proc_source_dump,
+	.close = proc_source_close,
+};
+
+/*
+ * sysfs: /sys/class/net/<ifname>/statistics/<counter>, one fd kept open
+ * per counter and re-read with pread
+ */
+
+#define SYSFS_NET	"/sys/class/net"
+
+enum {
+	SYSFS_RX_BYTES,
+	SYSFS_TX_BYTES,
+	SYSFS_RX_PACKETS,
+	SYSFS_TX_PACKETS,
+	SYSFS_NR_COUNTERS,
+};
+
+static const char *const sysfs_counter_names[SYSFS_NR_COUNTERS] = {
+	[SYSFS_RX_BYTES] = "rx_bytes",
+	[SYSFS_TX_BYTES] = "tx_bytes",
+	[SYSFS_RX_PACKETS] = "rx_packets",
+	[SYSFS_TX_PACKETS] = "tx_packets",
+};
+
+struct sysfs_link {
+	char ifname[IF_NAMESIZE];
+	guint ifindex;
+	int fd[SYSFS_NR_COUNTERS];
+	guint64 generation;
+};
+
+struct sysfs_source {
+	GHashTable *link_ht;
+	guint64 generation;
+};
+
+static void sysfs_link_free(gpointer data)
+{
+	struct sysfs_link *link = data;
+
+	for (int i = 0; i < SYSFS_NR_COUNTERS; i++)
+		if (link->fd[i] >= 0)
+			close(link->fd[i]);
+	g_free(link);
+}
+
+/* Returns the length read or -errno */
+static int sysfs_read_u64(int fd, guint64 *val)
+{
+	char buf[32];
+	ssize_t len = pread(fd, buf, sizeof(buf) - 1, 0);
+
+	if (len <= 0)
+		return -errno;
+
+	buf[len] = '\0';
+	*val = g_ascii_strtoull(buf, NULL, 10);
+
+	return len;
+}
+
+static struct sysfs_link *sysfs_link_new(int dirfd, const char *ifname)
+{
+	struct sysfs_link *link = g_new0(struct sysfs_link, 1);
+	char path[IF_NAMESIZE + 32];
+	guint64 ifindex = 0;
+	int fd;
+
+	g_strlcpy(link->ifname, ifname, sizeof(link->ifname));
+	for (int i = 0; i < SYSFS_NR_COUNTERS; i++)
+		link->fd[i] = -1;
+
+	snprintf(path, sizeof(path), "%s/ifindex", ifname);
+	fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0 || sysfs_read_u64(fd, &ifindex) < 0 || !ifindex) {
+		if (fd >= 0)
+			close(fd);
+		sysfs_link_free(link);
+		return NULL;
+	}
+	close(fd);
+	link->ifindex = ifindex;
+
+	for (int i = 0; i < SYSFS_NR_COUNTERS; i++) {
+		snprintf(path, sizeof(path), "%s/statistics/%s",
+				ifname, sysfs_counter_names[i]);
+		link->fd[i] = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+		if (link->fd[i] < 0) {
+			sysfs_link_free(link);
+			return NULL;
+		}
+	}
+
+	return link;
+}
+
+static void sysfs_source_close(struct netif_source *src)
+{
+	struct sysfs_source *sysfs = src->priv;
+
+	if (sysfs->link_ht)
+		g_hash_table_destroy(sysfs->link_ht);
+	g_free(sysfs);
+}
+
+static int sysfs_source_open(struct netif_source *src, const char *arg)
+{
+	struct sysfs_source *sysfs = g_new0(struct sysfs_source, 1);
+
+	src->priv = sysfs;
+	sysfs->link_ht = g_hash_table_new_full(g_str_hash, g_str_equal,
+			NULL, sysfs_link_free);
+
+	if (access(SYSFS_NET, R_OK) < 0)
+		return -errno;
+
+	return 0;
+}
+
+static gboolean sysfs_link_stale(gpointer key, gpointer value, gpointer data)
+{
+	struct sysfs_link *link = value;
+	struct sysfs_source *sysfs = data;
+
+	return link->generation != sysfs->generation;
+}
+
+static int sysfs_source_dump(struct netif_source *src)
+{
+	struct sysfs_source *sysfs = src->priv;
+	struct dirent *dent;
+	int count = 0;
+	DIR *dir;
+
+	dir = opendir(SYSFS_NET);
+	if (!dir)
+		return -errno;
+
+	sysfs->generation++;
+
+	while ((dent = readdir(dir))) {
+		struct netif_sample sample = { 0 };
+		guint64 val[SYSFS_NR_COUNTERS];
+		struct sysfs_link *link;
+		int i;
+
+		if (dent->d_name[0] == '.')
+			continue;
+
+		link = g_hash_table_lookup(sysfs->link_ht, dent->d_name);
+		if (!link) {
+			link = sysfs_link_new(dirfd(dir), dent->d_name);
+			if (!link)
+				continue;
+			g_hash_table_insert(sysfs->link_ht, link->ifname, link);
+		}
+
+		for (i = 0; i < SYSFS_NR_COUNTERS; i++) {
+			int len = sysfs_read_u64(link->fd[i], &val[i]);
+
+			if (len < 0)
+				break;
+			src->stats.messages++;
+			src->stats.bytes += len;
+		}
+
+		/* the device went away under an open fd, reopen on next dump */
+		if (i < SYSFS_NR_COUNTERS) {
+			g_hash_table_remove(sysfs->link_ht, dent->d_name);
+			continue;
+		}
+
+		link->generation = sysfs->generation;
+
+		sample.ifindex = link->ifindex;
+		sample.ifname = link->ifname;
+		sample.rx_bytes = val[SYSFS_RX_BYTES];
+		sample.tx_bytes = val[SYSFS_TX_BYTES];
+		sample.rx_packets = val[SYSFS_RX_PACKETS];
+		sample.tx_packets = val[SYSFS_TX_PACKETS];
+
+		netif_source_emit(src, &sample);
+		count++;
+	}
+
+	closedir(dir);
+
+	g_hash_table_foreach_remove(sysfs->link_ht, sysfs_link_stale, sysfs);
+
+	return count;
+}
+
+static const struct netif_source_ops sysfs_source_ops = {
+	.name = "sysfs",
+	.description = "/sys/class/net/*/statistics files",
+	.open = sysfs_source_open,
+	.dump = sysfs_source_dump,
+	.close = sysfs_source_close,
+};
+
+/*
+ * file: replay of a recording made with netif_source_record(). Every dump
+ * consumes one "@<usec>" frame and the file is looped at EOF.
+ *
+ *   @1700000000000000
+ *   <ifindex> <ifname> <rx_bytes> <tx_bytes> <rx_packets> <tx_packets>
+ */
+
+struct file_source {
+	FILE *fp;
+	char *line;
+	size_t cap;
+	bool pending;
+};
+
+static void file_source_close(struct netif_source *src)
+{
+	struct file_source *file = src->priv;
+
+	if (file->fp)
+		fclose(file->fp);
+	free(file->line);
+	g_free(file);
+}
+
+static int file_source_open(struct netif_source *src, const char *arg)
+{
+	struct file_source *file = g_new0(struct file_source, 1);
+
+	src->priv = file;
+
+	if (!arg)
+		return -EINVAL;
+
+	file->fp = fopen(arg, "re");
+	if (!file->fp)
+		return -errno;
+
+	return 0;
+}
+
+static int file_source_dump(struct netif_source *src)
+{
+	struct file_source *file = src->priv;
+	bool rewound = false;
+	gint64 start, emit_ns;
+	ssize_t len;
+	int count = 0;
+
+	while (!file->pending) {
+		if (getline(&file->line, &file->cap, file->fp) < 0) {
+			if (rewound)
+				return -ENODATA;
+			rewind(file->fp);
+			rewound = true;
+			continue;
+		}
+
+		if (file->line[0] == '@')
+			file->pending = true;
+	}
+	file->pending = false;
+
+	/* replayed from the page cache, there is no kernel side to speak of */
+	start = netif_source_clock(src, &emit_ns);
+
+	while ((len = getline(&file->line, &file->cap, file->fp)) >= 0) {
+		struct netif_sample sample = { 0 };
+		char ifname[IF_NAMESIZE];
+
+		if (file->line[0] == '@') {
+			file->pending = true;
+			break;
+		}
+
+		src->stats.messages++;
+		src->stats.bytes += len;
+
+		if (sscanf(file->line, "%u %15s %"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64,
+					&sample.ifindex, ifname,
+					&sample.rx_bytes, &sample.tx_bytes,
+					&sample.rx_packets, &sample.tx_packets) != 6)
+			continue;
+
+		sample.ifname = ifname;
+		netif_source_emit(src, &sample);
+		count++;
+	}
+
+	netif_source_parsed(src, start, emit_ns);
+
+	return count;
+}
+
+static const struct netif_source_ops file_source_ops = {
+	.name = "file",
+	.description = "replay of a --record file, \"file:PATH\"",
+	.open = file_source_open,
+	.dump = file_source_dump,
+	.close = file_source_close,
+};
+
+static const struct netif_source_ops *const netif_sources[] = {
+	&netlink_source_ops,
+	&proc_source_ops,
+	&sysfs_source_ops,
+	&file_source_ops,
+};
+
+int netif_source_open(struct netif_source **srcp, const char *spec,
+		netif_sample_func func, gpointer data)
+{
+	const struct netif_source_ops *ops = NULL;
+	const char *arg = NULL;
+	g_autofree char *name = NULL;
+	struct netif_source *src;
+	int err;
+
+	if (!spec)
+		spec = "netlink";
+
+	arg = strchr(spec, ':');
+	if (arg)
+		name = g_strndup(spec, arg++ - spec);
+	else
+		name = g_strdup(spec);
+
+	for (guint i = 0; i < G_N_ELEMENTS(netif_sources); i++) {
+		if (strcmp(netif_sources[i]->name, name) == 0) {
+			ops = netif_sources[i];
+			break;
+		}
+	}
+
+	if (!ops)
+		return -ENOENT;
+
+	src = g_new0(struct netif_source, 1);
+	src->ops = ops;
+	src->func = func;
+	src->data = data;
+
+	err = ops->open(src, arg);
+	if (err < 0) {
+		netif_source_free(src);
+		return err;
+	}
+
+	*srcp = src;
+
+	return 0;
+}
+
+void netif_source_free(struct netif_source *src)
+{
+	if (src->priv)
+		src->ops->close(src);
+	if (src->record)
+		fclose(src->record);
+	g_free(src);
+}
+
+int netif_source_dump(struct netif_source *src)
+{
+	struct netif_source_stats *stats = &src->stats;
+	gint64 start = netif_perf_now();
+	int count;
+
+	*stats = (struct netif_source_stats){ 0 };
+
+	if (src->record)
+		fprintf(src->record, "@%"PRId64"\n", g_get_real_time());
+
+	count = src->ops->dump(src);
+
+	stats->dump_ns = netif_perf_now() - start;
+	if (src->timed)
+		stats->read_ns = MAX(stats->dump_ns - stats->parse_ns - stats->emit_ns, 0);
+
+	if (src->record)
+		fflush(src->record);
+
+	return count;
+}
+
+int netif_source_dump_link(struct netif_source *src, guint ifindex)
+{
+	struct netif_source_stats stats = src->stats;
+	FILE *record = src->record;
+	int count;
+
+	if (!src->ops->dump_link)
+		return -EOPNOTSUPP;
+
+	/* a recording holds complete dumps only, and so do the stats */
+	src->record = NULL;
+	count = src->ops->dump_link(src, ifindex);
+	src->record = record;
+	src->stats = stats;
+
+	return count;
+}
+
+int netif_source_dump_links(struct netif_source *src, const guint *ifindex, guint n)
+{
+	struct netif_source_stats *stats = &src->stats;
+	FILE *record = src->record;
+	gint64 start = netif_perf_now();
+	int count;
+
+	if (!src->ops->dump_links)
+		return -EOPNOTSUPP;
+
+	*stats = (struct netif_source_stats){ 0 };
+
+	/* a recording holds complete dumps only */
+	src->record = NULL;
+	count = src->ops->dump_links(src, ifindex, n);
+	src->record = record;
+
+	stats->dump_ns = netif_perf_now() - start;
+	if (src->timed)
+		stats->read_ns = MAX(stats->dump_ns - stats->parse_ns - stats->emit_ns, 0);
+
+	return count;
+}
+
+int netif_source_record(struct netif_source *src, const char *path)
+{
+	FILE *fp = fopen(path, "ae");
+
+	if (!fp)
+		return -errno;
+
+	if (src->record)
+		fclose(src->record);
+	src->record = fp;
+
+	return 0;
+}
+
+void netif_source_list(FILE *out)
+{
+	for (guint i = 0; i < G_N_ELEMENTS(netif_sources); i++)
+		fprintf(out, "  %-10s %s\n", netif_sources[i]->name,
+				netif_sources[i]->description);
+}
+
+static gint64 timeval_usec(const struct timeval *tv)
+{
+	return (gint64)tv->tv_sec * G_USEC_PER_SEC + tv->tv_usec;
+}
+
+/*
+ * Dump every live backend @iterations times and report the wall clock
+ * latency and the user/system CPU time charged to this process per dump.
+ * Kernel work done on behalf of a dump runs in our syscall context, so it
+ * shows up as system time.
+ */
+int netif_source_compare(FILE *out, guint iterations)
+{
+	if (iterations == 0)
+		iterations = 1;
+
+	fprintf(out, "%-10s %8s %10s %10s %10s %10s %10s\n", "source", "ifaces",
+			"avg(us)", "min(us)", "max(us)", "user(us)", "sys(us)");
+
+	for (guint i = 0; i < G_N_ELEMENTS(netif_sources); i++) {
+		const struct netif_source_ops *ops = netif_sources[i];
+		struct netif_source *src;
+		struct rusage ru0, ru1;
+		gint64 total = 0, min = G_MAXINT64, max = 0;
+		int count, err;
+
+		if (ops == &file_source_ops)
+			continue;
+
+		err = netif_source_open(&src, ops->name, NULL, NULL);
+		if (err < 0) {
+			fprintf(out, "%-10s unavailable: %s\n", ops->name, g_strerror(-err));
+			continue;
+		}
+
+		/* warm up caches, fds and socket buffers */
+		count = netif_source_dump(src);
+
+		getrusage(RUSAGE_SELF, &ru0);
+		for (guint n = 0; n < iterations && count >= 0; n++) {
+			gint64 start = g_get_monotonic_time();
+			gint64 delta;
+
+			count = netif_source_dump(src);
+
+			delta = g_get_monotonic_time() - start;
+			total += delta;
+			min = MIN(min, delta);
+			max = MAX(max, delta);
+		}
+		getrusage(RUSAGE_SELF, &ru1);
+
+		netif_source_free(src);
+
+		if (count < 0) {
+			fprintf(out, "%-10s dump failed: %s\n", ops->name, g_strerror(-count));
+			continue;
+		}
+
+		fprintf(out, "%-10s %8d %10.1f %10"G_GINT64_FORMAT" %10"G_GINT64_FORMAT" %10.1f %10.1f\n",
+				ops->name, count, (double)total / iterations, min, max,
+				(double)(timeval_usec(&ru1.ru_utime) - timeval_usec(&ru0.ru_utime)) / iterations,
+				(double)(timeval_usec(&ru1.ru_stime) - timeval_usec(&ru0.ru_stime)) / iterations);
+	}
+
+	return 0;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+G_BEGIN_DECLS
+
+struct netif_sample {
+	guint ifindex;
+	const char *ifname;
+
+	guint64 rx_packets;
+	guint64 tx_packets;
+	guint64 rx_bytes;
+	guint64 tx_bytes;
+
+	/* IFLA_OFFLOAD_XSTATS_CPU_HIT, traffic that took the software path */
+	bool offload;
+	guint64 cpu_rx_packets;
+	guint64 cpu_tx_packets;
+	guint64 cpu_rx_bytes;
+	guint64 cpu_tx_bytes;
+
+	/* IFLA_STATS_AF_SPEC MPLS_STATS_LINK */
+	bool mpls;
+	guint64 mpls_rx_packets;
+	guint64 mpls_tx_packets;
+};
+
+typedef void (*netif_sample_func)(const struct netif_sample *sample, gpointer data);
+
+/* Cost of the last netif_source_dump(), all times in nsec */
+struct netif_source_stats {
+	/* netlink messages, lines or files read, and their size */
+	guint messages;
+	guint64 bytes;
+
+	gint64 dump_ns;
+	/* the rest of dump_ns is read_ns, only measured while timed is set */
+	gint64 parse_ns;
+	gint64 emit_ns;
+	gint64 read_ns;
+};
+
+struct netif_source;
+
+struct netif_source_ops {
+	const char *name;
+	const char *description;
+
+	int (*open)(struct netif_source *src, const char *arg);
+	int (*dump)(struct netif_source *src);
+	/* optional, one sample for @ifindex */
+	int (*dump_link)(struct netif_source *src, guint ifindex);
+	/* optional, one sample each for @n interfaces, batched */
+	int (*dump_links)(struct netif_source *src, const guint *ifindex, guint n);
+	void (*close)(struct netif_source *src);
+};
+
+struct netif_source {
+	const struct netif_source_ops *ops;
+	void *priv;
+
+	netif_sample_func func;
+	gpointer data;
+
+	FILE *record;
+
+	/* split dump_ns into read, parse and sample callback time */
+	bool timed;
+	struct netif_source_stats stats;
+};
+
+/*
+ * A source spec is a backend name optionally followed by ':' and a
+ * backend argument, e.g. "netlink", "netlink:offload", "proc", "sysfs"
+ * or "file:/tmp/rec".
+ */
+int netif_source_open(struct netif_source **srcp, const char *spec,
+		netif_sample_func func, gpointer data);
+void netif_source_free(struct netif_source *src);
+
+/* Deliver one sample per interface, returns the count or -errno */
+int netif_source_dump(struct netif_source *src);
+
+/* Deliver the sample of a single interface, -EOPNOTSUPP if the backend can't */
+int netif_source_dump_link(struct netif_source *src, guint ifindex);
+
+/*
+ * Deliver the samples of @n interfaces in place of a full dump, counted in
+ * the stats but not recorded. -EOPNOTSUPP if the backend can't.
+ */
+int netif_source_dump_links(struct netif_source *src, const guint *ifindex, guint n);
+
+void netif_source_emit(struct netif_source *src, const struct netif_sample *sample);
+
+/* Append every dump to @path in the format read back by the "file" source */
+int netif_source_record(struct netif_source *src, const char *path);
+
+void netif_source_list(FILE *out);
+int netif_source_compare(FILE *out, guint iterations);
+
+G_END_DECLS
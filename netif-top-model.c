@@ -0,0 +1,296 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gio/gio.h>
+
+#include "netif-top-model.h"
+
+struct netif_top_entry {
+	gpointer item;
+	guint64 key;
+	guint rank;
+};
+
+struct _NetifTopModel {
+	GObject base;
+
+	GType item_type;
+	NetifTopItemFunc item_func;
+	guint limit;
+
+	/* min-heap of the best @limit candidates seen in the current round */
+	struct netif_top_entry *heap;
+	guint heap_len;
+	GHashTable *heap_pos;
+
+	/* published ranking, best first */
+	GPtrArray *items;
+};
+
+static void netif_top_model_list_model_init(GListModelInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE(NetifTopModel, netif_top_model, G_TYPE_OBJECT,
+		G_IMPLEMENT_INTERFACE(G_TYPE_LIST_MODEL, netif_top_model_list_model_init))
+
+static GType netif_top_model_get_item_type(GListModel *list)
+{
+	return NETIF_TOP_MODEL(list)->item_type;
+}
+
+static guint netif_top_model_get_n_items(GListModel *list)
+{
+	return NETIF_TOP_MODEL(list)->items->len;
+}
+
+static gpointer netif_top_model_get_item(GListModel *list, guint position)
+{
+	NetifTopModel *self = NETIF_TOP_MODEL(list);
+
+	if (position >= self->items->len)
+		return NULL;
+
+	return self->item_func(g_ptr_array_index(self->items, position));
+}
+
+static void netif_top_model_list_model_init(GListModelInterface *iface)
+{
+	iface->get_item_type = netif_top_model_get_item_type;
+	iface->get_n_items = netif_top_model_get_n_items;
+	iface->get_item = netif_top_model_get_item;
+}
+
+/* heap_pos stores index + 1 so that a missing item reads as 0 */
+static void heap_set(NetifTopModel *self, guint i, const struct netif_top_entry *entry)
+{
+	self->heap[i] = *entry;
+	g_hash_table_insert(self->heap_pos, entry->item, GUINT_TO_POINTER(i + 1));
+}
+
+static void heap_sift_up(NetifTopModel *self, guint i)
+{
+	struct netif_top_entry entry = self->heap[i];
+
+	while (i > 0) {
+		guint parent = (i - 1) / 2;
+
+		if (self->heap[parent].key <= entry.key)
+			break;
+
+		heap_set(self, i, &self->heap[parent]);
+		i = parent;
+	}
+
+	heap_set(self, i, &entry);
+}
+
+static void heap_sift_down(NetifTopModel *self, guint i)
+{
+	struct netif_top_entry entry = self->heap[i];
+
+	for (;;) {
+		guint child = 2 * i + 1;
+
+		if (child >= self->heap_len)
+			break;
+		if (child + 1 < self->heap_len &&
+				self->heap[child + 1].key < self->heap[child].key)
+			child++;
+		if (entry.key <= self->heap[child].key)
+			break;
+
+		heap_set(self, i, &self->heap[child]);
+		i = child;
+	}
+
+	heap_set(self, i, &entry);
+}
+
+static void heap_remove(NetifTopModel *self, guint i)
+{
+	g_hash_table_remove(self->heap_pos, self->heap[i].item);
+
+	if (--self->heap_len == i)
+		return;
+
+	heap_set(self, i, &self->heap[self->heap_len]);
+	heap_sift_down(self, i);
+	heap_sift_up(self, i);
+}
+
+void netif_top_model_begin(NetifTopModel *self)
+{
+	self->heap_len = 0;
+	g_hash_table_remove_all(self->heap_pos);
+}
+
+void netif_top_model_update(NetifTopModel *self, gpointer item, guint64 key)
+{
+	guint pos = GPOINTER_TO_UINT(g_hash_table_lookup(self->heap_pos, item));
+	struct netif_top_entry entry = { .item = item, .key = key };
+
+	if (self->limit == 0)
+		return;
+
+	if (pos) {
+		guint64 old = self->heap[pos - 1].key;
+
+		self->heap[pos - 1].key = key;
+		if (key < old)
+			heap_sift_up(self, pos - 1);
+		else
+			heap_sift_down(self, pos - 1);
+	} else if (self->heap_len < self->limit) {
+		self->heap[self->heap_len++] = entry;
+		heap_sift_up(self, self->heap_len - 1);
+	} else if (key > self->heap[0].key) {
+		g_hash_table_remove(self->heap_pos, self->heap[0].item);
+		self->heap[0] = entry;
+		heap_sift_down(self, 0);
+	}
+}
+
+void netif_top_model_remove(NetifTopModel *self, gpointer item)
+{
+	guint pos = GPOINTER_TO_UINT(g_hash_table_lookup(self->heap_pos, item));
+
+	if (pos)
+		heap_remove(self, pos - 1);
+
+	if (g_ptr_array_find(self->items, item, &pos)) {
+		g_ptr_array_remove_index(self->items, pos);
+		g_list_model_items_changed(G_LIST_MODEL(self), pos, 1, 0);
+	}
+}
+
+/* Let the view re-read @item, e.g. after it changed in a way a filter sees */
+void netif_top_model_refresh(NetifTopModel *self, gpointer item)
+{
+	guint pos;
+
+	if (g_ptr_array_find(self->items, item, &pos))
+		g_list_model_items_changed(G_LIST_MODEL(self), pos, 1, 1);
+}
+
+/* Highest key first, ties keep their previous order to avoid churn */
+static int netif_top_entry_cmp(const void *a, const void *b)
+{
+	const struct netif_top_entry *x = a, *y = b;
+
+	if (x->key != y->key)
+		return x->key > y->key ? -1 : 1;
+
+	return (x->rank > y->rank) - (x->rank < y->rank);
+}
+
+void netif_top_model_commit(NetifTopModel *self)
+{
+	struct netif_top_entry *sorted = g_new(struct netif_top_entry, MAX(self->heap_len, 1));
+	guint old_len = self->items->len, new_len = self->heap_len;
+	GHashTable *rank_ht = g_hash_table_new(g_direct_hash, g_direct_equal);
+	guint prefix = 0, suffix = 0;
+
+	for (guint i = 0; i < old_len; i++)
+		g_hash_table_insert(rank_ht, g_ptr_array_index(self->items, i),
+				GUINT_TO_POINTER(i + 1));
+
+	for (guint i = 0; i < new_len; i++) {
+		guint rank = GPOINTER_TO_UINT(g_hash_table_lookup(rank_ht, self->heap[i].item));
+
+		sorted[i] = self->heap[i];
+		sorted[i].rank = rank ? rank - 1 : G_MAXUINT;
+	}
+	g_hash_table_destroy(rank_ht);
+	qsort(sorted, new_len, sizeof(*sorted), netif_top_entry_cmp);
+
+	while (prefix < old_len && prefix < new_len &&
+			g_ptr_array_index(self->items, prefix) == sorted[prefix].item)
+		prefix++;
+
+	while (suffix < old_len - prefix && suffix < new_len - prefix &&
+			g_ptr_array_index(self->items, old_len - 1 - suffix) ==
+			sorted[new_len - 1 - suffix].item)
+		suffix++;
+
+	guint removed = old_len - prefix - suffix;
+	guint added = new_len - prefix - suffix;
+
+	if (removed || added) {
+		g_ptr_array_remove_range(self->items, prefix, removed);
+		for (guint i = 0; i < added; i++)
+			g_ptr_array_insert(self->items, prefix + i, sorted[prefix + i].item);
+
+		g_list_model_items_changed(G_LIST_MODEL(self), prefix, removed, added);
+	}
+
+	g_free(sorted);
+}
+
+void netif_top_model_set_limit(NetifTopModel *self, guint limit)
+{
+	guint old_len = self->items->len;
+
+	if (limit == self->limit)
+		return;
+
+	self->limit = limit;
+	self->heap = g_renew(struct netif_top_entry, self->heap, MAX(limit, 1));
+	netif_top_model_begin(self);
+
+	if (old_len > limit) {
+		g_ptr_array_remove_range(self->items, limit, old_len - limit);
+		g_list_model_items_changed(G_LIST_MODEL(self), limit, old_len - limit, 0);
+	}
+}
+
+guint netif_top_model_get_limit(NetifTopModel *self)
+{
+	return self->limit;
+}
+
+static void netif_top_model_finalize(GObject *object)
+{
+	NetifTopModel *self = NETIF_TOP_MODEL(object);
+
+	g_free(self->heap);
+	g_hash_table_destroy(self->heap_pos);
+	g_ptr_array_unref(self->items);
+
+	G_OBJECT_CLASS(netif_top_model_parent_class)->finalize(object);
+}
+
+static void netif_top_model_class_init(NetifTopModelClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(class);
+
+	object_class->finalize = netif_top_model_finalize;
+}
+
+static void netif_top_model_init(NetifTopModel *self)
+{
+	self->heap_pos = g_hash_table_new(g_direct_hash, g_direct_equal);
+	self->items = g_ptr_array_new();
+}
+
+NetifTopModel *netif_top_model_new(GType item_type, NetifTopItemFunc item_func,
+		guint limit)
+{
+	NetifTopModel *self = g_object_new(NETIF_TYPE_TOP_MODEL, NULL);
+
+	self->item_type = item_type;
+	self->item_func = item_func;
+	netif_top_model_set_limit(self, limit);
+
+	return self;
+}
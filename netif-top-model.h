@@ -0,0 +1,34 @@
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define NETIF_TYPE_TOP_MODEL	(netif_top_model_get_type())
+
+G_DECLARE_FINAL_TYPE(NetifTopModel, netif_top_model, NETIF, TOP_MODEL, GObject)
+
+/*
+ * Candidates are plain keys, @item_func turns one into the @item_type
+ * object handed out by get_item(), returning a new reference.
+ */
+typedef gpointer (*NetifTopItemFunc)(gpointer key);
+
+NetifTopModel *netif_top_model_new(GType item_type, NetifTopItemFunc item_func,
+		guint limit);
+void netif_top_model_set_limit(NetifTopModel *self, guint limit);
+guint netif_top_model_get_limit(NetifTopModel *self);
+
+/*
+ * A round starts with begin(), feeds every candidate through update() and
+ * publishes the new ranking with commit(). Only the positions whose item
+ * changed are reported through items-changed. The ranking is exact when
+ * each item is updated at most once per round.
+ */
+void netif_top_model_begin(NetifTopModel *self);
+void netif_top_model_update(NetifTopModel *self, gpointer item, guint64 key);
+void netif_top_model_remove(NetifTopModel *self, gpointer item);
+void netif_top_model_commit(NetifTopModel *self);
+void netif_top_model_refresh(NetifTopModel *self, gpointer item);
+
+G_END_DECLS
@@ -18,278 +18,1378 @@
 #include <netlink/socket.h>
 #include <netlink/netlink.h>
 #include <netlink/genl/ctrl.h>
+#include <netlink/attr.h>
+#include <linux/pkt_sched.h>
 #include <net/if.h>
 #include <inttypes.h>
 
 #include <glib-unix.h>
 
+#include "netif-agent.h"
+#include "netif-chart.h"
+#include "netif-dbus.h"
+#include "netif-ethtool.h"
+#include "netif-filter.h"
+#include "netif-heatmap.h"
+#include "netif-link-model.h"
+#include "netif-link-stats.h"
+#include "netif-perf.h"
+#include "netif-qdisc.h"
+#include "netif-rates.h"
+#include "netif-softnet-view.h"
+#include "netif-source.h"
+#include "netif-top-model.h"
 #include "netif-widget.h"
 
-#define NETIF_TYPE_LINK_STATS	(netif_link_stats_get_type())
-G_DECLARE_FINAL_TYPE(NetifLinkStats, netif_link_stats, NETIF, LINK_STATS, GObject)
+struct netif_link_info {
+	guint master;
+	guint8 operstate;
+	int netnsid;
+	guint flags;
+	int carrier;
 
-struct _NetifLinkStats {
-	GObject base;
+	/* g_get_real_time() of the message that changed the state */
+	gint64 since;
 
-	guint ifindex;
-	char *ifname;
+	/* ethtool speed in Mb/s and duplex, asked again on each state change */
+	guint32 speed;
+	bool half_duplex;
+};
+
+/* ifi_flags that make up the state shown, others don't count as a flap */
+#define NETIF_STATE_FLAGS	(IFF_UP | IFF_RUNNING)
+
+/* ethtool requests in flight, a burst of link events queues the rest */
+#define NETIF_SPEED_INFLIGHT	64
+
+/* ms between chart samples, 10 Hz */
+#define NETIF_CHART_INTERVAL	100
+
+/* IF_OPER_* */
+static const char *const netif_operstates[] = {
+	"unknown", "notpresent", "down", "lowerlayerdown", "testing", "dormant", "up",
+};
+
+struct netif_group_rule {
+	char *name;
+	GPatternSpec *pattern;
+};
+
+/* A remote agent, its interfaces are keyed by their ifindex on that host */
+struct netif_widget_agent {
+	char *host;
+	struct netif_agent_client *client;
+	GHashTable *netif_ht;
+};
+
+struct _NetifWidget {
+	AdwBin base;
+
+	/* counters of every link and aggregate row, see netif-link-table.h */
+	struct netif_link_table *table;
+	NetifLinkModel *netif_store;
+	GHashTable *netif_ht;
+
+	/* nesting of model batches, and the idle ending a link event batch */
+	guint batch;
+	guint batch_id;
+
+	/* aggregate rows, by "master:<ifindex>" or user group name */
+	GHashTable *group_ht;
+	GPtrArray *group_rules;
+	char **groups;
+
+	/* ifindex -> struct netif_link_info, maintained from link events */
+	GHashTable *link_info_ht;
+
+	/*
+	 * qdisc rows of the interfaces expanded or matching qdisc_rules, the
+	 * ifindexes the dump in flight is for, and the tick it was sent in
+	 */
+	GPtrArray *qdisc_links;
+	GHashTable *qdisc_watch_ht;
+	GPtrArray *qdisc_rules;
+	char **qdisc_specs;
+	guint qdisc_serial;
+	guint64 qdisc_pending;
+	gint64 qdisc_time;
+
+	/*
+	 * Off-screen interfaces that match no pin_rules are only sampled by
+	 * the full dump every full_interval ticks, see netif_widget_dump()
+	 */
+	GPtrArray *pin_rules;
+	char **pin_specs;
+	GArray *poll_ifindex;
+	guint full_interval;
+	guint64 full_tick;
+
+	struct netif_source *source;
+	char *source_spec;
+	const char *host;
+
+	/* struct netif_widget_agent, and the one whose samples are being applied */
+	char **agent_specs;
+	GPtrArray *agents;
+	struct netif_widget_agent *agent;
+
+	char *record_path;
+	char *flap_log_path;
+	FILE *flap_log;
+	char *history_dir;
+
+	int nl_timeout_id;
+	guint64 tick;
+	bool loaded;
+	/* the first dump running in a worker, see netif_widget_first_dump() */
+	GCancellable *first_dump;
+
+	/* monotonic time of the dump in progress, and whether it is a single link */
+	gint64 sample_time;
+	bool dump_link;
+	/* ifindexes to refresh once the link events of this read are handled */
+	GArray *dump_link_queue;
+
+	struct netif_dbus *dbus;
+
+	/* cost of the recent ticks, and the label showing it */
+	struct netif_perf perf;
+	gint64 format_ns;
+	GtkLabel *perf_label;
+
+	/* per-CPU backlog stats, only read while the view exists */
+	struct netif_softnet softnet;
+	guint64 softnet_rx_packets;
+	NetifSoftnetView *softnet_view;
+
+	struct nl_sock *rtnl_sock;
+	int rtnl_id;
+	gint64 rtnl_time;
+
+	/* generic netlink socket for ETHTOOL_MSG_LINKMODES_GET, NULL without */
+	struct nl_sock *ethtool_sock;
+	int ethtool_family;
+	int ethtool_id;
+	GArray *speed_queue;
+	guint speed_inflight;
+
+	/* busiest interfaces by rx + tx rate */
+	NetifTopModel *top_model;
+	bool top_mode;
+	/* rank by share of the link speed instead */
+	bool top_by_util;
+
+	GtkWidget *columnview;
+	GtkSelectionModel *selection;
+	NetifChart *chart;
+	/* local charted links, sampled every NETIF_CHART_INTERVAL ms */
+	GArray *chart_ifindex;
+	guint chart_id;
+	GtkTreeListModel *tree;
+	GtkTreeListModel *top_tree;
+
+	NetifFilter *filter;
+	GtkFilterListModel *filter_model;
+
+	bool raw_bytes;
+	bool simple_mode;
+
+	/* utilization in percent that marks the Util cell, 0 for none */
+	guint util_alert;
+
+	GtkColumnViewColumn *host_column;
+	GtkColumnViewColumn *index_column;
+	GtkColumnViewColumn *rx_packets_column;
+	GtkColumnViewColumn *tx_packets_column;
+
+	/* shown once a source reports offload xstats */
+	GtkColumnViewColumn *rx_hw_column;
+	GtkColumnViewColumn *tx_hw_column;
+};
+
+enum {
+	PROP_RAW_BYTES = 1,
+	PROP_SIMPLE_MODE,
+	PROP_SOURCE,
+	PROP_RECORD,
+	PROP_FLAP_LOG,
+	PROP_HISTORY_DIR,
+	PROP_GROUPS,
+	PROP_AGENTS,
+	PROP_QDISC_WATCH,
+	PROP_PIN,
+	PROP_FULL_INTERVAL,
+	PROP_TOP_MODE,
+	PROP_TOP_N,
+	PROP_TOP_BY_UTIL,
+	PROP_UTIL_ALERT,
+	PROP_FILTER_TEXT,
+	PROP_LOADED,
+};
+
+G_DEFINE_FINAL_TYPE(NetifWidget, netif_widget, ADW_TYPE_BIN)
+
+static void netif_widget_group_flush(NetifWidget *self);
+static void netif_widget_batch_begin(NetifWidget *self);
+static void netif_widget_batch_end(NetifWidget *self);
+static void netif_widget_update_chart(NetifWidget *self);
+static void netif_widget_qdisc_poll(NetifWidget *self);
+static void netif_widget_rates(NetifWidget *self);
+static void netif_widget_update_link(const struct netif_sample *sample, gpointer data);
+static void netif_widget_drop_link(NetifWidget *self, GHashTable *netif_ht,
+		struct netif_link *netif);
+
+static void netif_widget_perf_tick(NetifWidget *self, gint64 start, gint64 update)
+{
+	static const struct netif_source_stats none;
+	const struct netif_source_stats *stats = self->source ? &self->source->stats : &none;
+	gint64 end = netif_perf_now();
+	struct netif_perf_tick t = {
+		.tick = self->tick,
+		.messages = stats->messages,
+		.bytes = stats->bytes,
+		.dump_ns = stats->dump_ns,
+		.read_ns = stats->read_ns,
+		.parse_ns = stats->parse_ns,
+		/* formatting happens inside the notifications */
+		.update_ns = stats->emit_ns + end - update - self->format_ns,
+		.format_ns = self->format_ns,
+		.total_ns = end - start,
+	};
+
+	netif_perf_push(&self->perf, &t);
+
+	netif_perf_mark(start, "dump", "%u messages, %"G_GUINT64_FORMAT" bytes",
+			t.messages, t.bytes);
+	netif_perf_mark(update, "update", "format %.3f ms", t.format_ns / 1e6);
+
+	if (self->perf_label && gtk_widget_get_mapped(GTK_WIDGET(self->perf_label))) {
+		g_autofree char *text = netif_perf_format(&self->perf);
+
+		gtk_label_set_text(self->perf_label, text);
+	}
+}
+
+/* Read the softnet stats on the tick of the dump, for the view to line them up */
+static void netif_widget_softnet_tick(NetifWidget *self)
+{
+	gint64 last = self->softnet.time;
+	guint64 rx_packets = 0, rate = 0;
+	struct netif_link *netif;
+	GHashTableIter iter;
+	int err;
+
+	if (!self->softnet_view || self->softnet.fd < 0)
+		return;
+
+	err = netif_softnet_read(&self->softnet, self->sample_time);
+	if (err < 0) {
+		g_warning("softnet_stat: %s", g_strerror(-err));
+		return;
+	}
+
+	g_hash_table_iter_init(&iter, self->netif_ht);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&netif))
+		rx_packets += netif_link_col(netif, rx_packets);
+
+	/* links coming and going make the sum jump, skip those ticks */
+	if (last && self->sample_time > last && rx_packets >= self->softnet_rx_packets)
+		rate = (rx_packets - self->softnet_rx_packets) * G_USEC_PER_SEC /
+			(self->sample_time - last);
+	self->softnet_rx_packets = rx_packets;
+
+	netif_softnet_view_update(self->softnet_view, &self->softnet, rate);
+}
+
+static void netif_widget_agent_remove(guint ifindex, gpointer data)
+{
+	NetifWidget *self = data;
+	struct netif_link *netif = g_hash_table_lookup(self->agent->netif_ht,
+			GUINT_TO_POINTER(ifindex));
+
+	if (netif)
+		netif_widget_drop_link(self, self->agent->netif_ht, netif);
+}
+
+/* Apply the latest frame of every agent, on the agent's clock */
+static void netif_widget_agents_update(NetifWidget *self)
+{
+	gint64 sample_time = self->sample_time;
+
+	for (guint i = 0; i < self->agents->len; i++) {
+		self->agent = g_ptr_array_index(self->agents, i);
+		netif_agent_client_drain(self->agent->client, netif_widget_agent_remove,
+				netif_widget_update_link, self, &self->sample_time);
+	}
+
+	self->agent = NULL;
+	self->sample_time = sample_time;
+}
+
+/* Queue @netif for this tick's targeted sample, or the members behind it */
+static void netif_widget_poll_add(NetifWidget *self, struct netif_link *netif)
+{
+	if (netif->qdisc)
+		netif = netif->dev;
+
+	if (netif->children) {
+		GListModel *children = G_LIST_MODEL(netif->children);
+		guint n = g_list_model_get_n_items(children);
+
+		for (guint i = 0; i < n; i++)
+			netif_widget_poll_add(self,
+					netif_link_model_get_link(netif->children, i));
+		return;
+	}
+
+	if (netif->host != self->host || netif->poll_tick == self->tick)
+		return;
+
+	netif->poll_tick = self->tick;
+	g_array_append_val(self->poll_ifindex, netif->ifindex);
+}
+
+/* Fill poll_ifindex, false if a full dump is due or costs less */
+static bool netif_widget_poll_collect(NetifWidget *self)
+{
+	GPtrArray *items = self->table->items;
+	GArray *poll = self->poll_ifindex;
+	struct netif_link *netif;
+	GHashTableIter iter;
+
+	/*
+	 * the ranking and the backlog sum need every interface, and so do the
+	 * history files and D-Bus clients, which would otherwise see stale
+	 * rates or holes for the ones off screen
+	 */
+	if (!self->source->ops->dump_links || self->full_interval <= 1 ||
+	    !self->full_tick || self->tick - self->full_tick >= self->full_interval ||
+	    self->top_mode || self->softnet_view || self->history_dir ||
+	    (self->dbus && netif_dbus_active(self->dbus)))
+		return false;
+
+	g_array_set_size(poll, 0);
+	for (guint i = 0; i < items->len; i++) {
+		NetifLinkStats *item = items->pdata[i];
+
+		if (item->link)
+			netif_widget_poll_add(self, item->link);
+	}
+
+	if (self->pin_rules->len) {
+		g_hash_table_iter_init(&iter, self->netif_ht);
+		while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&netif))
+			if (netif->pinned)
+				netif_widget_poll_add(self, netif);
+	}
+
+	/* past half the table, one dump is cheaper than the requests */
+	return poll->len * 2 <= g_hash_table_size(self->netif_ht);
+}
+
+/*
+ * Rows on screen, selected, charted or pinned are sampled every tick with
+ * one RTM_GETSTATS each, all in a single send. Everything else waits for a
+ * full dump every full_interval ticks. Rates are per second over each
+ * interface's own interval, so theirs stay right, only older.
+ */
+static int netif_widget_dump(NetifWidget *self)
+{
+	if (netif_widget_poll_collect(self))
+		return netif_source_dump_links(self->source,
+				(const guint *)self->poll_ifindex->data, self->poll_ifindex->len);
+
+	self->full_tick = self->tick;
+	return netif_source_dump(self->source);
+}
+
+/* Samples of the first dump, taken off the main thread */
+struct netif_first_dump {
+	struct netif_source *source;
+	GArray *samples;
+	GStringChunk *names;
+	gint64 sample_time;
+	int err;
+
+	struct nl_sock *ethtool_sock;
+	int ethtool_family;
+
+	char *history_dir;
+};
+
+/* Dump, or apply @first if set, and publish the result */
+static void netif_widget_tick(NetifWidget *self, struct netif_first_dump *first)
+{
+	gint64 start = netif_perf_now(), update;
+
+	self->tick++;
+	self->sample_time = first ? first->sample_time : g_get_monotonic_time();
+	self->format_ns = 0;
+
+	if (self->top_mode)
+		netif_top_model_begin(self->top_model);
+
+	/* new interfaces of this dump show up as one model change */
+	netif_widget_batch_begin(self);
+
+	if (first) {
+		for (guint i = 0; i < first->samples->len; i++)
+			netif_widget_update_link(&g_array_index(first->samples,
+					struct netif_sample, i), self);
+		if (first->err < 0)
+			g_warning("%s dump error: %s", self->source->ops->name,
+					g_strerror(-first->err));
+	} else if (self->source) {
+		int err = netif_widget_dump(self);
+		if (err < 0)
+			g_warning("%s dump error: %s", self->source->ops->name,
+					g_strerror(-err));
+	}
+
+	netif_widget_softnet_tick(self);
+	netif_widget_qdisc_poll(self);
+
+	update = netif_perf_now();
+	netif_widget_agents_update(self);
+	netif_widget_rates(self);
+	netif_widget_batch_end(self);
+	netif_widget_group_flush(self);
+
+	if (self->top_mode)
+		netif_top_model_commit(self->top_model);
+
+	/* the chart samples on its own while its links can be */
+	if (self->chart && !self->chart_id)
+		netif_chart_push(self->chart);
+
+	netif_widget_perf_tick(self, start, update);
+
+	if (self->dbus)
+		netif_dbus_tick(self->dbus, self->tick);
+}
+
+static gboolean netif_source_func(gpointer data)
+{
+	NetifWidget *self = data;
+
+	netif_widget_tick(self, NULL);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/* Unsigned wraparound makes a negative delta subtract */
+static void netif_group_add(struct netif_link *group, const struct netif_counters *new,
+		const struct netif_counters *old)
+{
+	netif_link_col(group, rx_packets) += new->rx_packets - old->rx_packets;
+	netif_link_col(group, tx_packets) += new->tx_packets - old->tx_packets;
+	netif_link_col(group, rx_bytes) += new->rx_bytes - old->rx_bytes;
+	netif_link_col(group, tx_bytes) += new->tx_bytes - old->tx_bytes;
+	netif_link_col(group, rx_rate) += new->rx_rate - old->rx_rate;
+	netif_link_col(group, tx_rate) += new->tx_rate - old->tx_rate;
+	group->dirty = true;
+}
+
+/* Publish the changes of this tick to the rows views hold */
+static void netif_widget_group_flush(NetifWidget *self)
+{
+	guint64 tick = self->tick + self->dump_link;
+	GHashTableIter iter;
+	struct netif_link *group;
+
+	g_hash_table_iter_init(&iter, self->group_ht);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&group)) {
+		if (!group->dirty)
+			continue;
+
+		netif_link_col(group, change_tick) = tick;
+		group->dirty = false;
+	}
+
+	netif_link_table_notify(self->table, tick);
+}
+
+static struct netif_link *netif_widget_group_get(NetifWidget *self,
+		const char *key, const char *name)
+{
+	struct netif_link *group = g_hash_table_lookup(self->group_ht, key);
+
+	if (!group) {
+		group = netif_link_new(self->table, 0, name);
+		group->children = netif_link_model_new();
+		if (self->batch)
+			netif_link_model_freeze(group->children);
+		g_hash_table_insert(self->group_ht, g_strdup(key), group);
+	}
+
+	return group;
+}
+
+static struct netif_link *netif_widget_group_lookup(NetifWidget *self,
+		struct netif_link *netif)
+{
+	struct netif_link_info *info = NULL;
+	guint master;
+
+	/* link events, and so masters, are only known for local interfaces */
+	if (netif->host == self->host)
+		info = g_hash_table_lookup(self->link_info_ht, GUINT_TO_POINTER(netif->ifindex));
+	master = info ? info->master : 0;
+
+	if (master) {
+		g_autofree char *key = g_strdup_printf("master:%u", master);
+		g_autofree char *name = NULL;
+		char ifname[IF_NAMESIZE];
+		struct netif_link *master_link = g_hash_table_lookup(self->netif_ht,
+				GUINT_TO_POINTER(master));
+
+		if (master_link && master_link->ifname)
+			name = g_strdup_printf("%s ports", master_link->ifname);
+		else if (if_indextoname(master, ifname))
+			name = g_strdup_printf("%s ports", ifname);
+		else
+			name = g_strdup_printf("%u ports", master);
+
+		return netif_widget_group_get(self, key, name);
+	}
+
+	if (!netif->ifname)
+		return NULL;
+
+	for (guint i = 0; i < self->group_rules->len; i++) {
+		struct netif_group_rule *rule = g_ptr_array_index(self->group_rules, i);
+
+		if (g_pattern_spec_match_string(rule->pattern, netif->ifname))
+			return netif_widget_group_get(self, rule->name, rule->name);
+	}
+
+	return NULL;
+}
+
+/* Model changes until the matching end are reported all at once */
+static void netif_widget_batch_begin(NetifWidget *self)
+{
+	GHashTableIter iter;
+	struct netif_link *group;
+
+	if (self->batch++)
+		return;
+
+	netif_link_model_freeze(self->netif_store);
+
+	g_hash_table_iter_init(&iter, self->group_ht);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&group))
+		netif_link_model_freeze(group->children);
+}
 
-	guint64 rx_packets;
-	guint64 tx_packets;
-	guint64 rx_bytes;
-	guint64 tx_bytes;
+static void netif_widget_batch_end(NetifWidget *self)
+{
+	GHashTableIter iter;
+	struct netif_link *group;
+
+	if (--self->batch)
+		return;
+
+	g_hash_table_iter_init(&iter, self->group_ht);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&group))
+		netif_link_model_thaw(group->children);
+
+	netif_link_model_thaw(self->netif_store);
+}
+
+static void netif_widget_group_leave(NetifWidget *self, struct netif_link *netif)
+{
+	struct netif_link *group = netif->group;
+	struct netif_counters zero = { 0 }, old;
+
+	if (!group)
+		return;
+
+	netif_link_counters_get(netif, &old);
+	netif_group_add(group, &zero, &old);
+
+	netif->group = NULL;
+	netif_link_model_remove(group->children, netif);
+
+	if (g_list_model_get_n_items(G_LIST_MODEL(group->children)) == 0)
+		netif_link_model_remove(self->netif_store, group);
+}
+
+static void netif_widget_group_join(NetifWidget *self, struct netif_link *netif,
+		struct netif_link *group)
+{
+	struct netif_counters zero = { 0 }, new;
+
+	netif_link_counters_get(netif, &new);
+	netif_group_add(group, &new, &zero);
+
+	if (g_list_model_get_n_items(G_LIST_MODEL(group->children)) == 0)
+		netif_link_model_append(self->netif_store, group);
+
+	netif->group = group;
+	netif_link_model_append(group->children, netif);
+}
+
+/* Move @netif to the row its master or name now selects */
+static void netif_widget_regroup(NetifWidget *self, struct netif_link *netif)
+{
+	struct netif_link *group = netif_widget_group_lookup(self, netif);
+
+	if (group == netif->group)
+		return;
+
+	if (netif->group)
+		netif_widget_group_leave(self, netif);
+	else
+		netif_link_model_remove(self->netif_store, netif);
+
+	if (group)
+		netif_widget_group_join(self, netif, group);
+	else
+		netif_link_model_append(self->netif_store, netif);
+}
+
+/* Re-run the filter on @netif alone by replacing it in place */
+static void netif_widget_refilter(NetifWidget *self, struct netif_link *netif)
+{
+	NetifLinkModel *store = netif->group ? netif->group->children : self->netif_store;
+
+	netif_filter_invalidate(netif);
+
+	if (!netif_filter_is_active(self->filter))
+		return;
+
+	netif_link_model_refresh(store, netif);
+
+	netif_top_model_refresh(self->top_model, netif);
+}
+
+static void netif_widget_log_flap(NetifWidget *self, struct netif_link *netif,
+		const char *old_state, const char *state)
+{
+	g_autoptr(GDateTime) dt = g_date_time_new_from_unix_utc(netif->state_since / G_USEC_PER_SEC);
+	g_autoptr(GDateTime) t = g_date_time_add(dt, netif->state_since % G_USEC_PER_SEC);
+	g_autofree char *stamp = g_date_time_format(t, "%Y-%m-%dT%H:%M:%S.%fZ");
+
+	g_debug("%s %s: %s -> %s", stamp, netif->ifname, old_state, state);
+
+	if (!self->flap_log)
+		return;
+
+	fprintf(self->flap_log, "%s %u %s %s %s%s%s carrier=%d\n",
+			stamp, netif->ifindex, netif->ifname, old_state, state,
+			netif->flags & IFF_UP ? " UP" : "",
+			netif->flags & IFF_RUNNING ? " RUNNING" : "",
+			netif->carrier);
+	fflush(self->flap_log);
+}
+
+static void netif_widget_apply_link_info(NetifWidget *self, struct netif_link *netif,
+		const struct netif_link_info *info)
+{
+	const char *state = "unknown";
+	bool flapped;
+
+	if (info->operstate < G_N_ELEMENTS(netif_operstates))
+		state = netif_operstates[info->operstate];
+
+	flapped = g_strcmp0(state, netif->state) != 0 ||
+			info->flags != netif->flags || info->carrier != netif->carrier;
+	if (!flapped && info->netnsid == netif->netnsid)
+		return;
+
+	/* the first state seen is not a change */
+	flapped &= netif->state != NULL;
+
+	g_autofree char *old_state = g_steal_pointer(&netif->state);
+
+	netif->state = g_strdup(state);
+	netif->netnsid = info->netnsid;
+	netif->flags = info->flags;
+	netif->carrier = info->carrier;
+	netif->state_since = info->since;
+	netif->flaps += flapped;
+	netif_link_notify(netif);
+
+	if (flapped)
+		netif_widget_log_flap(self, netif, old_state, state);
+
+	netif_widget_refilter(self, netif);
+}
+
+/* Refresh a row before the next tick, see netif_widget_dump_link_flush() */
+static void netif_widget_dump_link(NetifWidget *self, struct netif_link *netif)
+{
+	if (!self->loaded || !self->source || netif->dump_queued)
+		return;
+
+	netif->dump_queued = true;
+	g_array_append_val(self->dump_link_queue, netif->ifindex);
+}
+
+/*
+ * Sample the queued rows in batched requests, one round trip per
+ * NETLINK_BATCH rather than per event. Rates stay consistent as they are
+ * per-second, and the tick's dump stats are kept.
+ */
+static void netif_widget_dump_link_flush(NetifWidget *self)
+{
+	GArray *queue = self->dump_link_queue;
+	struct netif_source_stats stats;
+	int err;
+
+	if (!queue->len)
+		return;
+
+	for (guint i = 0; i < queue->len; i++) {
+		struct netif_link *netif = g_hash_table_lookup(self->netif_ht,
+				GUINT_TO_POINTER(g_array_index(queue, guint, i)));
+
+		if (netif)
+			netif->dump_queued = false;
+	}
+
+	if (self->source) {
+		stats = self->source->stats;
+		self->sample_time = g_get_monotonic_time();
+		self->dump_link = true;
+		err = netif_source_dump_links(self->source, (guint *)queue->data, queue->len);
+		netif_widget_rates(self);
+		netif_widget_group_flush(self);
+		self->dump_link = false;
+		self->source->stats = stats;
+
+		if (err < 0 && err != -EOPNOTSUPP)
+			g_warning("%s dump of %u links: %s", self->source->ops->name,
+					queue->len, g_strerror(-err));
+	}
+
+	g_array_set_size(queue, 0);
+}
+
+/* Unlist every row of @gone, then free them, as they may be listed under each other */
+static void netif_widget_qdisc_free(NetifWidget *self, GPtrArray *gone)
+{
+	for (guint i = 0; i < gone->len; i++) {
+		struct netif_link *qdisc = gone->pdata[i];
+
+		if (qdisc->up->qdiscs)
+			netif_link_model_remove(qdisc->up->qdiscs, qdisc);
+	}
+
+	for (guint i = 0; i < gone->len; i++)
+		g_ptr_array_remove_fast(self->qdisc_links, gone->pdata[i]);
+}
+
+static void netif_widget_drop_link(NetifWidget *self, GHashTable *netif_ht,
+		struct netif_link *netif)
+{
+	g_autoptr(GPtrArray) gone = g_ptr_array_new();
+
+	for (guint i = 0; i < self->qdisc_links->len; i++) {
+		struct netif_link *qdisc = self->qdisc_links->pdata[i];
+
+		if (qdisc->dev == netif)
+			g_ptr_array_add(gone, qdisc);
+	}
+	netif_widget_qdisc_free(self, gone);
+
+	netif_top_model_remove(self->top_model, netif);
+
+	if (netif->group)
+		netif_widget_group_leave(self, netif);
+	else
+		netif_link_model_remove(self->netif_store, netif);
+
+	g_hash_table_remove(netif_ht, GUINT_TO_POINTER(netif->ifindex));
+}
+
+static void netif_widget_remove_link(NetifWidget *self, guint ifindex)
+{
+	struct netif_link *netif = g_hash_table_lookup(self->netif_ht,
+			GUINT_TO_POINTER(ifindex));
+
+	g_hash_table_remove(self->link_info_ht, GUINT_TO_POINTER(ifindex));
+
+	if (!netif)
+		return;
+
+	if (self->dbus)
+		netif_dbus_link_removed(self->dbus, ifindex);
+	netif_widget_drop_link(self, self->netif_ht, netif);
+}
+
+static void netif_widget_update_offload(NetifWidget *self, struct netif_link *netif,
+		const struct netif_sample *sample, gint64 dt)
+{
+	guint64 rx_rate = netif->cpu_rx_rate;
+	guint64 tx_rate = netif->cpu_tx_rate;
+
+	if (!sample->offload)
+		return;
+
+	if (netif->offload && dt > 0) {
+		rx_rate = (sample->cpu_rx_bytes - netif->cpu_rx_bytes) * G_USEC_PER_SEC / dt;
+		tx_rate = (sample->cpu_tx_bytes - netif->cpu_tx_bytes) * G_USEC_PER_SEC / dt;
+	}
+
+	netif->offload = true;
+	netif->cpu_rx_bytes = sample->cpu_rx_bytes;
+	netif->cpu_tx_bytes = sample->cpu_tx_bytes;
+	netif->mpls = sample->mpls;
+	netif->mpls_rx_packets = sample->mpls_rx_packets;
+	netif->mpls_tx_packets = sample->mpls_tx_packets;
+
+	if (rx_rate != netif->cpu_rx_rate || tx_rate != netif->cpu_tx_rate)
+		netif_link_col(netif, change_tick) = self->tick + self->dump_link;
+	netif->cpu_rx_rate = rx_rate;
+	netif->cpu_tx_rate = tx_rate;
+
+	if (!gtk_column_view_column_get_visible(self->rx_hw_column)) {
+		gtk_column_view_column_set_visible(self->rx_hw_column, TRUE);
+		gtk_column_view_column_set_visible(self->tx_hw_column, TRUE);
+	}
+}
+
+static void netif_widget_record_history(struct netif_link *netif)
+{
+	guint64 rates[NETIF_HISTORY_COUNTERS] = {
+		[NETIF_HISTORY_RX_BYTES] = netif_link_col(netif, rx_rate),
+		[NETIF_HISTORY_TX_BYTES] = netif_link_col(netif, tx_rate),
+		[NETIF_HISTORY_RX_PACKETS] = netif_link_col(netif, rx_pps),
+		[NETIF_HISTORY_TX_PACKETS] = netif_link_col(netif, tx_pps),
+	};
+
+	if (netif->history)
+		netif_history_update(netif->history, g_get_real_time() / G_USEC_PER_SEC, rates);
+}
+
+/* Hundredths of a percent of the link speed in use, 0 if unknown */
+static guint32 netif_widget_util(struct netif_link *netif)
+{
+	guint64 rx = netif_link_col(netif, rx_rate);
+	guint64 tx = netif_link_col(netif, tx_rate);
+	/* Mb/s in bytes/s, each way at full duplex, shared at half */
+	guint64 capacity = (guint64)netif->speed * 125000;
+	guint64 rate = netif->half_duplex ? rx + tx : MAX(rx, tx);
+
+	if (!capacity)
+		return 0;
+
+	return MIN(rate * 10000 / capacity, G_MAXUINT32);
+}
+
+static guint64 netif_widget_top_key(NetifWidget *self, struct netif_link *netif)
+{
+	if (self->top_by_util)
+		return netif_link_col(netif, util);
+
+	return netif_link_col(netif, rx_rate) + netif_link_col(netif, tx_rate);
+}
+
+static void netif_widget_apply_speed(NetifWidget *self, struct netif_link *netif,
+		const struct netif_link_info *info)
+{
+	if (info->speed == netif->speed && info->half_duplex == netif->half_duplex)
+		return;
+
+	netif->speed = info->speed;
+	netif->half_duplex = info->half_duplex;
+	netif_link_col(netif, util) = netif_widget_util(netif);
+	netif_link_notify(netif);
+}
+
+/*
+ * Turn the samples of this tick into rates in one pass over the table,
+ * then hand them to what reads them. Group rates move by the rate deltas
+ * of their members, like their counters do in netif_group_add().
+ */
+static void netif_widget_rates(NetifWidget *self)
+{
+	struct netif_link_table *table = self->table;
+	guint64 tick = self->tick + self->dump_link;
+
+	netif_rates_compute(table, 0, table->len, tick);
+
+	for (guint i = 0; i < table->len; i++) {
+		struct netif_link *netif = table->link[i];
+		guint flags = table->flags[i];
+
+		if (!netif || table->sample_tick[i] != tick)
+			continue;
+
+		if (netif->group) {
+			netif_link_col(netif->group, rx_rate) += table->rx_rate_delta[i];
+			netif_link_col(netif->group, tx_rate) += table->tx_rate_delta[i];
+		}
+
+		if (netif->speed)
+			table->util[i] = netif_widget_util(netif);
+
+		if (flags & NETIF_RATE_CHANGED) {
+			table->change_tick[i] = tick;
+			if (netif->group)
+				netif->group->dirty = true;
+		}
+
+		/*
+		 * every second counts once, at the rate of the sample that
+		 * covers it: once per tick for polled rows, ten times per full
+		 * dump for the others, none for a refresh within the second
+		 */
+		if ((flags & NETIF_RATE_VALID) && !(flags & NETIF_RATE_RESET)) {
+			gint64 end = table->sample_time[i] / G_USEC_PER_SEC;
+			gint64 start = (table->sample_time[i] - table->interval[i]) / G_USEC_PER_SEC;
+
+			if (end > start) {
+				netif_hist_record_n(&netif->hist[0], table->rx_rate[i], end - start);
+				netif_hist_record_n(&netif->hist[1], table->tx_rate[i], end - start);
+			}
+		}
+
+		/* one entry per tick, single-link refreshes would skew it */
+		if (self->dump_link)
+			continue;
+
+		if ((flags & NETIF_RATE_VALID) && !(flags & NETIF_RATE_RESET))
+			netif_widget_record_history(netif);
+
+		if (self->top_mode)
+			netif_top_model_update(self->top_model, netif,
+					netif_widget_top_key(self, netif));
+	}
+}
+
+/* History files are by name, and by host for an agent's interfaces */
+static struct netif_history *netif_widget_history_open(NetifWidget *self,
+		const char *name)
+{
+	g_autofree char *remote = NULL;
+
+	if (!self->history_dir)
+		return NULL;
+
+	if (self->agent)
+		name = remote = g_strdup_printf("%s@%s", name, self->agent->host);
+
+	return netif_history_open(self->history_dir, name);
+}
+
+static bool netif_widget_qdisc_match(NetifWidget *self, const char *ifname)
+{
+	for (guint i = 0; i < self->qdisc_rules->len; i++)
+		if (g_pattern_spec_match_string(self->qdisc_rules->pdata[i], ifname))
+			return true;
+
+	return false;
+}
+
+static bool netif_widget_pin_match(NetifWidget *self, const char *ifname)
+{
+	for (guint i = 0; i < self->pin_rules->len; i++)
+		if (g_pattern_spec_match_string(self->pin_rules->pdata[i], ifname))
+			return true;
 
-	guint64 rx_rate;
-	guint64 tx_rate;
-};
+	return false;
+}
 
-G_DEFINE_FINAL_TYPE(NetifLinkStats, netif_link_stats, G_TYPE_OBJECT)
+/* Dump the qdiscs if an interface wants them and the last dump is done */
+static void netif_widget_qdisc_poll(NetifWidget *self)
+{
+	GHashTableIter iter;
+	struct netif_link *netif;
+	int err;
+
+	/* a lost reply would stall polling for good, give up on it */
+	if (self->qdisc_pending && self->tick - self->qdisc_pending < 5)
+		return;
+
+	g_hash_table_remove_all(self->qdisc_watch_ht);
+	g_hash_table_iter_init(&iter, self->netif_ht);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&netif))
+		if (netif->qdisc_watch ||
+		    (netif->qdiscs && netif_link_model_is_watched(netif->qdiscs)))
+			g_hash_table_add(self->qdisc_watch_ht, GUINT_TO_POINTER(netif->ifindex));
+
+	self->qdisc_pending = 0;
+	if (!g_hash_table_size(self->qdisc_watch_ht))
+		return;
+
+	err = netif_qdisc_request(self->rtnl_sock);
+	if (err < 0) {
+		g_warning("RTM_GETQDISC dump request: %s", g_strerror(-err));
+		return;
+	}
 
-enum {
-	PROP_0,
-	PROP_IFINDEX,
-	PROP_IFNAME,
-	PROP_RX_PACKETS,
-	PROP_TX_PACKETS,
-	PROP_RX_BYTES,
-	PROP_TX_BYTES,
-	PROP_RX_RATE,
-	PROP_TX_RATE,
-};
+	self->qdisc_serial++;
+	self->qdisc_pending = self->tick;
+}
 
-static void netif_link_stats_get_property(GObject *object,
-		guint prop_id, GValue *value, GParamSpec *spec)
+static struct netif_link *netif_widget_qdisc_find(NetifWidget *self,
+		const struct netif_qdisc *qdisc)
 {
-	NetifLinkStats *self = NETIF_LINK_STATS(object);
+	for (guint i = 0; i < self->qdisc_links->len; i++) {
+		struct netif_link *netif = self->qdisc_links->pdata[i];
 
-	switch (prop_id) {
-	case PROP_RX_BYTES:
-		g_value_set_uint64(value, self->rx_bytes);
-		break;
-	case PROP_TX_BYTES:
-		g_value_set_uint64(value, self->tx_bytes);
-		break;
-	case PROP_RX_PACKETS:
-		g_value_set_uint64(value, self->rx_packets);
-		break;
-	case PROP_TX_PACKETS:
-		g_value_set_uint64(value, self->tx_packets);
-		break;
-	case PROP_IFINDEX:
-		g_value_set_uint(value, self->ifindex);
-		break;
-	case PROP_IFNAME:
-		g_value_set_string(value, self->ifname);
-		break;
-	case PROP_RX_RATE:
-		g_value_set_uint64(value, self->rx_rate);
-		break;
-	case PROP_TX_RATE:
-		g_value_set_uint64(value, self->tx_rate);
-		break;
+		if (netif->qdisc->ifindex == qdisc->ifindex &&
+		    netif->qdisc->handle == qdisc->handle &&
+		    netif->qdisc->parent == qdisc->parent)
+			return netif;
 	}
+
+	return NULL;
 }
 
-static void netif_link_stats_set_property(GObject *object,
-		guint prop_id, const GValue *value, GParamSpec *spec)
+/* The row @qdisc goes under, its interface if the parent qdisc is not known */
+static struct netif_link *netif_widget_qdisc_up(NetifWidget *self,
+		struct netif_link *dev, const struct netif_qdisc *qdisc)
 {
-	NetifLinkStats *self = NETIF_LINK_STATS(object);
+	guint32 up = netif_qdisc_up(qdisc);
 
-	switch (prop_id) {
-	case PROP_RX_BYTES:
-		self->rx_bytes = g_value_get_uint64(value);
-		break;
-	case PROP_TX_BYTES:
-		self->tx_bytes = g_value_get_uint64(value);
-		break;
-	case PROP_RX_PACKETS:
-		self->rx_packets = g_value_get_uint64(value);
-		break;
-	case PROP_TX_PACKETS:
-		self->tx_packets = g_value_get_uint64(value);
-		break;
-	case PROP_IFINDEX:
-		self->ifindex = g_value_get_uint(value);
-		break;
-	case PROP_IFNAME:
-		g_free(self->ifname);
-		self->ifname = g_strdup(g_value_get_string(value));
-		break;
-	case PROP_RX_RATE:
-		self->rx_rate = g_value_get_uint64(value);
-		break;
-	case PROP_TX_RATE:
-		self->tx_rate = g_value_get_uint64(value);
-		break;
+	for (guint i = 0; up && i < self->qdisc_links->len; i++) {
+		struct netif_link *netif = self->qdisc_links->pdata[i];
+
+		if (netif->dev == dev && netif->qdisc->handle == up)
+			return netif;
 	}
+
+	return dev;
 }
 
-static void netif_link_stats_dispose(GObject *object)
+static void netif_widget_qdisc_list(NetifWidget *self, struct netif_link *up,
+		struct netif_link *netif)
 {
-	NetifLinkStats *self = NETIF_LINK_STATS(object);
+	netif->up = up;
+
+	if (up->qdiscs) {
+		netif_link_model_append(up->qdiscs, netif);
+		return;
+	}
 
-	g_free(self->ifname);
+	/* a qdisc row gets an expander once it has children, have the tree recheck */
+	up->qdiscs = netif_link_model_new();
+	netif_link_model_append(up->qdiscs, netif);
+	if (up->up && up->up->qdiscs)
+		netif_link_model_refresh(up->up->qdiscs, up);
 }
 
-static void netif_link_stats_class_init(NetifLinkStatsClass *class)
+static void rtnl_newqdisc(NetifWidget *self, struct nlmsghdr *hdr)
 {
-	GObjectClass *object_class = G_OBJECT_CLASS(class);
+	struct netif_qdisc qdisc;
+	struct netif_link *dev, *netif, *up;
+	g_autofree char *name = NULL;
+	struct netif_counters old, new = { 0 };
 
-	object_class->get_property = netif_link_stats_get_property;
-	object_class->set_property = netif_link_stats_set_property;
-	object_class->dispose = netif_link_stats_dispose;
+	if (!self->qdisc_pending || netif_qdisc_parse(hdr, &qdisc) < 0 ||
+	    !g_hash_table_contains(self->qdisc_watch_ht, GUINT_TO_POINTER(qdisc.ifindex)))
+		return;
 
-	g_object_class_install_property(object_class, PROP_IFINDEX,
-			g_param_spec_uint("ifindex", "ifindex", "interface index",
-				0, G_MAXUINT, 0,
-				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	dev = g_hash_table_lookup(self->netif_ht, GUINT_TO_POINTER(qdisc.ifindex));
+	if (!dev)
+		return;
 
-	g_object_class_install_property(object_class, PROP_IFNAME,
-			g_param_spec_string("ifname", "ifname", "interface name",
-				NULL,
-				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	qdisc.serial = self->qdisc_serial;
+	name = netif_qdisc_name(&qdisc);
+	netif = netif_widget_qdisc_find(self, &qdisc);
+	up = netif_widget_qdisc_up(self, dev, &qdisc);
 
-	g_object_class_install_property(object_class, PROP_RX_BYTES,
-			g_param_spec_uint64("rx-bytes", "rx bytes", "rx bytes",
-				0, G_MAXUINT64, 0,
-				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	/* qdisc counters are all on the way out */
+	new.tx_bytes = qdisc.bytes;
+	new.tx_packets = qdisc.packets;
 
-	g_object_class_install_property(object_class, PROP_TX_BYTES,
-			g_param_spec_uint64("tx-bytes", "tx bytes", "tx bytes",
-				0, G_MAXUINT64, 0,
-				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	if (!netif) {
+		netif = netif_link_new(self->table, qdisc.ifindex, name);
+		netif->host = dev->host;
+		netif->dev = dev;
+		netif->qdisc = g_new(struct netif_qdisc, 1);
+		g_ptr_array_add(self->qdisc_links, netif);
+		netif_widget_qdisc_list(self, up, netif);
+	} else {
+		gint64 dt = self->qdisc_time - netif_link_col(netif, sample_time);
 
-	g_object_class_install_property(object_class, PROP_RX_PACKETS,
-			g_param_spec_uint64("rx-packets", "rx packets", "rx packets",
-				0, G_MAXUINT64, 0,
-				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+		netif_link_counters_get(netif, &old);
+		new.tx_rate = old.tx_rate;
+		if (dt > 0)
+			new.tx_rate = (qdisc.bytes - old.tx_bytes) * G_USEC_PER_SEC / dt;
 
-	g_object_class_install_property(object_class, PROP_TX_PACKETS,
-			g_param_spec_uint64("tx-packets", "tx packets", "tx packets",
-				0, G_MAXUINT64, 0,
-				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+		if (up != netif->up) {
+			netif_link_model_remove(netif->up->qdiscs, netif);
+			netif_widget_qdisc_list(self, up, netif);
+		}
+		if (strcmp(name, netif->ifname) != 0) {
+			g_free(netif->ifname);
+			netif->ifname = g_steal_pointer(&name);
+		}
+	}
 
-	g_object_class_install_property(object_class, PROP_RX_RATE,
-			g_param_spec_uint64("rx-rate", "rx rate", "rx rate",
-				0, G_MAXUINT64, 0,
-				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	*netif->qdisc = qdisc;
+	netif_link_counters_set(netif, &new);
+	netif_link_col(netif, sample_time) = self->qdisc_time;
+	netif_link_col(netif, change_tick) = self->tick;
 
-	g_object_class_install_property(object_class, PROP_TX_RATE,
-			g_param_spec_uint64("tx-rate", "tx rate", "tx rate",
-				0, G_MAXUINT64, 0,
-				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_free(netif->state);
+	netif->state = qdisc.drops || qdisc.qlen ?
+		g_strdup_printf("%u dropped, %u queued", qdisc.drops, qdisc.qlen) :
+		g_strdup(qdisc.kind);
+	netif_link_notify(netif);
 }
 
-static void netif_link_stats_init(NetifLinkStats *self)
+/* End of a qdisc dump, the rows it had nothing for are gone */
+static void rtnl_qdisc_done(NetifWidget *self)
 {
+	g_autoptr(GPtrArray) gone = g_ptr_array_new();
+	GHashTableIter iter;
+	gpointer ifindex;
 
-}
+	for (guint i = 0; i < self->qdisc_links->len; i++) {
+		struct netif_link *netif = self->qdisc_links->pdata[i];
 
-struct _NetifWidget {
-	AdwBin base;
+		if (netif->qdisc->serial != self->qdisc_serial &&
+		    g_hash_table_contains(self->qdisc_watch_ht,
+			    GUINT_TO_POINTER(netif->qdisc->ifindex)))
+			g_ptr_array_add(gone, netif);
+	}
 
-	GListStore *netif_store;
-	GHashTable *netif_ht;
+	/* children of a deleted qdisc are deleted with it, anything else moves up */
+	for (guint i = 0; i < self->qdisc_links->len; i++) {
+		struct netif_link *netif = self->qdisc_links->pdata[i];
 
-	struct nl_sock *nlsock;
-	struct nl_msg *nlmsg;
-	struct nl_cb *nlcb;
+		if (netif->up->qdisc && netif->qdisc->serial == self->qdisc_serial &&
+		    g_ptr_array_find(gone, netif->up, NULL)) {
+			netif_link_model_remove(netif->up->qdiscs, netif);
+			netif_widget_qdisc_list(self, netif->dev, netif);
+		}
+	}
 
-	int nl_timeout_id;
+	netif_widget_qdisc_free(self, gone);
+	self->qdisc_pending = 0;
 
-	struct nl_sock *rtnl_sock;
-	int rtnl_id;
+	/* the interface tooltips sum up their qdiscs */
+	g_hash_table_iter_init(&iter, self->qdisc_watch_ht);
+	while (g_hash_table_iter_next(&iter, &ifindex, NULL)) {
+		struct netif_link *dev = g_hash_table_lookup(self->netif_ht, ifindex);
 
-	bool raw_bytes;
-	bool simple_mode;
+		if (dev)
+			netif_link_notify(dev);
+	}
+}
 
-	GtkColumnViewColumn *index_column;
-	GtkColumnViewColumn *rx_packets_column;
-	GtkColumnViewColumn *tx_packets_column;
-};
+static void netif_widget_update_link(const struct netif_sample *sample, gpointer data)
+{
+	NetifWidget *self = data;
+	GHashTable *netif_ht = self->agent ? self->agent->netif_ht : self->netif_ht;
+	char ifname[IF_NAMESIZE];
+	const char *name = sample->ifname;
+	/* a single-link dump runs between ticks, count it with the next one */
+	guint64 tick = self->tick + self->dump_link;
 
-enum {
-	PROP_RAW_BYTES = 1,
-	PROP_SIMPLE_MODE,
-};
+	if (!name)
+		name = if_indextoname(sample->ifindex, ifname);
 
-G_DEFINE_FINAL_TYPE(NetifWidget, netif_widget, ADW_TYPE_BIN)
+	struct netif_link *netif = g_hash_table_lookup(netif_ht,
+			GUINT_TO_POINTER(sample->ifindex));
+
+	if (!netif) {
+		struct netif_counters new = {
+			.rx_packets = sample->rx_packets,
+			.tx_packets = sample->tx_packets,
+			.rx_bytes = sample->rx_bytes,
+			.tx_bytes = sample->tx_bytes,
+		};
+
+		netif = netif_link_new(self->table, sample->ifindex, name);
+		netif->host = self->agent ? self->agent->host : self->host;
+		netif->qdisc_watch = !self->agent && netif_widget_qdisc_match(self, name);
+		netif->pinned = !self->agent && netif_widget_pin_match(self, name);
+		netif_link_sample(netif, &new, self->sample_time, tick);
+		netif_link_col(netif, change_tick) = tick;
+		netif->hist = g_new0(struct netif_hist, 2);
+		netif->history = netif_widget_history_open(self, name);
+		netif_widget_update_offload(self, netif, sample, 0);
+		g_hash_table_insert(netif_ht, GUINT_TO_POINTER(sample->ifindex), netif);
+		if (self->dbus && !self->agent)
+			netif_dbus_link_added(self->dbus, sample->ifindex);
+
+		struct netif_link_info *info = self->agent ? NULL :
+			g_hash_table_lookup(self->link_info_ht, GUINT_TO_POINTER(sample->ifindex));
+		if (info) {
+			netif_widget_apply_link_info(self, netif, info);
+			netif_widget_apply_speed(self, netif, info);
+		}
+
+		struct netif_link *group = netif_widget_group_lookup(self, netif);
+		if (group)
+			netif_widget_group_join(self, netif, group);
+		else
+			netif_link_model_append(self->netif_store, netif);
+	} else {
+		gint64 dt = self->sample_time - netif_link_col(netif, sample_time);
+		struct netif_counters old, new = {
+			.rx_packets = sample->rx_packets,
+			.tx_packets = sample->tx_packets,
+			.rx_bytes = sample->rx_bytes,
+			.tx_bytes = sample->tx_bytes,
+			.rx_rate = netif_link_col(netif, rx_rate),
+			.tx_rate = netif_link_col(netif, tx_rate),
+		};
+		bool renamed = g_strcmp0(name, netif->ifname) != 0;
+
+		netif_widget_update_offload(self, netif, sample, dt);
+		netif_link_counters_get(netif, &old);
+
+		/* rates follow for the whole table in netif_widget_rates() */
+		netif_link_sample(netif, &new, self->sample_time, tick);
+
+		if (netif->group)
+			netif_group_add(netif->group, &new, &old);
+
+		if (renamed) {
+			netif_link_col(netif, change_tick) = tick;
+			g_free(netif->ifname);
+			netif->ifname = g_strdup(name);
+			netif->table->serial++;
+
+			/* history files are by name, follow the interface to its new one */
+			g_clear_pointer(&netif->history, netif_history_close);
+			netif->history = netif_widget_history_open(self, name);
+
+			if (!self->agent) {
+				netif->qdisc_watch = netif_widget_qdisc_match(self, name);
+				netif->pinned = netif_widget_pin_match(self, name);
+			}
+
+			netif_widget_regroup(self, netif);
+			netif_widget_refilter(self, netif);
+		}
+	}
+}
 
-static gboolean netlink_send_func(gpointer data)
+/* Keep up to NETIF_SPEED_INFLIGHT requests out, each reply makes room */
+static void netif_widget_speed_flush(NetifWidget *self)
 {
-	NetifWidget *self = data;
-	struct nlmsghdr *nlmsghdr = nlmsg_hdr(self->nlmsg);
+	GArray *queue = self->speed_queue;
+	guint n = 0;
+
+	while (n < queue->len && self->speed_inflight < NETIF_SPEED_INFLIGHT) {
+		guint ifindex = g_array_index(queue, guint, n++);
+		int err = netif_ethtool_request(self->ethtool_sock, self->ethtool_family,
+				ifindex);
+
+		if (err < 0)
+			g_warning("ethtool request for %u: %s", ifindex, g_strerror(-err));
+		else
+			self->speed_inflight++;
+	}
 
-	nlmsghdr->nlmsg_seq = NL_AUTO_SEQ;
-	int err = nl_send_auto(self->nlsock, self->nlmsg);
-	if (err < 0)
-		g_warning("nl_send_auto error %d\n", err);
+	g_array_remove_range(queue, 0, n);
+}
 
-	nl_recvmsgs(self->nlsock, self->nlcb);
+static void netif_widget_speed_queue(NetifWidget *self, guint ifindex)
+{
+	if (!self->ethtool_sock)
+		return;
 
-	return G_SOURCE_CONTINUE;
+	g_array_append_val(self->speed_queue, ifindex);
+	netif_widget_speed_flush(self);
 }
 
-static int netlink_msg_handler(struct nl_msg *msg, void *arg)
+static int ethtool_recv(struct nl_msg *msg, void *arg)
 {
-	struct rtattr *tb[IFLA_STATS_MAX + 1];
-	struct nlmsghdr *nlmsghdr = nlmsg_hdr(msg);
-	struct rtattr *rta;
-	int rta_len;
-	struct rtnl_link_stats64 *stats;
-	struct if_stats_msg *stats_msg = nlmsg_data(nlmsghdr);
-	char ifname[IF_NAMESIZE];
 	NetifWidget *self = arg;
+	struct netif_ethtool_speed speed;
+	struct netif_link_info *info;
+	struct netif_link *netif;
 
-	if (nlmsghdr->nlmsg_type != RTM_NEWSTATS)
-		g_warning("%s: received type %d, not %d", __func__,
-				nlmsghdr->nlmsg_type, RTM_NEWSTATS);
+	if (self->speed_inflight)
+		self->speed_inflight--;
 
-	memset(tb, 0, sizeof(tb));
-	rta = (void *)nlmsghdr + NLMSG_SPACE(sizeof(struct if_stats_msg));
-	rta_len = NLMSG_PAYLOAD(nlmsghdr, sizeof(struct if_stats_msg));
+	if (netif_ethtool_parse(nlmsg_hdr(msg), &speed) < 0)
+		return NL_SKIP;
 
-	while (RTA_OK(rta, rta_len)) {
-		unsigned short type = rta->rta_type;
+	/* kept with the state, a row made later picks it up from there */
+	info = g_hash_table_lookup(self->link_info_ht, GUINT_TO_POINTER(speed.ifindex));
+	if (!info)
+		return NL_OK;
 
-		if (type <= IFLA_STATS_MAX && !tb[type])
-			tb[type] = rta;
+	info->speed = speed.speed;
+	info->half_duplex = speed.half_duplex;
 
-		rta = RTA_NEXT(rta, rta_len);
-	}
+	netif = g_hash_table_lookup(self->netif_ht, GUINT_TO_POINTER(speed.ifindex));
+	if (netif)
+		netif_widget_apply_speed(self, netif, info);
 
-	g_assert(tb[IFLA_STATS_LINK_64]);
-	g_assert(tb[IFLA_STATS_LINK_64]->rta_len == RTA_LENGTH(sizeof(*stats)));
-	stats = RTA_DATA(tb[IFLA_STATS_LINK_64]);
+	return NL_OK;
+}
+
+/* No link modes, such as lo, or the interface is gone */
+static int ethtool_error(struct sockaddr_nl *nla, struct nlmsgerr *err, void *arg)
+{
+	NetifWidget *self = arg;
 
-	NetifLinkStats *netif = g_hash_table_lookup(self->netif_ht,
-			GUINT_TO_POINTER(stats_msg->ifindex));
+	if (self->speed_inflight)
+		self->speed_inflight--;
 
-	if (!netif) {
-		netif = g_object_new(NETIF_TYPE_LINK_STATS,
-				"ifindex", stats_msg->ifindex,
-				"ifname", if_indextoname(stats_msg->ifindex, ifname),
-				"rx-bytes", stats->rx_bytes,
-				"tx-bytes", stats->tx_bytes,
-				"rx-packets", stats->rx_packets,
-				"tx-packets", stats->tx_packets,
-				NULL);
-		g_hash_table_insert(self->netif_ht, GUINT_TO_POINTER(stats_msg->ifindex), netif);
-		g_list_store_append(self->netif_store, netif);
-	} else {
-		g_object_set(G_OBJECT(netif),
-				"ifindex", stats_msg->ifindex,
-				"ifname", if_indextoname(stats_msg->ifindex, ifname),
-				"rx-bytes", stats->rx_bytes,
-				"tx-bytes", stats->tx_bytes,
-				"rx-packets", stats->rx_packets,
-				"tx-packets", stats->tx_packets,
-				"rx-rate", stats->rx_bytes - netif->rx_bytes,
-				"tx-rate", stats->tx_bytes - netif->tx_bytes,
-				NULL);
+	return NL_SKIP;
+}
+
+static void rtnl_newlink(NetifWidget *self, struct nlmsghdr *hdr)
+{
+	struct ifinfomsg *ifmsg = nlmsg_data(hdr);
+	struct nlattr *tb[IFLA_MAX + 1];
+	struct netif_link_info *info;
+	guint master = 0;
+	guint8 operstate;
+	guint flags = ifmsg->ifi_flags & NETIF_STATE_FLAGS;
+	int carrier;
+	bool master_changed, state_changed;
+
+	if (nlmsg_parse(hdr, sizeof(*ifmsg), tb, IFLA_MAX, NULL) < 0)
+		return;
+
+	info = g_hash_table_lookup(self->link_info_ht, GUINT_TO_POINTER(ifmsg->ifi_index));
+	if (!info) {
+		info = g_new0(struct netif_link_info, 1);
+		info->carrier = -1;
+		info->since = self->rtnl_time;
+		g_hash_table_insert(self->link_info_ht, GUINT_TO_POINTER(ifmsg->ifi_index), info);
 	}
 
-	return NL_OK;
+	if (tb[IFLA_MASTER])
+		master = nla_get_u32(tb[IFLA_MASTER]);
+	operstate = tb[IFLA_OPERSTATE] ? nla_get_u8(tb[IFLA_OPERSTATE]) : 0;
+	carrier = tb[IFLA_CARRIER] ? nla_get_u8(tb[IFLA_CARRIER]) : -1;
+
+	master_changed = master != info->master;
+	state_changed = operstate != info->operstate || flags != info->flags ||
+			carrier != info->carrier;
+
+	info->master = master;
+	info->operstate = operstate;
+	info->flags = flags;
+	info->carrier = carrier;
+	info->netnsid = tb[IFLA_LINK_NETNSID] ? (gint32)nla_get_u32(tb[IFLA_LINK_NETNSID]) : -1;
+	if (state_changed)
+		info->since = self->rtnl_time;
+
+	/* the speed is negotiated with the carrier, ask only when that moves */
+	if (state_changed)
+		netif_widget_speed_queue(self, ifmsg->ifi_index);
+
+	struct netif_link *link = g_hash_table_lookup(self->netif_ht,
+			GUINT_TO_POINTER(ifmsg->ifi_index));
+	if (!link)
+		return;
+
+	netif_widget_apply_link_info(self, link, info);
+
+	/* counters around a flap matter, don't wait for the next tick */
+	if (state_changed)
+		netif_widget_dump_link(self, link);
+
+	if (master_changed) {
+		netif_widget_regroup(self, link);
+		netif_widget_group_flush(self);
+	}
 }
 
 static int rtnl_recv(struct nl_msg *msg, void *arg)
@@ -298,108 +1398,488 @@ static int rtnl_recv(struct nl_msg *msg, void *arg)
 
 	struct nlmsghdr *hdr = nlmsg_hdr(msg);
 
-	if (hdr->nlmsg_type == RTM_DELLINK) {
+	if (hdr->nlmsg_type == RTM_NEWLINK) {
+		rtnl_newlink(self, hdr);
+	} else if (hdr->nlmsg_type == RTM_NEWQDISC) {
+		rtnl_newqdisc(self, hdr);
+	} else if (hdr->nlmsg_type == RTM_DELLINK) {
 		struct ifinfomsg *ifmsg = nlmsg_data(hdr);
 
-		NetifLinkStats *link = g_hash_table_lookup(self->netif_ht,
-				GUINT_TO_POINTER(ifmsg->ifi_index));
-
-		if (link) {
-			guint pos;
-
-			if (g_list_store_find(self->netif_store, link, &pos))
-				g_list_store_remove(self->netif_store, pos);
-		}
+		netif_widget_remove_link(self, ifmsg->ifi_index);
+		netif_widget_group_flush(self);
 	}
 
 	return NL_OK;
 }
 
+static int rtnl_finish(struct nl_msg *msg, void *arg)
+{
+	NetifWidget *self = arg;
+
+	/* the startup RTM_GETLINK dump ends here too */
+	if (self->qdisc_pending)
+		rtnl_qdisc_done(self);
+
+	return NL_STOP;
+}
+
+static gboolean netif_widget_batch_func(gpointer data)
+{
+	NetifWidget *self = data;
+
+	self->batch_id = 0;
+	netif_widget_dump_link_flush(self);
+	netif_widget_batch_end(self);
+
+	return G_SOURCE_REMOVE;
+}
+
 static int rtnl_recv_func(gint fd, GIOCondition cond, gpointer data)
 {
 	NetifWidget *self = data;
 
+	/*
+	 * A storm of link events keeps the socket readable, so the idle only
+	 * runs once it is drained; its priority is still ahead of the redraw.
+	 */
+	if (!self->batch_id) {
+		netif_widget_batch_begin(self);
+		self->batch_id = g_idle_add_full(G_PRIORITY_HIGH_IDLE,
+				netif_widget_batch_func, self, NULL);
+	}
+
+	/* one timestamp per read, taken before any parsing */
+	self->rtnl_time = g_get_real_time();
+	self->qdisc_time = g_get_monotonic_time();
 	nl_recvmsgs_default(self->rtnl_sock);
 
 	return G_SOURCE_CONTINUE;
 }
 
-static int netif_widget_netlink_init(NetifWidget *self)
+static int ethtool_recv_func(gint fd, GIOCondition cond, gpointer data)
+{
+	NetifWidget *self = data;
+
+	/* replies lost to a full buffer never come, stop waiting for them */
+	if (nl_recvmsgs_default(self->ethtool_sock) == -NLE_NOMEM)
+		self->speed_inflight = 0;
+
+	netif_widget_speed_flush(self);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void netif_first_dump_free(gpointer data)
+{
+	struct netif_first_dump *first = data;
+
+	if (first->source)
+		netif_source_free(first->source);
+	if (first->ethtool_sock)
+		nl_socket_free(first->ethtool_sock);
+	g_array_unref(first->samples);
+	g_string_chunk_free(first->names);
+	g_free(first->history_dir);
+	g_free(first);
+}
+
+static void netif_first_dump_sample(const struct netif_sample *sample, gpointer data)
+{
+	struct netif_first_dump *first = data;
+	struct netif_sample copy = *sample;
+
+	if (sample->ifname)
+		copy.ifname = g_string_chunk_insert_const(first->names, sample->ifname);
+	g_array_append_val(first->samples, copy);
+}
+
+/* Link speeds are optional, kernels before 5.6 have no ethtool family */
+static void netif_first_dump_ethtool(struct netif_first_dump *first)
+{
+	struct nl_sock *sock = nl_socket_alloc();
+
+	if (!sock)
+		return;
+
+	if (nl_connect(sock, NETLINK_GENERIC) < 0 ||
+	    (first->ethtool_family = netif_ethtool_family(sock)) < 0) {
+		g_debug("no ethtool netlink, utilization is not shown");
+		nl_socket_free(sock);
+		return;
+	}
+
+	first->ethtool_sock = sock;
+}
+
+/*
+ * A dump of a large host takes long enough to drop frames, and the
+ * ethtool family lookup waits on the kernel. Both only touch @first,
+ * which the widget does not see until the worker is done.
+ */
+static void netif_first_dump_thread(GTask *task, gpointer object, gpointer data,
+		GCancellable *cancellable)
+{
+	struct netif_first_dump *first = data;
+
+	netif_first_dump_ethtool(first);
+
+	if (first->history_dir)
+		netif_history_prune(first->history_dir);
+
+	if (first->source) {
+		first->sample_time = g_get_monotonic_time();
+		first->err = netif_source_dump(first->source);
+	}
+
+	g_task_return_boolean(task, TRUE);
+}
+
+static void netif_widget_ethtool_init(NetifWidget *self, struct netif_first_dump *first)
+{
+	struct nl_sock *sock = g_steal_pointer(&first->ethtool_sock);
+
+	/* replies and errors are counted, matching them to requests is not needed */
+	nl_socket_set_nonblocking(sock);
+	nl_socket_disable_seq_check(sock);
+	nl_socket_disable_auto_ack(sock);
+	nl_socket_modify_cb(sock, NL_CB_VALID, NL_CB_CUSTOM, ethtool_recv, self);
+	nl_socket_modify_err_cb(sock, NL_CB_CUSTOM, ethtool_error, self);
+
+	self->ethtool_sock = sock;
+	self->ethtool_family = first->ethtool_family;
+	self->ethtool_id = g_unix_fd_add(nl_socket_get_fd(sock), G_IO_IN,
+			ethtool_recv_func, self);
+}
+
+static void netif_first_dump_done(GObject *object, GAsyncResult *result, gpointer data)
 {
-	struct nlmsghdr *nlmsghdr;
-	struct if_stats_msg *stats_msg;
+	NetifWidget *self = NETIF_WIDGET(object);
+	struct netif_first_dump *first = g_task_get_task_data(G_TASK(result));
+	GHashTableIter iter;
+	gpointer ifindex;
+
+	/* disposed meanwhile, the task data frees what the worker made */
+	if (!g_task_propagate_boolean(G_TASK(result), NULL))
+		return;
+
+	g_clear_object(&self->first_dump);
+
+	if (first->source) {
+		self->source = g_steal_pointer(&first->source);
+		self->source->func = netif_widget_update_link;
+		self->source->data = self;
+	}
+
+	/* links the RTM_GETLINK dump reported so far have no speed yet */
+	if (first->ethtool_sock) {
+		netif_widget_ethtool_init(self, first);
+		g_hash_table_iter_init(&iter, self->link_info_ht);
+		while (g_hash_table_iter_next(&iter, &ifindex, NULL))
+			netif_widget_speed_queue(self, GPOINTER_TO_UINT(ifindex));
+	}
 
-	self->nlcb = nl_cb_alloc(NL_CB_DEFAULT);
-	if (!self->nlcb)
-		return -ENOMEM;
+	netif_widget_tick(self, first);
 
-	nl_cb_set(self->nlcb, NL_CB_VALID, NL_CB_CUSTOM, netlink_msg_handler, self);
+	self->loaded = true;
+	g_object_notify(G_OBJECT(self), "loaded");
 
-	self->nlsock = nl_socket_alloc_cb(self->nlcb);
-	if (!self->nlsock) {
-		nl_cb_put(self->nlcb);
-		return -ENOMEM;
+	self->nl_timeout_id = g_timeout_add_seconds(1, netif_source_func, self);
+
+	/* a chart opened meanwhile can sample now */
+	netif_widget_update_chart(self);
+}
+
+/* The window shows the empty table until the worker is done */
+static void netif_widget_first_dump(NetifWidget *self)
+{
+	struct netif_first_dump *first = g_new0(struct netif_first_dump, 1);
+	g_autoptr(GTask) task = NULL;
+
+	first->samples = g_array_new(FALSE, FALSE, sizeof(struct netif_sample));
+	first->names = g_string_chunk_new(4096);
+	first->history_dir = g_strdup(self->history_dir);
+
+	/* the worker owns the source until it hands it back */
+	if (self->source) {
+		first->source = g_steal_pointer(&self->source);
+		first->source->func = netif_first_dump_sample;
+		first->source->data = first;
 	}
 
-	g_assert(nl_connect(self->nlsock, NETLINK_ROUTE) == 0);
-	nl_socket_set_nonblocking(self->nlsock);
-	nl_socket_set_peer_port(self->nlsock, 0);
-	nl_socket_set_peer_groups(self->nlsock, 0);
+	self->first_dump = g_cancellable_new();
+	task = g_task_new(self, self->first_dump, netif_first_dump_done, NULL);
+	g_task_set_task_data(task, first, netif_first_dump_free);
+	g_task_run_in_thread(task, netif_first_dump_thread);
+}
+
+static int netif_widget_source_init(NetifWidget *self)
+{
+	int err = 0;
+
+	for (guint i = 0; self->agent_specs && self->agent_specs[i]; i++) {
+		struct netif_widget_agent *agent = g_new0(struct netif_widget_agent, 1);
 
-	self->nlmsg = nlmsg_alloc();
-	if (!self->nlmsg) {
-		nl_close(self->nlsock);
-		nl_socket_free(self->nlsock);
-		nl_cb_put(self->nlcb);
-		return -ENOMEM;
+		agent->host = g_strdup(self->agent_specs[i]);
+		agent->client = netif_agent_client_new(agent->host);
+		agent->netif_ht = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+				NULL, netif_link_free);
+		g_ptr_array_add(self->agents, agent);
 	}
 
-	nlmsghdr = nlmsg_put(self->nlmsg, NL_AUTO_PID, NL_AUTO_SEQ, RTM_GETSTATS,
-			sizeof(struct if_stats_msg), NLM_F_REQUEST | NLM_F_DUMP);
-	stats_msg = nlmsg_data(nlmsghdr);
+	/* "none" watches agents only */
+	if (g_strcmp0(self->source_spec, "none") != 0)
+		err = netif_source_open(&self->source, self->source_spec,
+				netif_widget_update_link, self);
+	if (err < 0) {
+		g_warning("stats source %s: %s", self->source_spec ? self->source_spec : "netlink",
+				g_strerror(-err));
+		if (!self->agents->len)
+			return err;
+	}
 
-	memset(stats_msg, 0, sizeof(*stats_msg));
-	stats_msg->family = AF_INET;
-	stats_msg->filter_mask = IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64);
+	if (self->source)
+		self->source->timed = true;
 
-	int err = nl_send_auto(self->nlsock, self->nlmsg);
-	if (err < 0)
-		g_warning("nl_send_auto error %d\n", err);
+	if (self->source && self->record_path) {
+		err = netif_source_record(self->source, self->record_path);
+		if (err < 0)
+			g_warning("record %s: %s", self->record_path, g_strerror(-err));
+	}
 
-	nl_recvmsgs(self->nlsock, self->nlcb);
+	netif_widget_first_dump(self);
 
-	self->nl_timeout_id = g_timeout_add_seconds(1, netlink_send_func, self);
+	return 0;
+}
 
+/* Only binds and sends, the replies are read from the main loop */
+static int netif_widget_netlink_init(NetifWidget *self)
+{
 	self->rtnl_sock = nl_socket_alloc();
 	if (self->rtnl_sock) {
 		g_assert(nl_connect(self->rtnl_sock, NETLINK_ROUTE) == 0);
 
-		g_assert(nl_socket_add_membership(self->rtnl_sock, RTNLGRP_LINK) == 0);
+		g_assert(nl_socket_add_membership(self->rtnl_sock, RTNLGRP_LINK) == 0);
+
+		nl_socket_disable_seq_check(self->rtnl_sock);
+		struct nl_cb *rtnl_cb = nl_socket_get_cb(self->rtnl_sock);
+		nl_cb_set(rtnl_cb, NL_CB_VALID, NL_CB_CUSTOM, rtnl_recv, self);
+		nl_cb_set(rtnl_cb, NL_CB_FINISH, NL_CB_CUSTOM, rtnl_finish, self);
+		nl_cb_put(rtnl_cb);
+
+		self->rtnl_id = g_unix_fd_add(nl_socket_get_fd(self->rtnl_sock),
+					G_IO_IN, rtnl_recv_func, self);
+
+		/* the replies seed link_info_ht through rtnl_recv */
+		if (nl_rtgen_request(self->rtnl_sock, RTM_GETLINK, AF_UNSPEC, NLM_F_DUMP) < 0)
+			g_warning("RTM_GETLINK dump request failed");
+	}
+
+	return 0;
+}
+
+static void netif_widget_netlink_exit(NetifWidget *self)
+{
+	g_source_remove(self->rtnl_id);
+	nl_close(self->rtnl_sock);
+	nl_socket_free(self->rtnl_sock);
+
+	if (self->ethtool_sock) {
+		g_source_remove(self->ethtool_id);
+		nl_close(self->ethtool_sock);
+		nl_socket_free(self->ethtool_sock);
+	}
+
+	if (self->nl_timeout_id)
+		g_source_remove(self->nl_timeout_id);
+	g_clear_handle_id(&self->batch_id, g_source_remove);
+
+	/* the worker keeps running, its result is dropped */
+	if (self->first_dump) {
+		g_cancellable_cancel(self->first_dump);
+		g_clear_object(&self->first_dump);
+	}
+
+	if (self->source)
+		netif_source_free(self->source);
+	netif_softnet_close(&self->softnet);
+}
+
+GtkWidget *netif_widget_heatmap_new(NetifWidget *self, gboolean tx)
+{
+	return netif_heatmap_new(self->netif_ht, self->table, tx);
+}
+
+static void netif_widget_chart_sample(const struct netif_sample *sample, gpointer data)
+{
+	NetifWidget *self = data;
+	struct netif_link *netif = g_hash_table_lookup(self->netif_ht,
+			GUINT_TO_POINTER(sample->ifindex));
+
+	if (netif && self->chart)
+		netif_chart_sample(self->chart, netif, sample->rx_bytes, sample->tx_bytes);
+}
+
+/*
+ * Sample the charted links in one batched request. The samples only go
+ * to the chart, so rates, histograms and history keep their 1 s ticks.
+ */
+static gboolean netif_widget_chart_func(gpointer data)
+{
+	NetifWidget *self = data;
+	struct netif_source *src = self->source;
+	GArray *ifindex = self->chart_ifindex;
+
+	if (!self->chart) {
+		self->chart_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	if (src) {
+		struct netif_source_stats stats = src->stats;
+		netif_sample_func func = src->func;
+		gpointer func_data = src->data;
+		int err;
+
+		src->func = netif_widget_chart_sample;
+		src->data = self;
+		err = netif_source_dump_links(src, (guint *)ifindex->data, ifindex->len);
+		src->func = func;
+		src->data = func_data;
+		src->stats = stats;
+
+		if (err < 0)
+			g_debug("%s chart dump: %s", src->ops->name, g_strerror(-err));
+	}
+
+	netif_chart_push(self->chart);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void netif_widget_update_chart(NetifWidget *self)
+{
+	g_autoptr(GPtrArray) links = g_ptr_array_new_with_free_func(g_object_unref);
+	g_autoptr(GtkBitset) selected = NULL;
+	GtkBitsetIter iter;
+	guint pos;
+
+	if (!self->chart)
+		return;
+
+	g_array_set_size(self->chart_ifindex, 0);
+
+	selected = gtk_selection_model_get_selection(self->selection);
+	for (bool ok = gtk_bitset_iter_init_first(&iter, selected, &pos); ok;
+	     ok = gtk_bitset_iter_next(&iter, &pos)) {
+		g_autoptr(GtkTreeListRow) row = g_list_model_get_item(
+				G_LIST_MODEL(self->selection), pos);
+		NetifLinkStats *item = gtk_tree_list_row_get_item(row);
+		struct netif_link *netif = item->link;
+
+		/* groups, qdiscs and remote rows stay on the 1 s tick */
+		if (netif && g_hash_table_lookup(self->netif_ht,
+					GUINT_TO_POINTER(netif->ifindex)) == netif)
+			g_array_append_val(self->chart_ifindex, netif->ifindex);
+
+		g_ptr_array_add(links, item);
+	}
+
+	netif_chart_set_links(self->chart, links);
+
+	if (self->chart_ifindex->len && self->source && self->source->ops->dump_links) {
+		if (!self->chart_id)
+			self->chart_id = g_timeout_add(NETIF_CHART_INTERVAL,
+					netif_widget_chart_func, self);
+	} else {
+		g_clear_handle_id(&self->chart_id, g_source_remove);
+	}
+}
+
+GtkWidget *netif_widget_softnet_new(NetifWidget *self)
+{
+	GtkWidget *view = netif_softnet_view_new();
+
+	if (!self->softnet.buf) {
+		int err = netif_softnet_open(&self->softnet);
+		if (err < 0)
+			g_warning("softnet_stat: %s", g_strerror(-err));
+	}
+
+	/* one view at a time, a new one takes over */
+	g_set_weak_pointer(&self->softnet_view, NETIF_SOFTNET_VIEW(view));
+
+	return view;
+}
+
+GtkWidget *netif_widget_chart_new(NetifWidget *self)
+{
+	GtkWidget *chart = netif_chart_new();
+
+	g_set_weak_pointer(&self->chart, NETIF_CHART(chart));
+	netif_widget_update_chart(self);
+
+	return chart;
+}
+
+static void netif_widget_perf_map(GtkWidget *label, NetifWidget *self)
+{
+	g_autofree char *text = netif_perf_format(&self->perf);
+
+	gtk_label_set_text(GTK_LABEL(label), text);
+}
+
+GtkWidget *netif_widget_perf_new(NetifWidget *self)
+{
+	GtkWidget *label = gtk_label_new(NULL);
+
+	gtk_widget_add_css_class(label, "osd");
+	gtk_widget_add_css_class(label, "monospace");
+	gtk_widget_set_halign(label, GTK_ALIGN_END);
+	gtk_widget_set_valign(label, GTK_ALIGN_END);
+	gtk_widget_set_margin_end(label, 12);
+	gtk_widget_set_margin_bottom(label, 12);
+	gtk_widget_set_can_target(label, FALSE);
+
+	/* only refreshed while shown, catch up when it is */
+	g_signal_connect(label, "map", G_CALLBACK(netif_widget_perf_map), self);
+	g_set_weak_pointer(&self->perf_label, GTK_LABEL(label));
+
+	return label;
+}
+
+static int netif_ifname_cmp(gconstpointer a, gconstpointer b)
+{
+	const struct netif_link *x = *(struct netif_link **)a;
+	const struct netif_link *y = *(struct netif_link **)b;
+
+	return g_strcmp0(x->ifname, y->ifname);
+}
+
+int netif_widget_write_histograms(NetifWidget *self, FILE *out)
+{
+	g_autoptr(GPtrArray) links = g_hash_table_get_values_as_ptr_array(self->netif_ht);
 
-		nl_socket_disable_seq_check(self->rtnl_sock);
-		struct nl_cb *rtnl_cb = nl_socket_get_cb(self->rtnl_sock);
-		nl_cb_set(rtnl_cb, NL_CB_VALID, NL_CB_CUSTOM, rtnl_recv, self);
-		nl_cb_put(rtnl_cb);
+	g_ptr_array_sort(links, netif_ifname_cmp);
 
-		self->rtnl_id = g_unix_fd_add(nl_socket_get_fd(self->rtnl_sock),
-					G_IO_IN, rtnl_recv_func, self);
+	fprintf(out, "ifname,dir,lower,upper,seconds\n");
+	for (guint i = 0; i < links->len; i++) {
+		struct netif_link *netif = links->pdata[i];
+
+		netif_hist_write_csv(&netif->hist[0], netif->ifname, "rx", out);
+		netif_hist_write_csv(&netif->hist[1], netif->ifname, "tx", out);
 	}
 
-	return 0;
+	return ferror(out) ? -EIO : 0;
 }
 
-static void netif_widget_netlink_exit(NetifWidget *self)
+gboolean netif_widget_export(NetifWidget *self, GDBusConnection *conn,
+		const char *path, GError **error)
 {
-	g_source_remove(self->rtnl_id);
-	nl_close(self->rtnl_sock);
-	nl_socket_free(self->rtnl_sock);
+	g_return_val_if_fail(!self->dbus, FALSE);
 
-	g_source_remove(self->nl_timeout_id);
+	self->dbus = netif_dbus_new(conn, path, self->netif_ht, &self->perf, error);
 
-	nlmsg_free(self->nlmsg);
-	nl_close(self->nlsock);
-	nl_socket_free(self->nlsock);
-	nl_cb_put(self->nlcb);
+	return self->dbus != NULL;
 }
 
 static void netif_widget_dispose(GObject *object)
@@ -407,12 +1887,71 @@ static void netif_widget_dispose(GObject *object)
 	NetifWidget *self = NETIF_WIDGET(object);
 
 	netif_widget_netlink_exit(self);
+	g_clear_pointer(&self->dbus, netif_dbus_free);
+	g_clear_handle_id(&self->chart_id, g_source_remove);
+	g_clear_weak_pointer(&self->chart);
+	g_clear_weak_pointer(&self->softnet_view);
+	if (self->perf_label)
+		g_signal_handlers_disconnect_by_func(self->perf_label,
+				netif_widget_perf_map, self);
+	g_clear_weak_pointer(&self->perf_label);
+	/* the models point at links without owning them, drop the view first */
+	adw_bin_set_child(ADW_BIN(self), NULL);
 	g_hash_table_destroy(self->netif_ht);
+	g_ptr_array_unref(self->qdisc_links);
+	g_hash_table_destroy(self->qdisc_watch_ht);
+	g_ptr_array_unref(self->qdisc_rules);
+	g_strfreev(self->qdisc_specs);
+	g_ptr_array_unref(self->pin_rules);
+	g_strfreev(self->pin_specs);
+	g_array_unref(self->poll_ifindex);
+	g_array_unref(self->speed_queue);
+	g_array_unref(self->dump_link_queue);
+	g_array_unref(self->chart_ifindex);
+	g_ptr_array_unref(self->agents);
+	g_hash_table_destroy(self->group_ht);
+	netif_link_table_free(self->table);
+	g_hash_table_destroy(self->link_info_ht);
+	g_ptr_array_unref(self->group_rules);
+	g_object_unref(self->top_model);
+	g_clear_object(&self->tree);
+	g_clear_object(&self->top_tree);
+	g_clear_object(&self->filter_model);
+	g_clear_object(&self->filter);
+	g_strfreev(self->groups);
+	g_strfreev(self->agent_specs);
 	g_object_unref(self->netif_store);
+	g_free(self->source_spec);
+	g_free(self->record_path);
+	g_free(self->flap_log_path);
+	g_free(self->history_dir);
+	g_clear_pointer(&self->flap_log, fclose);
 
 	G_OBJECT_CLASS(netif_widget_parent_class)->dispose(object);
 }
 
+/* GtkListItem:item is the GtkTreeListRow wrapping a NetifLinkStats */
+static GtkExpression *netif_item_expression(void)
+{
+	return gtk_property_expression_new(GTK_TYPE_TREE_LIST_ROW,
+			gtk_property_expression_new(GTK_TYPE_LIST_ITEM, NULL, "item"),
+			"item");
+}
+
+static void host_setup_func(GtkSignalListItemFactory *self,
+		GtkListItem *list_item, gpointer data)
+{
+	GtkWidget *label = gtk_label_new("");
+	gtk_label_set_xalign(GTK_LABEL(label), 0);
+	gtk_list_item_set_child(list_item, label);
+
+	gtk_expression_bind(
+			gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
+				netif_item_expression(),
+				"host"),
+			label, "label", list_item);
+}
+
 static void index_setup_func(GtkSignalListItemFactory *self,
 		GtkListItem *list_item, gpointer data)
 {
@@ -422,8 +1961,7 @@ static void index_setup_func(GtkSignalListItemFactory *self,
 
 	gtk_expression_bind(
 			gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
-				gtk_property_expression_new(GTK_TYPE_LIST_ITEM,
-					NULL, "item"),
+				netif_item_expression(),
 				"ifindex"),
 			label, "label", list_item);
 }
@@ -431,20 +1969,95 @@ static void index_setup_func(GtkSignalListItemFactory *self,
 static void name_setup_func(GtkSignalListItemFactory *self,
 		GtkListItem *list_item, gpointer data)
 {
+	GtkWidget *expander = gtk_tree_expander_new();
 	GtkWidget *label = gtk_label_new("");
 	gtk_label_set_xalign(GTK_LABEL(label), 0);
-	gtk_list_item_set_child(list_item, label);
+	gtk_tree_expander_set_child(GTK_TREE_EXPANDER(expander), label);
+	gtk_list_item_set_child(list_item, expander);
+
+	gtk_expression_bind(
+			gtk_property_expression_new(GTK_TYPE_LIST_ITEM, NULL, "item"),
+			expander, "list-row", list_item);
 
 	gtk_expression_bind(
 			gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
-				gtk_property_expression_new(GTK_TYPE_LIST_ITEM,
-					NULL, "item"),
+				netif_item_expression(),
 				"ifname"),
 			label, "label", list_item);
 }
 
+static char *state_tooltip_func(GtkListItem *item, NetifLinkStats *stats,
+		gint64 since, guint flaps)
+{
+	struct netif_link *netif = stats ? stats->link : NULL;
+	guint32 drops = 0, backlog = 0;
+	struct netif_link *qdisc;
+
+	if (!netif || !netif->state)
+		return NULL;
+
+	if (netif->qdisc)
+		return g_strdup_printf("%s, parent %x:%x\n%u dropped, %u overlimits, %u requeues\n"
+				"%u packets, %u bytes queued",
+				netif->ifname, TC_H_MAJ(netif->qdisc->parent) >> 16,
+				TC_H_MIN(netif->qdisc->parent), netif->qdisc->drops,
+				netif->qdisc->overlimits, netif->qdisc->requeues,
+				netif->qdisc->qlen, netif->qdisc->backlog);
+
+	/* the top-level qdiscs once they have been polled */
+	for (guint i = 0; netif->qdiscs &&
+	     (qdisc = netif_link_model_get_link(netif->qdiscs, i)); i++) {
+		drops += qdisc->qdisc->drops;
+		backlog += qdisc->qdisc->backlog;
+	}
+
+	g_autoptr(GDateTime) dt = g_date_time_new_from_unix_local(since / G_USEC_PER_SEC);
+	g_autoptr(GDateTime) t = g_date_time_add(dt, since % G_USEC_PER_SEC);
+	g_autofree char *stamp = g_date_time_format(t, "%H:%M:%S.%f");
+
+	g_autofree char *qdiscs = netif->qdiscs && g_list_model_get_n_items(
+			G_LIST_MODEL(netif->qdiscs)) ?
+		g_strdup_printf("\nqdisc %u dropped, %u bytes queued", drops, backlog) : NULL;
+
+	return g_strdup_printf("%s%s, carrier %s\nsince %s, %u changes%s",
+			netif->flags & IFF_UP ? "UP" : "DOWN",
+			netif->flags & IFF_RUNNING ? ",RUNNING" : "",
+			netif->carrier < 0 ? "unknown" : netif->carrier ? "on" : "off",
+			stamp, flaps, qdiscs ? qdiscs : "");
+}
+
+static void state_setup_func(GtkSignalListItemFactory *self,
+		GtkListItem *list_item, gpointer data)
+{
+	GtkWidget *label = gtk_label_new("");
+	gtk_label_set_xalign(GTK_LABEL(label), 0);
+	gtk_list_item_set_child(list_item, label);
+
+	gtk_expression_bind(
+			gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
+				netif_item_expression(),
+				"state"),
+			label, "label", list_item);
+
+	GtkExpression *expr[3] = {
+		netif_item_expression(),
+		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
+			netif_item_expression(),
+			"state-since"),
+		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
+			netif_item_expression(),
+			"flaps"),
+	};
+
+	gtk_expression_bind(
+			gtk_cclosure_expression_new(G_TYPE_STRING,
+				NULL, 3, expr, G_CALLBACK(state_tooltip_func), NULL, NULL),
+			label, "tooltip-text", list_item);
+}
+
 static char *bytes_calc_func(GtkListItem *item, guint64 rate, NetifWidget *netif)
 {
+	gint64 start = netif_perf_now();
 	char buf[128];
 
 	if (rate == 0) {
@@ -463,6 +2076,8 @@ static char *bytes_calc_func(GtkListItem *item, guint64 rate, NetifWidget *netif
 				(double)rate / (1024.0 * 1024.0 * 1024.0));
 	}
 
+	netif->format_ns += netif_perf_now() - start;
+
 	return g_strdup(buf);
 }
 
@@ -477,8 +2092,7 @@ static void rx_bytes_setup_func(GtkSignalListItemFactory *self,
 
 	GtkExpression *expr[2] = {
 		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
-			gtk_property_expression_new(GTK_TYPE_LIST_ITEM,
-				NULL, "item"),
+			netif_item_expression(),
 			"rx-bytes"),
 		gtk_object_expression_new(G_OBJECT(data))
 	};
@@ -499,8 +2113,7 @@ static void tx_bytes_setup_func(GtkSignalListItemFactory *self,
 
 	GtkExpression *expr[2] = {
 		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
-			gtk_property_expression_new(GTK_TYPE_LIST_ITEM,
-				NULL, "item"),
+			netif_item_expression(),
 			"tx-bytes"),
 		gtk_object_expression_new(G_OBJECT(data))
 	};
@@ -521,8 +2134,7 @@ static void rx_packets_setup_func(GtkSignalListItemFactory *self,
 
 	gtk_expression_bind(
 			gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
-				gtk_property_expression_new(GTK_TYPE_LIST_ITEM,
-					NULL, "item"),
+				netif_item_expression(),
 				"rx-packets"),
 			label, "label", list_item);
 }
@@ -537,14 +2149,14 @@ static void tx_packets_setup_func(GtkSignalListItemFactory *self,
 
 	gtk_expression_bind(
 			gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
-				gtk_property_expression_new(GTK_TYPE_LIST_ITEM,
-					NULL, "item"),
+				netif_item_expression(),
 				"tx-packets"),
 			label, "label", list_item);
 }
 
 static char *rate_calc_func(GtkListItem *item, guint64 rate, NetifWidget *netif)
 {
+	gint64 start = netif_perf_now();
 	char buf[128];
 
 	if (rate == 0) {
@@ -563,9 +2175,36 @@ static char *rate_calc_func(GtkListItem *item, guint64 rate, NetifWidget *netif)
 				(double)rate / (1024.0 * 1024.0 * 1024.0));
 	}
 
+	netif->format_ns += netif_perf_now() - start;
+
 	return g_strdup(buf);
 }
 
+/* Packet rate and mean packet size of the rate pass, on sampled rows */
+static char *rate_tooltip(struct netif_link *netif, guint64 pps, guint32 size)
+{
+	if (!netif || netif->children || netif->qdisc || !pps)
+		return NULL;
+
+	return g_strdup_printf("%"PRIu64" packets/s, %u bytes each on average", pps, size);
+}
+
+static char *rx_rate_tooltip_func(GtkListItem *item, NetifLinkStats *stats, guint64 rate)
+{
+	struct netif_link *netif = stats ? stats->link : NULL;
+
+	return rate_tooltip(netif, netif ? netif_link_col(netif, rx_pps) : 0,
+			netif ? netif_link_col(netif, rx_size) : 0);
+}
+
+static char *tx_rate_tooltip_func(GtkListItem *item, NetifLinkStats *stats, guint64 rate)
+{
+	struct netif_link *netif = stats ? stats->link : NULL;
+
+	return rate_tooltip(netif, netif ? netif_link_col(netif, tx_pps) : 0,
+			netif ? netif_link_col(netif, tx_size) : 0);
+}
+
 static void rx_rate_setup_func(GtkSignalListItemFactory *self,
 		GtkListItem *list_item, gpointer data)
 {
@@ -576,8 +2215,7 @@ static void rx_rate_setup_func(GtkSignalListItemFactory *self,
 
 	GtkExpression *expr[2] = {
 		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
-			gtk_property_expression_new(GTK_TYPE_LIST_ITEM,
-				NULL, "item"),
+			netif_item_expression(),
 			"rx-rate"),
 		gtk_object_expression_new(G_OBJECT(data))
 	};
@@ -586,6 +2224,18 @@ static void rx_rate_setup_func(GtkSignalListItemFactory *self,
 			gtk_cclosure_expression_new(G_TYPE_STRING,
 				NULL, 2, expr, G_CALLBACK(rate_calc_func), NULL, NULL),
 			label, "label", list_item);
+
+	/* packet rate and size have no property, a row notify re-reads them */
+	GtkExpression *tip_expr[2] = {
+		netif_item_expression(),
+		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
+			netif_item_expression(), "rx-rate"),
+	};
+
+	gtk_expression_bind(
+			gtk_cclosure_expression_new(G_TYPE_STRING,
+				NULL, 2, tip_expr, G_CALLBACK(rx_rate_tooltip_func), NULL, NULL),
+			label, "tooltip-text", list_item);
 }
 
 static void tx_rate_setup_func(GtkSignalListItemFactory *self,
@@ -598,8 +2248,7 @@ static void tx_rate_setup_func(GtkSignalListItemFactory *self,
 
 	GtkExpression *expr[2] = {
 		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
-			gtk_property_expression_new(GTK_TYPE_LIST_ITEM,
-				NULL, "item"),
+			netif_item_expression(),
 			"tx-rate"),
 		gtk_object_expression_new(G_OBJECT(data))
 	};
@@ -608,19 +2257,283 @@ static void tx_rate_setup_func(GtkSignalListItemFactory *self,
 			gtk_cclosure_expression_new(G_TYPE_STRING,
 				NULL, 2, expr, G_CALLBACK(rate_calc_func), NULL, NULL),
 			label, "label", list_item);
+
+	/* packet rate and size have no property, a row notify re-reads them */
+	GtkExpression *tip_expr[2] = {
+		netif_item_expression(),
+		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
+			netif_item_expression(), "tx-rate"),
+	};
+
+	gtk_expression_bind(
+			gtk_cclosure_expression_new(G_TYPE_STRING,
+				NULL, 2, tip_expr, G_CALLBACK(tx_rate_tooltip_func), NULL, NULL),
+			label, "tooltip-text", list_item);
+}
+
+static char *hw_share_func(GtkListItem *item, NetifLinkStats *stats,
+		guint64 rate, guint64 cpu_rate)
+{
+	struct netif_link *netif = stats ? stats->link : NULL;
+
+	if (!netif || !netif->offload)
+		return g_strdup("");
+	if (rate == 0)
+		return g_strdup("-");
+
+	return g_strdup_printf("%.1f%%",
+			100.0 * (rate > cpu_rate ? rate - cpu_rate : 0) / rate);
+}
+
+static char *hw_tooltip_func(GtkListItem *item, NetifLinkStats *stats,
+		guint64 rate, guint64 cpu_rate, NetifWidget *self)
+{
+	struct netif_link *netif = stats ? stats->link : NULL;
+
+	if (!netif || !netif->offload)
+		return NULL;
+
+	g_autofree char *cpu = rate_calc_func(item, cpu_rate, self);
+	g_autofree char *hw = rate_calc_func(item, rate > cpu_rate ? rate - cpu_rate : 0, self);
+
+	if (!netif->mpls)
+		return g_strdup_printf("CPU %s, HW %s", cpu, hw);
+
+	return g_strdup_printf("CPU %s, HW %s\nMPLS %"PRIu64" rx, %"PRIu64" tx packets",
+			cpu, hw, netif->mpls_rx_packets, netif->mpls_tx_packets);
+}
+
+static void hw_share_bind(GtkListItem *list_item, NetifWidget *self,
+		const char *rate, const char *cpu_rate)
+{
+	GtkWidget *label = gtk_label_new("");
+	gtk_label_set_xalign(GTK_LABEL(label), 0);
+	gtk_widget_set_size_request(GTK_WIDGET(label), 60, 0);
+	gtk_list_item_set_child(list_item, label);
+
+	GtkExpression *expr[3] = {
+		netif_item_expression(),
+		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
+			netif_item_expression(), rate),
+		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
+			netif_item_expression(), cpu_rate),
+	};
+
+	gtk_expression_bind(
+			gtk_cclosure_expression_new(G_TYPE_STRING,
+				NULL, 3, expr, G_CALLBACK(hw_share_func), NULL, NULL),
+			label, "label", list_item);
+
+	GtkExpression *tip_expr[4] = {
+		netif_item_expression(),
+		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
+			netif_item_expression(), rate),
+		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
+			netif_item_expression(), cpu_rate),
+		gtk_object_expression_new(G_OBJECT(self)),
+	};
+
+	gtk_expression_bind(
+			gtk_cclosure_expression_new(G_TYPE_STRING,
+				NULL, 4, tip_expr, G_CALLBACK(hw_tooltip_func), NULL, NULL),
+			label, "tooltip-text", list_item);
+}
+
+static void rx_hw_setup_func(GtkSignalListItemFactory *self,
+		GtkListItem *list_item, gpointer data)
+{
+	hw_share_bind(list_item, data, "rx-rate", "cpu-rx-rate");
+}
+
+static void tx_hw_setup_func(GtkSignalListItemFactory *self,
+		GtkListItem *list_item, gpointer data)
+{
+	hw_share_bind(list_item, data, "tx-rate", "cpu-tx-rate");
+}
+
+static char *util_func(GtkListItem *item, NetifLinkStats *stats, guint util)
+{
+	struct netif_link *netif = stats ? stats->link : NULL;
+
+	if (!netif || !netif->speed)
+		return g_strdup("");
+
+	return g_strdup_printf("%.1f%%", util / 100.0);
+}
+
+static char *util_tooltip_func(GtkListItem *item, NetifLinkStats *stats, guint util)
+{
+	struct netif_link *netif = stats ? stats->link : NULL;
+
+	if (!netif || !netif->speed)
+		return NULL;
+
+	return g_strdup_printf("%u Mb/s %s duplex", netif->speed,
+			netif->half_duplex ? "half" : "full");
+}
+
+static char **util_css_func(GtkListItem *item, guint util, NetifWidget *self)
+{
+	if (self->util_alert && util >= self->util_alert * 100)
+		return g_strdupv((char *[]){ "error", NULL });
+
+	return g_new0(char *, 1);
+}
+
+static void util_setup_func(GtkSignalListItemFactory *factory,
+		GtkListItem *list_item, gpointer data)
+{
+	GtkWidget *label = gtk_label_new("");
+	gtk_label_set_xalign(GTK_LABEL(label), 0);
+	gtk_widget_set_size_request(GTK_WIDGET(label), 60, 0);
+	gtk_list_item_set_child(list_item, label);
+
+	GtkExpression *expr[2] = {
+		netif_item_expression(),
+		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
+			netif_item_expression(), "utilization"),
+	};
+
+	gtk_expression_bind(
+			gtk_cclosure_expression_new(G_TYPE_STRING,
+				NULL, 2, expr, G_CALLBACK(util_func), NULL, NULL),
+			label, "label", list_item);
+
+	GtkExpression *tip_expr[2] = {
+		netif_item_expression(),
+		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
+			netif_item_expression(), "utilization"),
+	};
+
+	gtk_expression_bind(
+			gtk_cclosure_expression_new(G_TYPE_STRING,
+				NULL, 2, tip_expr, G_CALLBACK(util_tooltip_func), NULL, NULL),
+			label, "tooltip-text", list_item);
+
+	/* the alert threshold, in percent */
+	GtkExpression *css_expr[2] = {
+		gtk_property_expression_new(NETIF_TYPE_LINK_STATS,
+			netif_item_expression(), "utilization"),
+		gtk_object_expression_new(G_OBJECT(data)),
+	};
+
+	gtk_expression_bind(
+			gtk_cclosure_expression_new(G_TYPE_STRV,
+				NULL, 2, css_expr, G_CALLBACK(util_css_func), NULL, NULL),
+			label, "css-classes", list_item);
+}
+
+static GListModel *netif_children_func(gpointer item, gpointer data)
+{
+	NetifWidget *self = data;
+	struct netif_link *netif = NETIF_LINK_STATS(item)->link;
+
+	if (!netif)
+		return NULL;
+	if (netif->children)
+		return g_object_ref(G_LIST_MODEL(netif->children));
+
+	/* a qdisc with child qdiscs */
+	if (netif->qdisc)
+		return netif->qdiscs ? g_object_ref(G_LIST_MODEL(netif->qdiscs)) : NULL;
+
+	/* qdiscs of local interfaces, filled in and polled once expanded */
+	if (netif->host != self->host)
+		return NULL;
+	if (!netif->qdiscs)
+		netif->qdiscs = netif_link_model_new();
+
+	return g_object_ref(G_LIST_MODEL(netif->qdiscs));
+}
+
+static void netif_widget_agent_free(gpointer data)
+{
+	struct netif_widget_agent *agent = data;
+
+	netif_agent_client_free(agent->client);
+	g_hash_table_destroy(agent->netif_ht);
+	g_free(agent->host);
+	g_free(agent);
+}
+
+static void netif_group_rule_free(gpointer data)
+{
+	struct netif_group_rule *rule = data;
+
+	g_free(rule->name);
+	g_pattern_spec_free(rule->pattern);
+	g_free(rule);
+}
+
+static void netif_widget_set_top_mode(NetifWidget *self, bool top_mode)
+{
+	GtkTreeListModel *model = top_mode ? self->top_tree : self->tree;
+
+	self->top_mode = top_mode;
+
+	if (top_mode) {
+		GHashTableIter iter;
+		struct netif_link *netif;
+
+		netif_top_model_begin(self->top_model);
+		g_hash_table_iter_init(&iter, self->netif_ht);
+		while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&netif))
+			netif_top_model_update(self->top_model, netif,
+					netif_widget_top_key(self, netif));
+		netif_top_model_commit(self->top_model);
+	}
+
+	if (self->filter_model)
+		gtk_filter_list_model_set_model(self->filter_model, G_LIST_MODEL(model));
 }
 
 static void netif_widget_constructed(GObject *object)
 {
 	NetifWidget *self = NETIF_WIDGET(object);
 
+	for (guint i = 0; self->groups && self->groups[i]; i++) {
+		struct netif_group_rule *rule = g_new0(struct netif_group_rule, 1);
+		const char *eq = strchr(self->groups[i], '=');
+
+		rule->name = eq ? g_strndup(self->groups[i], eq - self->groups[i])
+				: g_strdup(self->groups[i]);
+		rule->pattern = g_pattern_spec_new(eq ? eq + 1 : self->groups[i]);
+		g_ptr_array_add(self->group_rules, rule);
+	}
+
+	for (guint i = 0; self->qdisc_specs && self->qdisc_specs[i]; i++)
+		g_ptr_array_add(self->qdisc_rules, g_pattern_spec_new(self->qdisc_specs[i]));
+
+	for (guint i = 0; self->pin_specs && self->pin_specs[i]; i++)
+		g_ptr_array_add(self->pin_rules, g_pattern_spec_new(self->pin_specs[i]));
+
 	GtkWidget *columnview = gtk_column_view_new(NULL);
-	GtkNoSelection *selection = gtk_no_selection_new(G_LIST_MODEL(self->netif_store));
-	gtk_column_view_set_model(GTK_COLUMN_VIEW(columnview), GTK_SELECTION_MODEL(selection));
+	self->columnview = columnview;
+	self->tree = gtk_tree_list_model_new(
+			G_LIST_MODEL(self->netif_store), FALSE, FALSE,
+			netif_children_func, self, NULL);
+	self->top_tree = gtk_tree_list_model_new(
+			G_LIST_MODEL(g_object_ref(self->top_model)), FALSE, FALSE,
+			netif_children_func, self, NULL);
+	self->filter_model = gtk_filter_list_model_new(NULL,
+			GTK_FILTER(g_object_ref(self->filter)));
+	gtk_filter_list_model_set_incremental(self->filter_model, TRUE);
+	self->selection = GTK_SELECTION_MODEL(gtk_multi_selection_new(
+				G_LIST_MODEL(g_object_ref(self->filter_model))));
+	g_signal_connect_swapped(self->selection, "selection-changed",
+			G_CALLBACK(netif_widget_update_chart), self);
+	gtk_column_view_set_model(GTK_COLUMN_VIEW(columnview), self->selection);
+	netif_widget_set_top_mode(self, self->top_mode);
 
 	GtkListItemFactory *name_factory = gtk_signal_list_item_factory_new();
 	GtkColumnViewColumn *name_column = gtk_column_view_column_new("Name", name_factory);
 
+	GtkListItemFactory *state_factory = gtk_signal_list_item_factory_new();
+	GtkColumnViewColumn *state_column = gtk_column_view_column_new("State", state_factory);
+
+	GtkListItemFactory *host_factory = gtk_signal_list_item_factory_new();
+	GtkColumnViewColumn *host_column = gtk_column_view_column_new("Host", host_factory);
+
 	GtkListItemFactory *index_factory = gtk_signal_list_item_factory_new();
 	GtkColumnViewColumn *index_column = gtk_column_view_column_new("Index", index_factory);
 
@@ -642,7 +2555,18 @@ static void netif_widget_constructed(GObject *object)
 	GtkListItemFactory *tx_rate_factory = gtk_signal_list_item_factory_new();
 	GtkColumnViewColumn *tx_rate_column = gtk_column_view_column_new("TxRate", tx_rate_factory);
 
+	GtkListItemFactory *util_factory = gtk_signal_list_item_factory_new();
+	GtkColumnViewColumn *util_column = gtk_column_view_column_new("Util", util_factory);
+
+	GtkListItemFactory *rx_hw_factory = gtk_signal_list_item_factory_new();
+	GtkColumnViewColumn *rx_hw_column = gtk_column_view_column_new("RxHW", rx_hw_factory);
+
+	GtkListItemFactory *tx_hw_factory = gtk_signal_list_item_factory_new();
+	GtkColumnViewColumn *tx_hw_column = gtk_column_view_column_new("TxHW", tx_hw_factory);
+
 	g_signal_connect(name_factory, "setup", G_CALLBACK(name_setup_func), NULL);
+	g_signal_connect(state_factory, "setup", G_CALLBACK(state_setup_func), NULL);
+	g_signal_connect(host_factory, "setup", G_CALLBACK(host_setup_func), NULL);
 	g_signal_connect(index_factory, "setup", G_CALLBACK(index_setup_func), NULL);
 	g_signal_connect(rx_bytes_factory, "setup", G_CALLBACK(rx_bytes_setup_func), self);
 	g_signal_connect(tx_bytes_factory, "setup", G_CALLBACK(tx_bytes_setup_func), self);
@@ -650,8 +2574,13 @@ static void netif_widget_constructed(GObject *object)
 	g_signal_connect(tx_packets_factory, "setup", G_CALLBACK(tx_packets_setup_func), NULL);
 	g_signal_connect(rx_rate_factory, "setup", G_CALLBACK(rx_rate_setup_func), self);
 	g_signal_connect(tx_rate_factory, "setup", G_CALLBACK(tx_rate_setup_func), self);
+	g_signal_connect(util_factory, "setup", G_CALLBACK(util_setup_func), self);
+	g_signal_connect(rx_hw_factory, "setup", G_CALLBACK(rx_hw_setup_func), self);
+	g_signal_connect(tx_hw_factory, "setup", G_CALLBACK(tx_hw_setup_func), self);
 
 	gtk_column_view_column_set_expand(name_column, TRUE);
+	gtk_column_view_column_set_expand(state_column, TRUE);
+	gtk_column_view_column_set_expand(host_column, TRUE);
 	gtk_column_view_column_set_expand(index_column, TRUE);
 	gtk_column_view_column_set_expand(rx_bytes_column, TRUE);
 	gtk_column_view_column_set_expand(tx_bytes_column, TRUE);
@@ -659,10 +2588,23 @@ static void netif_widget_constructed(GObject *object)
 	gtk_column_view_column_set_expand(tx_packets_column, TRUE);
 	gtk_column_view_column_set_expand(rx_rate_column, TRUE);
 	gtk_column_view_column_set_expand(tx_rate_column, TRUE);
+	gtk_column_view_column_set_expand(util_column, TRUE);
+	gtk_column_view_column_set_expand(rx_hw_column, TRUE);
+	gtk_column_view_column_set_expand(tx_hw_column, TRUE);
 
+	self->host_column = host_column;
 	self->index_column = index_column;
 	self->rx_packets_column = rx_packets_column;
 	self->tx_packets_column = tx_packets_column;
+	self->rx_hw_column = rx_hw_column;
+	self->tx_hw_column = tx_hw_column;
+
+	gtk_column_view_column_set_visible(rx_hw_column, FALSE);
+	gtk_column_view_column_set_visible(tx_hw_column, FALSE);
+
+	/* one host needs no column */
+	gtk_column_view_column_set_visible(host_column,
+			self->agent_specs && self->agent_specs[0]);
 
 	if (self->simple_mode) {
 		gtk_column_view_column_set_visible(index_column, FALSE);
@@ -670,7 +2612,9 @@ static void netif_widget_constructed(GObject *object)
 		gtk_column_view_column_set_visible(tx_packets_column, FALSE);
 	}
 
+	gtk_column_view_append_column(GTK_COLUMN_VIEW(columnview), host_column);
 	gtk_column_view_append_column(GTK_COLUMN_VIEW(columnview), name_column);
+	gtk_column_view_append_column(GTK_COLUMN_VIEW(columnview), state_column);
 	gtk_column_view_append_column(GTK_COLUMN_VIEW(columnview), index_column);
 	gtk_column_view_append_column(GTK_COLUMN_VIEW(columnview), rx_bytes_column);
 	gtk_column_view_append_column(GTK_COLUMN_VIEW(columnview), tx_bytes_column);
@@ -678,8 +2622,24 @@ static void netif_widget_constructed(GObject *object)
 	gtk_column_view_append_column(GTK_COLUMN_VIEW(columnview), tx_packets_column);
 	gtk_column_view_append_column(GTK_COLUMN_VIEW(columnview), rx_rate_column);
 	gtk_column_view_append_column(GTK_COLUMN_VIEW(columnview), tx_rate_column);
+	gtk_column_view_append_column(GTK_COLUMN_VIEW(columnview), util_column);
+	gtk_column_view_append_column(GTK_COLUMN_VIEW(columnview), rx_hw_column);
+	gtk_column_view_append_column(GTK_COLUMN_VIEW(columnview), tx_hw_column);
 
 	adw_bin_set_child(ADW_BIN(self), columnview);
+
+	if (self->history_dir && g_mkdir_with_parents(self->history_dir, 0755) < 0) {
+		g_warning("history %s: %s", self->history_dir, g_strerror(errno));
+		g_clear_pointer(&self->history_dir, g_free);
+	}
+
+	if (self->flap_log_path) {
+		self->flap_log = fopen(self->flap_log_path, "ae");
+		if (!self->flap_log)
+			g_warning("flap log %s: %s", self->flap_log_path, g_strerror(errno));
+	}
+
+	netif_widget_source_init(self);
 }
 
 static void netif_widget_get_property(GObject *object,
@@ -694,6 +2654,51 @@ static void netif_widget_get_property(GObject *object,
 	case PROP_SIMPLE_MODE:
 		g_value_set_boolean(value, self->simple_mode);
 		break;
+	case PROP_SOURCE:
+		g_value_set_string(value, self->source_spec);
+		break;
+	case PROP_RECORD:
+		g_value_set_string(value, self->record_path);
+		break;
+	case PROP_FLAP_LOG:
+		g_value_set_string(value, self->flap_log_path);
+		break;
+	case PROP_HISTORY_DIR:
+		g_value_set_string(value, self->history_dir);
+		break;
+	case PROP_GROUPS:
+		g_value_set_boxed(value, self->groups);
+		break;
+	case PROP_AGENTS:
+		g_value_set_boxed(value, self->agent_specs);
+		break;
+	case PROP_QDISC_WATCH:
+		g_value_set_boxed(value, self->qdisc_specs);
+		break;
+	case PROP_PIN:
+		g_value_set_boxed(value, self->pin_specs);
+		break;
+	case PROP_FULL_INTERVAL:
+		g_value_set_uint(value, self->full_interval);
+		break;
+	case PROP_TOP_MODE:
+		g_value_set_boolean(value, self->top_mode);
+		break;
+	case PROP_TOP_N:
+		g_value_set_uint(value, netif_top_model_get_limit(self->top_model));
+		break;
+	case PROP_TOP_BY_UTIL:
+		g_value_set_boolean(value, self->top_by_util);
+		break;
+	case PROP_UTIL_ALERT:
+		g_value_set_uint(value, self->util_alert);
+		break;
+	case PROP_FILTER_TEXT:
+		g_value_set_string(value, netif_filter_get_text(self->filter));
+		break;
+	case PROP_LOADED:
+		g_value_set_boolean(value, self->loaded);
+		break;
 	}
 }
 
@@ -723,6 +2728,60 @@ static void netif_widget_set_property(GObject *object,
 	case PROP_SIMPLE_MODE:
 		netif_widget_set_simple_mode(self, g_value_get_boolean(value));
 		break;
+	case PROP_SOURCE:
+		g_free(self->source_spec);
+		self->source_spec = g_value_dup_string(value);
+		break;
+	case PROP_RECORD:
+		g_free(self->record_path);
+		self->record_path = g_value_dup_string(value);
+		break;
+	case PROP_FLAP_LOG:
+		g_free(self->flap_log_path);
+		self->flap_log_path = g_value_dup_string(value);
+		break;
+	case PROP_HISTORY_DIR:
+		g_free(self->history_dir);
+		self->history_dir = g_value_dup_string(value);
+		break;
+	case PROP_GROUPS:
+		g_strfreev(self->groups);
+		self->groups = g_value_dup_boxed(value);
+		break;
+	case PROP_AGENTS:
+		g_strfreev(self->agent_specs);
+		self->agent_specs = g_value_dup_boxed(value);
+		break;
+	case PROP_QDISC_WATCH:
+		g_strfreev(self->qdisc_specs);
+		self->qdisc_specs = g_value_dup_boxed(value);
+		break;
+	case PROP_PIN:
+		g_strfreev(self->pin_specs);
+		self->pin_specs = g_value_dup_boxed(value);
+		break;
+	case PROP_FULL_INTERVAL:
+		self->full_interval = g_value_get_uint(value);
+		break;
+	case PROP_TOP_MODE:
+		netif_widget_set_top_mode(self, g_value_get_boolean(value));
+		break;
+	case PROP_TOP_N:
+		netif_top_model_set_limit(self->top_model, g_value_get_uint(value));
+		if (self->top_mode)
+			netif_widget_set_top_mode(self, TRUE);
+		break;
+	case PROP_TOP_BY_UTIL:
+		self->top_by_util = g_value_get_boolean(value);
+		if (self->top_mode)
+			netif_widget_set_top_mode(self, TRUE);
+		break;
+	case PROP_UTIL_ALERT:
+		self->util_alert = g_value_get_uint(value);
+		break;
+	case PROP_FILTER_TEXT:
+		netif_filter_set_text(self->filter, g_value_get_string(value));
+		break;
 	}
 }
 
@@ -745,12 +2804,114 @@ static void netif_widget_class_init(NetifWidgetClass *class)
 			g_param_spec_boolean("simple-mode", "simple mode", "simple mode",
 				TRUE,
 				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT));
+
+	g_object_class_install_property(object_class, PROP_SOURCE,
+			g_param_spec_string("source", "source", "stats source spec",
+				NULL,
+				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property(object_class, PROP_RECORD,
+			g_param_spec_string("record", "record", "file to record samples to",
+				NULL,
+				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property(object_class, PROP_FLAP_LOG,
+			g_param_spec_string("flap-log", "flap log", "file to append link state changes to",
+				NULL,
+				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property(object_class, PROP_HISTORY_DIR,
+			g_param_spec_string("history-dir", "history dir", "directory of persistent rollups",
+				NULL,
+				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property(object_class, PROP_GROUPS,
+			g_param_spec_boxed("groups", "groups", "NAME=GLOB interface groups",
+				G_TYPE_STRV,
+				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property(object_class, PROP_AGENTS,
+			g_param_spec_boxed("agents", "agents", "HOST[:PORT] of remote agents to merge",
+				G_TYPE_STRV,
+				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property(object_class, PROP_QDISC_WATCH,
+			g_param_spec_boxed("qdisc-watch", "qdisc watch",
+				"GLOBs of interfaces whose qdiscs are always polled",
+				G_TYPE_STRV,
+				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property(object_class, PROP_PIN,
+			g_param_spec_boxed("pin", "pin",
+				"GLOBs of interfaces sampled every tick even off screen",
+				G_TYPE_STRV,
+				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property(object_class, PROP_FULL_INTERVAL,
+			g_param_spec_uint("full-interval", "full interval",
+				"ticks between dumps of every interface, 1 for every tick",
+				1, G_MAXUINT, 10,
+				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT));
+
+	g_object_class_install_property(object_class, PROP_TOP_MODE,
+			g_param_spec_boolean("top-mode", "top mode", "show the busiest interfaces only",
+				FALSE,
+				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+	g_object_class_install_property(object_class, PROP_TOP_N,
+			g_param_spec_uint("top-n", "top n", "number of rows in top mode",
+				1, G_MAXUINT, 20,
+				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT));
+
+	g_object_class_install_property(object_class, PROP_TOP_BY_UTIL,
+			g_param_spec_boolean("top-by-util", "top by util",
+				"rank top mode by share of the link speed instead of rate",
+				FALSE,
+				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+	g_object_class_install_property(object_class, PROP_UTIL_ALERT,
+			g_param_spec_uint("util-alert", "util alert",
+				"utilization in percent that marks the Util cell, 0 for none",
+				0, 100, 0,
+				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property(object_class, PROP_FILTER_TEXT,
+			g_param_spec_string("filter-text", "filter text", "row filter",
+				NULL,
+				G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(object_class, PROP_LOADED,
+			g_param_spec_boolean("loaded", "loaded", "first dump done",
+				FALSE,
+				G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void netif_widget_init(NetifWidget *self)
 {
-	self->netif_ht = g_hash_table_new(g_direct_hash, g_direct_equal);
-	self->netif_store = g_list_store_new(NETIF_TYPE_LINK_STATS);
+	self->table = netif_link_table_new();
+	self->netif_ht = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, netif_link_free);
+	self->group_ht = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, netif_link_free);
+	self->link_info_ht = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, g_free);
+	self->filter = netif_filter_new();
+	self->group_rules = g_ptr_array_new_with_free_func(netif_group_rule_free);
+	self->agents = g_ptr_array_new_with_free_func(netif_widget_agent_free);
+	self->qdisc_links = g_ptr_array_new_with_free_func(netif_link_free);
+	self->qdisc_watch_ht = g_hash_table_new(g_direct_hash, g_direct_equal);
+	self->qdisc_rules = g_ptr_array_new_with_free_func(
+			(GDestroyNotify)g_pattern_spec_free);
+	self->pin_rules = g_ptr_array_new_with_free_func(
+			(GDestroyNotify)g_pattern_spec_free);
+	self->poll_ifindex = g_array_new(FALSE, FALSE, sizeof(guint));
+	self->speed_queue = g_array_new(FALSE, FALSE, sizeof(guint));
+	self->dump_link_queue = g_array_new(FALSE, FALSE, sizeof(guint));
+	self->chart_ifindex = g_array_new(FALSE, FALSE, sizeof(guint));
+	self->host = g_get_host_name();
+	self->softnet.fd = -1;
+	self->top_model = netif_top_model_new(NETIF_TYPE_LINK_STATS,
+			netif_link_stats_get, 20);
+	self->netif_store = netif_link_model_new();
 	g_object_ref(self->netif_store);
 
 	g_assert(netif_widget_netlink_init(self) == 0);
@@ -8,4 +8,21 @@ G_BEGIN_DECLS
 
 G_DECLARE_FINAL_TYPE(NetifWidget, netif_widget, NETIF, WIDGET, AdwBin)
 
+/* Serve the live table on @conn at @path, see netif-dbus.h */
+gboolean netif_widget_export(NetifWidget *self, GDBusConnection *conn,
+		const char *path, GError **error);
+
+/* Rate distribution heatmap of all interfaces, rx or @tx */
+GtkWidget *netif_widget_heatmap_new(NetifWidget *self, gboolean tx);
+int netif_widget_write_histograms(NetifWidget *self, FILE *out);
+
+/* Per-CPU softnet backlog rates, read on the same tick as the dump */
+GtkWidget *netif_widget_softnet_new(NetifWidget *self);
+
+/* Live rx/tx chart of the selected rows, fed on every dump */
+GtkWidget *netif_widget_chart_new(NetifWidget *self);
+
+/* Debug overlay with the cost of the recent ticks, see netif-perf.h */
+GtkWidget *netif_widget_perf_new(NetifWidget *self);
+
 G_END_DECLS
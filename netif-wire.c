@@ -0,0 +1,385 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include "netif-wire.h"
+
+void netif_wire_init(struct netif_wire *wire)
+{
+	*wire = (struct netif_wire){ 0 };
+	wire->links = g_array_new(FALSE, TRUE, sizeof(struct netif_wire_link));
+}
+
+void netif_wire_clear(struct netif_wire *wire)
+{
+	g_clear_pointer(&wire->links, g_array_unref);
+}
+
+static int netif_wire_link_cmp(gconstpointer a, gconstpointer b)
+{
+	const struct netif_wire_link *la = a, *lb = b;
+
+	return (la->ifindex > lb->ifindex) - (la->ifindex < lb->ifindex);
+}
+
+void netif_wire_sort(struct netif_wire *wire)
+{
+	g_array_sort(wire->links, netif_wire_link_cmp);
+}
+
+static void put_u8(GByteArray *out, guint8 val)
+{
+	g_byte_array_append(out, &val, 1);
+}
+
+static void put_varint(GByteArray *out, guint64 val)
+{
+	guint8 buf[10];
+	guint n = 0;
+
+	do {
+		buf[n] = val & 0x7f;
+		val >>= 7;
+		if (val)
+			buf[n] |= 0x80;
+		n++;
+	} while (val);
+
+	g_byte_array_append(out, buf, n);
+}
+
+/* Counters wrap and reset, a delta is the signed difference mod 2^64 */
+static guint64 zigzag(guint64 delta)
+{
+	return (delta << 1) ^ (guint64)((gint64)delta >> 63);
+}
+
+static guint64 unzigzag(guint64 val)
+{
+	return (val >> 1) ^ -(val & 1);
+}
+
+static void put_entry(GByteArray *out, guint *last, const struct netif_wire_link *link,
+		guint flags, const guint64 *val)
+{
+	put_varint(out, link->ifindex - *last);
+	*last = link->ifindex;
+	put_u8(out, flags);
+
+	if (flags & NETIF_WIRE_F_NAME) {
+		gsize len = strnlen(link->ifname, sizeof(link->ifname));
+
+		put_varint(out, len);
+		g_byte_array_append(out, (const guint8 *)link->ifname, len);
+	}
+
+	for (int i = 0; i < NETIF_WIRE_COUNTERS; i++)
+		if (flags & (1 << i))
+			put_varint(out, val[i]);
+}
+
+#define ALL_COUNTERS	((1 << NETIF_WIRE_COUNTERS) - 1)
+
+static guint netif_wire_encode_delta(const struct netif_wire *prev,
+		const struct netif_wire *cur, GByteArray *out)
+{
+	guint i = 0, j = 0, last = 0, count = 0;
+
+	while (i < prev->links->len || j < cur->links->len) {
+		const struct netif_wire_link *p = i < prev->links->len ?
+			&g_array_index(prev->links, struct netif_wire_link, i) : NULL;
+		const struct netif_wire_link *c = j < cur->links->len ?
+			&g_array_index(cur->links, struct netif_wire_link, j) : NULL;
+		guint64 val[NETIF_WIRE_COUNTERS];
+		guint flags = 0;
+
+		if (!c || (p && p->ifindex < c->ifindex)) {
+			put_entry(out, &last, p, NETIF_WIRE_F_REMOVED, NULL);
+			count++;
+			i++;
+			continue;
+		}
+
+		if (!p || c->ifindex < p->ifindex) {
+			/* new, its counters are deltas from zero */
+			flags = NETIF_WIRE_F_NAME | ALL_COUNTERS;
+			for (int n = 0; n < NETIF_WIRE_COUNTERS; n++)
+				val[n] = zigzag(c->counters[n]);
+			j++;
+		} else {
+			for (int n = 0; n < NETIF_WIRE_COUNTERS; n++) {
+				val[n] = zigzag(c->counters[n] - p->counters[n]);
+				if (val[n])
+					flags |= 1 << n;
+			}
+			if (strncmp(c->ifname, p->ifname, sizeof(c->ifname)) != 0)
+				flags |= NETIF_WIRE_F_NAME;
+			i++;
+			j++;
+		}
+
+		if (!flags)
+			continue;
+
+		put_entry(out, &last, c, flags, val);
+		count++;
+	}
+
+	return count;
+}
+
+static guint netif_wire_encode_keyframe(const struct netif_wire *cur, GByteArray *out)
+{
+	guint last = 0;
+
+	for (guint i = 0; i < cur->links->len; i++) {
+		const struct netif_wire_link *c = &g_array_index(cur->links,
+				struct netif_wire_link, i);
+
+		put_entry(out, &last, c, NETIF_WIRE_F_NAME | ALL_COUNTERS, c->counters);
+	}
+
+	return cur->links->len;
+}
+
+void netif_wire_encode(const struct netif_wire *prev, const struct netif_wire *cur,
+		GByteArray *out)
+{
+	g_autoptr(GByteArray) entries = g_byte_array_new();
+	g_autoptr(GByteArray) payload = g_byte_array_new();
+	guint count;
+
+	if (prev)
+		count = netif_wire_encode_delta(prev, cur, entries);
+	else
+		count = netif_wire_encode_keyframe(cur, entries);
+
+	put_u8(payload, prev ? NETIF_WIRE_DELTA : NETIF_WIRE_KEYFRAME);
+	put_varint(payload, cur->tick);
+	put_varint(payload, prev ? cur->time - prev->time : cur->time);
+	put_varint(payload, count);
+	g_byte_array_append(payload, entries->data, entries->len);
+
+	put_varint(out, payload->len);
+	g_byte_array_append(out, payload->data, payload->len);
+}
+
+struct reader {
+	const guint8 *p;
+	const guint8 *end;
+	bool error;
+};
+
+static guint64 get_varint(struct reader *r)
+{
+	guint64 val = 0;
+
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (r->p == r->end)
+			break;
+
+		guint8 b = *r->p++;
+
+		val |= (guint64)(b & 0x7f) << shift;
+		if (!(b & 0x80))
+			return val;
+	}
+
+	r->error = true;
+	return 0;
+}
+
+static guint8 get_u8(struct reader *r)
+{
+	if (r->p == r->end) {
+		r->error = true;
+		return 0;
+	}
+
+	return *r->p++;
+}
+
+gssize netif_wire_frame(const guint8 *buf, gsize len, gsize *payload)
+{
+	struct reader r = { buf, buf + len };
+	guint64 size = get_varint(&r);
+
+	if (r.error)
+		return len < 10 ? 0 : -EBADMSG;
+	if (size > NETIF_WIRE_MAX_FRAME)
+		return -EBADMSG;
+
+	*payload = r.p - buf;
+	if (len - *payload < size)
+		return 0;
+
+	return *payload + size;
+}
+
+/* Read a keyframe's links into a new array, in the order they are sent */
+static GArray *netif_wire_decode_keyframe(struct reader *r, guint64 count)
+{
+	GArray *links = g_array_sized_new(FALSE, TRUE, sizeof(struct netif_wire_link),
+			MIN(count, 65536));
+	guint last = 0;
+
+	for (guint64 n = 0; n < count && !r->error; n++) {
+		struct netif_wire_link link = { 0 };
+		guint64 gap = get_varint(r), len;
+
+		if (get_u8(r) != (NETIF_WIRE_F_NAME | ALL_COUNTERS) ||
+				(n && !gap) || gap > G_MAXUINT - last) {
+			r->error = true;
+			break;
+		}
+
+		link.ifindex = last += gap;
+		len = get_varint(r);
+		if (len >= sizeof(link.ifname) || len > (guint64)(r->end - r->p)) {
+			r->error = true;
+			break;
+		}
+		memcpy(link.ifname, r->p, len);
+		r->p += len;
+
+		for (int i = 0; i < NETIF_WIRE_COUNTERS; i++)
+			link.counters[i] = get_varint(r);
+
+		g_array_append_val(links, link);
+	}
+
+	return links;
+}
+
+static int netif_wire_decode_delta(struct netif_wire *wire, struct reader *r,
+		guint64 count, GArray *removed)
+{
+	guint pos = 0, last = 0;
+
+	for (guint64 n = 0; n < count; n++) {
+		struct netif_wire_link *link = NULL;
+		guint64 gap = get_varint(r);
+		guint flags = get_u8(r);
+		guint ifindex;
+
+		if (r->error || (n && !gap) || gap > G_MAXUINT - last)
+			return -EBADMSG;
+		ifindex = last += gap;
+
+		while (pos < wire->links->len &&
+		       g_array_index(wire->links, struct netif_wire_link, pos).ifindex < ifindex)
+			pos++;
+		if (pos < wire->links->len &&
+		    g_array_index(wire->links, struct netif_wire_link, pos).ifindex == ifindex)
+			link = &g_array_index(wire->links, struct netif_wire_link, pos);
+
+		if (flags & NETIF_WIRE_F_REMOVED) {
+			if (!link)
+				return -EBADMSG;
+			g_array_append_val(removed, ifindex);
+			g_array_remove_index(wire->links, pos);
+			continue;
+		}
+
+		if (!link) {
+			struct netif_wire_link new = { .ifindex = ifindex };
+
+			/* only a new link may be unknown, and it comes with a name */
+			if (!(flags & NETIF_WIRE_F_NAME))
+				return -EBADMSG;
+			g_array_insert_val(wire->links, pos, new);
+			link = &g_array_index(wire->links, struct netif_wire_link, pos);
+		}
+
+		if (flags & NETIF_WIRE_F_NAME) {
+			guint64 len = get_varint(r);
+
+			if (len >= sizeof(link->ifname) || len > (guint64)(r->end - r->p))
+				return -EBADMSG;
+			memset(link->ifname, 0, sizeof(link->ifname));
+			memcpy(link->ifname, r->p, len);
+			r->p += len;
+		}
+
+		for (int i = 0; i < NETIF_WIRE_COUNTERS; i++)
+			if (flags & (1 << i))
+				link->counters[i] += unzigzag(get_varint(r));
+
+		if (r->error)
+			return -EBADMSG;
+	}
+
+	return 0;
+}
+
+int netif_wire_decode(struct netif_wire *wire, const guint8 *buf, gsize len,
+		GArray *removed)
+{
+	struct reader r = { buf, buf + len };
+	guint8 type = get_u8(&r);
+	guint64 tick = get_varint(&r);
+	guint64 time = get_varint(&r);
+	guint64 count = get_varint(&r);
+	int err = 0;
+
+	if (r.error)
+		return -EBADMSG;
+
+	if (type == NETIF_WIRE_KEYFRAME) {
+		GArray *links = netif_wire_decode_keyframe(&r, count);
+		guint j = 0;
+
+		if (r.error) {
+			g_array_unref(links);
+			return -EBADMSG;
+		}
+
+		/* whatever the keyframe doesn't list is gone */
+		for (guint i = 0; i < wire->links->len; i++) {
+			guint ifindex = g_array_index(wire->links, struct netif_wire_link, i).ifindex;
+
+			while (j < links->len &&
+			       g_array_index(links, struct netif_wire_link, j).ifindex < ifindex)
+				j++;
+			if (j == links->len ||
+			    g_array_index(links, struct netif_wire_link, j).ifindex != ifindex)
+				g_array_append_val(removed, ifindex);
+		}
+
+		g_array_unref(wire->links);
+		wire->links = links;
+		wire->time = time;
+		wire->synced = true;
+	} else if (type == NETIF_WIRE_DELTA) {
+		if (!wire->synced)
+			return -EPROTO;
+
+		err = netif_wire_decode_delta(wire, &r, count, removed);
+		wire->time += time;
+	} else {
+		return -EBADMSG;
+	}
+
+	wire->tick = tick;
+
+	if (!err && r.p != r.end)
+		err = -EBADMSG;
+
+	return err;
+}
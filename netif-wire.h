@@ -0,0 +1,88 @@
+#pragma once
+
+#include <glib.h>
+#include <net/if.h>
+#include <stdbool.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Agent stream: NETIF_WIRE_MAGIC, then frames of a varint payload length
+ * followed by the payload:
+ *
+ *   u8 type		NETIF_WIRE_KEYFRAME or NETIF_WIRE_DELTA
+ *   varint tick
+ *   varint time	agent monotonic usec, since the previous frame in a delta
+ *   varint count
+ *   count entries by ascending ifindex:
+ *     varint gap	ifindex less the previous entry's
+ *     u8 flags		bit n: counter n follows, NETIF_WIRE_F_*
+ *     [varint len, name]	with NETIF_WIRE_F_NAME
+ *     varint counter...	absolute in a keyframe, zigzag delta otherwise
+ *
+ * A keyframe lists every interface, a delta the new, changed and removed
+ * ones only. Varints are LEB128.
+ */
+#define NETIF_WIRE_MAGIC	"NIF1"
+#define NETIF_WIRE_MAGIC_LEN	4
+
+/* larger is a corrupt or hostile stream */
+#define NETIF_WIRE_MAX_FRAME	(16 << 20)
+
+enum {
+	NETIF_WIRE_KEYFRAME = 1,
+	NETIF_WIRE_DELTA = 2,
+};
+
+enum netif_wire_counter {
+	NETIF_WIRE_RX_BYTES,
+	NETIF_WIRE_TX_BYTES,
+	NETIF_WIRE_RX_PACKETS,
+	NETIF_WIRE_TX_PACKETS,
+	NETIF_WIRE_COUNTERS,
+};
+
+#define NETIF_WIRE_F_NAME	0x10
+#define NETIF_WIRE_F_REMOVED	0x20
+
+struct netif_wire_link {
+	guint ifindex;
+	char ifname[IF_NAMESIZE];
+	guint64 counters[NETIF_WIRE_COUNTERS];
+};
+
+/* The interfaces as of one frame, struct netif_wire_link by ifindex */
+struct netif_wire {
+	GArray *links;
+	guint64 tick;
+	gint64 time;
+
+	/* decoding side, a keyframe was applied */
+	bool synced;
+};
+
+void netif_wire_init(struct netif_wire *wire);
+void netif_wire_clear(struct netif_wire *wire);
+
+/* Restore the ifindex order after appending links in any order */
+void netif_wire_sort(struct netif_wire *wire);
+
+/* Append the frame going from @prev to @cur, a keyframe if @prev is NULL */
+void netif_wire_encode(const struct netif_wire *prev, const struct netif_wire *cur,
+		GByteArray *out);
+
+/*
+ * Size of the frame at the start of @buf, 0 if it is not complete yet or
+ * -EBADMSG. *@payload is set to the offset of its payload.
+ */
+gssize netif_wire_frame(const guint8 *buf, gsize len, gsize *payload);
+
+/*
+ * Apply one frame payload to @wire, appending the ifindex of every link
+ * it drops to @removed. On error @wire is left half applied and needs a
+ * keyframe: -EBADMSG if malformed, -EPROTO for a delta before a keyframe.
+ */
+int netif_wire_decode(struct netif_wire *wire, const guint8 *buf, gsize len,
+		GArray *removed);
+
+G_END_DECLS
@@ -16,29 +16,96 @@
 #include <adwaita.h>
 
 #include "kgx-theme-switcher.h"
+#include "netif-agent.h"
+#include "netif-rates.h"
+#include "netif-snapshot.h"
+#include "netif-source.h"
 #include "netif-widget.h"
 
-GtkWidget *adw_win_new(GtkApplication *app, GtkWidget *content)
-{
-	GtkWidget *win = adw_application_window_new(app);
-	gtk_window_set_title(GTK_WINDOW(win), "Network Interface Stats");
+static char *opt_source;
+static gboolean opt_offload;
+static char *opt_record;
+static char *opt_flap_log;
+static char *opt_history;
+static char **opt_groups;
+static char **opt_qdisc;
+static char **opt_pin;
+static int opt_full_interval = 10;
+static char *opt_agent;
+static char **opt_connect;
+static int opt_top;
+static gboolean opt_top_util;
+static int opt_util_alert;
+static gboolean opt_once;
+static char *opt_format;
+static char *opt_output;
+static int opt_interval = 100;
+static gboolean opt_list_sources;
+static gboolean opt_compare_sources;
+static int opt_iterations = 100;
+static int opt_bench_rates;
+static int opt_bench_memory;
 
-	GFile *file = g_file_new_for_uri("resource:///style.css");
-	GtkStyleProvider *css_provider = GTK_STYLE_PROVIDER(gtk_css_provider_new());
-	gtk_css_provider_load_from_file(GTK_CSS_PROVIDER(css_provider), file);
-	gtk_style_context_add_provider_for_display(gdk_display_get_default(),
-			css_provider, GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+/* startup timing, reported with G_MESSAGES_DEBUG=all */
+static gint64 startup_time;
 
+static const GOptionEntry netifstat_options[] = {
+	{ "source", 's', 0, G_OPTION_ARG_STRING, &opt_source,
+		"Stats source: netlink, proc, sysfs or file:PATH", "SOURCE" },
+	{ "offload", 0, 0, G_OPTION_ARG_NONE, &opt_offload,
+		"Show the CPU vs hardware split, same as --source netlink:offload", NULL },
+	{ "record", 'r', 0, G_OPTION_ARG_FILENAME, &opt_record,
+		"Record every sample to FILE for the file source", "FILE" },
+	{ "flap-log", 0, 0, G_OPTION_ARG_FILENAME, &opt_flap_log,
+		"Append timestamped link state changes to FILE", "FILE" },
+	{ "history", 0, 0, G_OPTION_ARG_FILENAME, &opt_history,
+		"Keep rate rollups in DIR, pruned after 30 days unused", "DIR" },
+	{ "group", 'g', 0, G_OPTION_ARG_STRING_ARRAY, &opt_groups,
+		"Aggregate interfaces matching GLOB into one row, repeatable", "NAME=GLOB" },
+	{ "qdisc", 'q', 0, G_OPTION_ARG_STRING_ARRAY, &opt_qdisc,
+		"Always poll the qdiscs of interfaces matching GLOB, repeatable", "GLOB" },
+	{ "pin", 'p', 0, G_OPTION_ARG_STRING_ARRAY, &opt_pin,
+		"Sample interfaces matching GLOB every second even off screen, repeatable", "GLOB" },
+	{ "full-interval", 0, 0, G_OPTION_ARG_INT, &opt_full_interval,
+		"Seconds between dumps of every interface, 1 to dump every second", "N" },
+	{ "agent", 0, 0, G_OPTION_ARG_STRING, &opt_agent,
+		"Serve the counters unauthenticated on [ADDRESS:]PORT instead of showing them, "
+		"loopback only without ADDRESS", "LISTEN" },
+	{ "connect", 'c', 0, G_OPTION_ARG_STRING_ARRAY, &opt_connect,
+		"Add the interfaces of the agent at HOST[:PORT], repeatable", "HOST" },
+	{ "top", 't', 0, G_OPTION_ARG_INT, &opt_top,
+		"Only show the N busiest interfaces", "N" },
+	{ "top-util", 0, 0, G_OPTION_ARG_NONE, &opt_top_util,
+		"Rank the busiest interfaces by share of their link speed", NULL },
+	{ "util-alert", 0, 0, G_OPTION_ARG_INT, &opt_util_alert,
+		"Mark interfaces using at least PERCENT of their link speed", "PERCENT" },
+	{ "once", '1', 0, G_OPTION_ARG_NONE, &opt_once,
+		"Print one snapshot of all counters and rates and exit", NULL },
+	{ "format", 'f', 0, G_OPTION_ARG_STRING, &opt_format,
+		"Snapshot format: csv or json", "FORMAT" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &opt_output,
+		"Write the snapshot to FILE instead of stdout", "FILE" },
+	{ "interval", 'i', 0, G_OPTION_ARG_INT, &opt_interval,
+		"Milliseconds between the two snapshot samples", "MS" },
+	{ "list-sources", 0, 0, G_OPTION_ARG_NONE, &opt_list_sources,
+		"List the available stats sources", NULL },
+	{ "compare-sources", 0, 0, G_OPTION_ARG_NONE, &opt_compare_sources,
+		"Report the CPU cost and latency of each stats source", NULL },
+	{ "iterations", 'n', 0, G_OPTION_ARG_INT, &opt_iterations,
+		"Number of dumps per source for --compare-sources, ticks for --bench-rates", "N" },
+	{ "bench-rates", 0, 0, G_OPTION_ARG_INT, &opt_bench_rates,
+		"Time the batch rate pass against the scalar one over N interfaces", "N" },
+	{ "bench-memory", 0, 0, G_OPTION_ARG_INT, &opt_bench_memory,
+		"Report the resident memory of N interfaces, with their history in --history DIR", "N" },
+	G_OPTION_ENTRY_NULL
+};
+
+/* Built on first use, keeping the theme switcher off the startup path */
+static void menu_create_popup(GtkMenuButton *menubutton, gpointer data)
+{
 	GtkIconTheme *theme = gtk_icon_theme_get_for_display(gdk_display_get_default());
-	gtk_icon_theme_add_resource_path(theme, "/icons/scalable");
-	g_assert(gtk_icon_theme_has_icon(theme, "open-menu-symbolic"));
 	g_assert(gtk_icon_theme_has_icon(theme, "theme-check-symbolic"));
 
-	GtkWidget *headerbar = adw_header_bar_new();
-	GtkWidget *menubutton = gtk_menu_button_new();
-	adw_header_bar_pack_end(ADW_HEADER_BAR(headerbar), menubutton);
-	gtk_menu_button_set_icon_name(GTK_MENU_BUTTON(menubutton), "open-menu-symbolic");
-
 	GMenu *menu = g_menu_new();
 	GMenuItem *item = g_menu_item_new(NULL, NULL);
 	g_menu_item_set_attribute(item, "custom", "s", "theme-switcher");
@@ -49,6 +116,22 @@ GtkWidget *adw_win_new(GtkApplication *app, GtkWidget *content)
 	g_menu_append_item(section, item);
 	item = g_menu_item_new("Simple Mode", "app.simple-mode");
 	g_menu_append_item(section, item);
+	item = g_menu_item_new("Busiest Interfaces", "app.top-mode");
+	g_menu_append_item(section, item);
+	item = g_menu_item_new("Rank by Utilization", "app.top-by-util");
+	g_menu_append_item(section, item);
+	item = g_menu_item_new("Throughput Chart", "app.throughput-chart");
+	g_menu_append_item(section, item);
+	item = g_menu_item_new("Rate Heatmap", "app.rate-heatmap");
+	g_menu_append_item(section, item);
+	item = g_menu_item_new("Softnet Backlog", "app.softnet-backlog");
+	g_menu_append_item(section, item);
+	item = g_menu_item_new("Performance Overlay", "app.perf-overlay");
+	g_menu_append_item(section, item);
+	item = g_menu_item_new("Export Snapshot…", "app.export-snapshot");
+	g_menu_append_item(section, item);
+	item = g_menu_item_new("Export Histograms…", "app.export-histograms");
+	g_menu_append_item(section, item);
 
 	g_menu_append_section(menu, NULL, G_MENU_MODEL(section));
 
@@ -63,11 +146,43 @@ GtkWidget *adw_win_new(GtkApplication *app, GtkWidget *content)
 			style_manager, "color-scheme", G_BINDING_SYNC_CREATE,
 			theme_to_color_scheme, NULL, NULL, NULL);
 
-	gtk_menu_button_set_popover(GTK_MENU_BUTTON(menubutton), popover);
+	gtk_menu_button_set_popover(menubutton, popover);
+}
+
+GtkWidget *adw_win_new(GtkApplication *app, GtkWidget *content, GtkWidget *searchbar)
+{
+	GtkWidget *win = adw_application_window_new(app);
+	gtk_window_set_title(GTK_WINDOW(win), "Network Interface Stats");
+
+	GFile *file = g_file_new_for_uri("resource:///style.css");
+	GtkStyleProvider *css_provider = GTK_STYLE_PROVIDER(gtk_css_provider_new());
+	gtk_css_provider_load_from_file(GTK_CSS_PROVIDER(css_provider), file);
+	gtk_style_context_add_provider_for_display(gdk_display_get_default(),
+			css_provider, GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+	GtkIconTheme *theme = gtk_icon_theme_get_for_display(gdk_display_get_default());
+	gtk_icon_theme_add_resource_path(theme, "/icons/scalable");
+	g_assert(gtk_icon_theme_has_icon(theme, "open-menu-symbolic"));
+
+	GtkWidget *headerbar = adw_header_bar_new();
+	GtkWidget *menubutton = gtk_menu_button_new();
+	adw_header_bar_pack_end(ADW_HEADER_BAR(headerbar), menubutton);
+	gtk_menu_button_set_icon_name(GTK_MENU_BUTTON(menubutton), "open-menu-symbolic");
+
+	GtkWidget *searchbutton = gtk_toggle_button_new();
+	gtk_button_set_icon_name(GTK_BUTTON(searchbutton), "system-search-symbolic");
+	adw_header_bar_pack_start(ADW_HEADER_BAR(headerbar), searchbutton);
+	g_object_bind_property(searchbutton, "active", searchbar, "search-mode-enabled",
+			G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
+	gtk_search_bar_set_key_capture_widget(GTK_SEARCH_BAR(searchbar), win);
+
+	gtk_menu_button_set_create_popup_func(GTK_MENU_BUTTON(menubutton),
+			menu_create_popup, NULL, NULL);
 
 	GtkWidget *toolbarview = adw_toolbar_view_new();
 
 	adw_toolbar_view_add_top_bar(ADW_TOOLBAR_VIEW(toolbarview), headerbar);
+	adw_toolbar_view_add_top_bar(ADW_TOOLBAR_VIEW(toolbarview), searchbar);
 	adw_toolbar_view_set_content(ADW_TOOLBAR_VIEW(toolbarview), content);
 
 	adw_application_window_set_content(ADW_APPLICATION_WINDOW(win), toolbarview);
@@ -75,9 +190,218 @@ GtkWidget *adw_win_new(GtkApplication *app, GtkWidget *content)
 	return win;
 }
 
+struct snapshot_job {
+	char *source;
+	char *path;
+};
+
+static void snapshot_job_free(gpointer data)
+{
+	struct snapshot_job *job = data;
+
+	g_free(job->source);
+	g_free(job->path);
+	g_free(job);
+}
+
+/* Runs on its own source instance, so it never touches the widget */
+static void snapshot_thread(GTask *task, gpointer object, gpointer data,
+		GCancellable *cancellable)
+{
+	struct snapshot_job *job = data;
+	enum netif_snapshot_format format = g_str_has_suffix(job->path, ".json") ?
+		NETIF_SNAPSHOT_JSON : NETIF_SNAPSHOT_CSV;
+	FILE *out = fopen(job->path, "we");
+	int err;
+
+	if (!out) {
+		err = errno;
+		g_task_return_new_error(task, G_IO_ERROR, g_io_error_from_errno(err),
+				"%s: %s", job->path, g_strerror(err));
+		return;
+	}
+
+	err = netif_snapshot_write(job->source, MAX(opt_interval, 1), format, out);
+	fclose(out);
+
+	if (err < 0)
+		g_task_return_new_error(task, G_IO_ERROR, g_io_error_from_errno(-err),
+				"%s: %s", job->path, g_strerror(-err));
+	else
+		g_task_return_boolean(task, TRUE);
+}
+
+static void on_snapshot_done(GObject *object, GAsyncResult *result, gpointer data)
+{
+	g_autoptr(GError) error = NULL;
+
+	if (!g_task_propagate_boolean(G_TASK(result), &error))
+		g_warning("snapshot export failed: %s", error->message);
+}
+
+static void on_snapshot_file(GObject *dialog, GAsyncResult *result, gpointer data)
+{
+	GtkWidget *netif = data;
+	g_autoptr(GFile) file = gtk_file_dialog_save_finish(GTK_FILE_DIALOG(dialog), result, NULL);
+	struct snapshot_job *job;
+	GTask *task;
+
+	if (!file)
+		return;
+
+	job = g_new0(struct snapshot_job, 1);
+	job->path = g_file_get_path(file);
+	g_object_get(netif, "source", &job->source, NULL);
+
+	task = g_task_new(NULL, NULL, on_snapshot_done, NULL);
+	g_task_set_task_data(task, job, snapshot_job_free);
+	g_task_run_in_thread(task, snapshot_thread);
+	g_object_unref(task);
+}
+
+static void on_export_snapshot(GSimpleAction *action, GVariant *param, gpointer data)
+{
+	GtkWidget *netif = data;
+	GtkFileDialog *dialog = gtk_file_dialog_new();
+
+	gtk_file_dialog_set_initial_name(dialog, "netifstat.csv");
+	gtk_file_dialog_save(dialog, GTK_WINDOW(gtk_widget_get_root(netif)), NULL,
+			on_snapshot_file, netif);
+	g_object_unref(dialog);
+}
+
+static void on_histogram_file(GObject *dialog, GAsyncResult *result, gpointer data)
+{
+	g_autoptr(GFile) file = gtk_file_dialog_save_finish(GTK_FILE_DIALOG(dialog), result, NULL);
+	g_autofree char *path = NULL;
+	FILE *out;
+
+	if (!file)
+		return;
+
+	/* a few KiB per interface, not worth a thread */
+	path = g_file_get_path(file);
+	out = fopen(path, "we");
+	if (!out) {
+		g_warning("%s: %s", path, g_strerror(errno));
+		return;
+	}
+
+	if (netif_widget_write_histograms(NETIF_WIDGET(data), out) < 0)
+		g_warning("%s: write failed", path);
+	fclose(out);
+}
+
+static void on_export_histograms(GSimpleAction *action, GVariant *param, gpointer data)
+{
+	GtkWidget *netif = data;
+	GtkFileDialog *dialog = gtk_file_dialog_new();
+
+	gtk_file_dialog_set_initial_name(dialog, "netifstat-histograms.csv");
+	gtk_file_dialog_save(dialog, GTK_WINDOW(gtk_widget_get_root(netif)), NULL,
+			on_histogram_file, netif);
+	g_object_unref(dialog);
+}
+
+static void on_rate_heatmap(GSimpleAction *action, GVariant *param, gpointer data)
+{
+	NetifWidget *netif = data;
+	GtkWidget *win = adw_window_new();
+	GtkWidget *box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 6);
+
+	gtk_window_set_title(GTK_WINDOW(win), "Rate Distribution");
+	gtk_window_set_transient_for(GTK_WINDOW(win),
+			GTK_WINDOW(gtk_widget_get_root(GTK_WIDGET(netif))));
+	gtk_window_set_default_size(GTK_WINDOW(win), 0, 500);
+
+	for (int tx = 0; tx < 2; tx++) {
+		GtkWidget *label = gtk_label_new(tx ? "Tx bytes/s" : "Rx bytes/s");
+
+		gtk_widget_add_css_class(label, "heading");
+		gtk_label_set_xalign(GTK_LABEL(label), 0);
+		gtk_box_append(GTK_BOX(box), label);
+		gtk_box_append(GTK_BOX(box), netif_widget_heatmap_new(netif, tx));
+	}
+
+	GtkWidget *scrolled = gtk_scrolled_window_new();
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled),
+			GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scrolled), box);
+	gtk_widget_set_margin_start(box, 12);
+	gtk_widget_set_margin_end(box, 12);
+	gtk_widget_set_margin_bottom(box, 12);
+
+	GtkWidget *toolbarview = adw_toolbar_view_new();
+	adw_toolbar_view_add_top_bar(ADW_TOOLBAR_VIEW(toolbarview), adw_header_bar_new());
+	adw_toolbar_view_set_content(ADW_TOOLBAR_VIEW(toolbarview), scrolled);
+	adw_window_set_content(ADW_WINDOW(win), toolbarview);
+
+	gtk_window_present(GTK_WINDOW(win));
+}
+
+static void on_softnet_backlog(GSimpleAction *action, GVariant *param, gpointer data)
+{
+	NetifWidget *netif = data;
+	GtkWidget *win = adw_window_new();
+	GtkWidget *view = netif_widget_softnet_new(netif);
+
+	gtk_window_set_title(GTK_WINDOW(win), "Softnet Backlog");
+	gtk_window_set_transient_for(GTK_WINDOW(win),
+			GTK_WINDOW(gtk_widget_get_root(GTK_WIDGET(netif))));
+	gtk_window_set_default_size(GTK_WINDOW(win), 0, 400);
+
+	gtk_widget_set_margin_start(view, 12);
+	gtk_widget_set_margin_end(view, 12);
+	gtk_widget_set_margin_bottom(view, 12);
+
+	GtkWidget *scrolled = gtk_scrolled_window_new();
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled),
+			GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scrolled), view);
+
+	GtkWidget *toolbarview = adw_toolbar_view_new();
+	adw_toolbar_view_add_top_bar(ADW_TOOLBAR_VIEW(toolbarview), adw_header_bar_new());
+	adw_toolbar_view_set_content(ADW_TOOLBAR_VIEW(toolbarview), scrolled);
+	adw_window_set_content(ADW_WINDOW(win), toolbarview);
+
+	gtk_window_present(GTK_WINDOW(win));
+}
+
+static void on_search_changed(GtkSearchEntry *entry, GtkWidget *netif)
+{
+	g_object_set(netif, "filter-text", gtk_editable_get_text(GTK_EDITABLE(entry)), NULL);
+}
+
+static void on_first_frame(GdkFrameClock *clock, gpointer data)
+{
+	g_debug("time to first frame: %.1f ms",
+			(g_get_monotonic_time() - startup_time) / 1000.0);
+	g_signal_handlers_disconnect_by_func(clock, on_first_frame, data);
+}
+
+static void on_loaded(GObject *netif, GParamSpec *pspec, gpointer data)
+{
+	g_debug("time to first data: %.1f ms",
+			(g_get_monotonic_time() - startup_time) / 1000.0);
+	g_signal_handlers_disconnect_by_func(netif, on_loaded, data);
+}
+
 static void on_activate(GtkApplication *app)
 {
-	GtkWidget *netif = g_object_new(NETIF_TYPE_WIDGET, NULL);
+	GtkWidget *netif = g_object_new(NETIF_TYPE_WIDGET,
+			"source", opt_source,
+			"record", opt_record,
+			"flap-log", opt_flap_log,
+			"history-dir", opt_history,
+			"groups", opt_groups,
+			"agents", opt_connect,
+			"qdisc-watch", opt_qdisc,
+			"pin", opt_pin,
+			"full-interval", (guint)MAX(opt_full_interval, 1),
+			"top-by-util", opt_top_util,
+			"util-alert", (guint)CLAMP(opt_util_alert, 0, 100),
+			NULL);
+	g_signal_connect(netif, "notify::loaded", G_CALLBACK(on_loaded), NULL);
 
 	GPropertyAction *action = g_property_action_new("raw-bytes", netif, "raw-bytes");
 	g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(action));
@@ -85,21 +409,158 @@ static void on_activate(GtkApplication *app)
 	action = g_property_action_new("simple-mode", netif, "simple-mode");
 	g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(action));
 
+	if (opt_top > 0)
+		g_object_set(netif, "top-n", (guint)opt_top, "top-mode", TRUE, NULL);
+
+	action = g_property_action_new("top-mode", netif, "top-mode");
+	g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(action));
+
+	action = g_property_action_new("top-by-util", netif, "top-by-util");
+	g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(action));
+
+	GSimpleAction *export_action = g_simple_action_new("export-snapshot", NULL);
+	g_signal_connect(export_action, "activate", G_CALLBACK(on_export_snapshot), netif);
+	g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(export_action));
+
+	export_action = g_simple_action_new("export-histograms", NULL);
+	g_signal_connect(export_action, "activate", G_CALLBACK(on_export_histograms), netif);
+	g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(export_action));
+
+	GSimpleAction *heatmap_action = g_simple_action_new("rate-heatmap", NULL);
+	g_signal_connect(heatmap_action, "activate", G_CALLBACK(on_rate_heatmap), netif);
+	g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(heatmap_action));
+
+	GSimpleAction *softnet_action = g_simple_action_new("softnet-backlog", NULL);
+	g_signal_connect(softnet_action, "activate", G_CALLBACK(on_softnet_backlog), netif);
+	g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(softnet_action));
+
+	GDBusConnection *conn = g_application_get_dbus_connection(G_APPLICATION(app));
+	if (conn) {
+		g_autoptr(GError) error = NULL;
+
+		if (!netif_widget_export(NETIF_WIDGET(netif), conn,
+					g_application_get_dbus_object_path(G_APPLICATION(app)), &error))
+			g_warning("D-Bus export: %s", error->message);
+	}
+
 	GtkWidget *scrolled = gtk_scrolled_window_new();
 	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled),
 			GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
 	gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scrolled), netif);
-	GtkWidget *window = adw_win_new(app, scrolled);
+
+	/* plots the selected rows, hidden until asked for */
+	GtkWidget *chart = netif_widget_chart_new(NETIF_WIDGET(netif));
+	gtk_widget_set_visible(chart, FALSE);
+	action = g_property_action_new("throughput-chart", chart, "visible");
+	g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(action));
+
+	/* where the time of each tick goes, for debugging */
+	GtkWidget *perf = netif_widget_perf_new(NETIF_WIDGET(netif));
+	gtk_widget_set_visible(perf, FALSE);
+	action = g_property_action_new("perf-overlay", perf, "visible");
+	g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(action));
+
+	GtkWidget *overlay = gtk_overlay_new();
+	gtk_overlay_set_child(GTK_OVERLAY(overlay), scrolled);
+	gtk_overlay_add_overlay(GTK_OVERLAY(overlay), perf);
+
+	GtkWidget *paned = gtk_paned_new(GTK_ORIENTATION_VERTICAL);
+	gtk_paned_set_start_child(GTK_PANED(paned), overlay);
+	gtk_paned_set_end_child(GTK_PANED(paned), chart);
+	gtk_paned_set_shrink_end_child(GTK_PANED(paned), FALSE);
+
+	GtkWidget *entry = gtk_search_entry_new();
+	gtk_search_entry_set_placeholder_text(GTK_SEARCH_ENTRY(entry),
+			"name, state:up, netns:1, host:db*, glob* or /regex");
+	g_signal_connect(entry, "search-changed", G_CALLBACK(on_search_changed), netif);
+
+	GtkWidget *searchbar = gtk_search_bar_new();
+	gtk_search_bar_set_child(GTK_SEARCH_BAR(searchbar), entry);
+	gtk_search_bar_connect_entry(GTK_SEARCH_BAR(searchbar), GTK_EDITABLE(entry));
+
+	GtkWidget *window = adw_win_new(app, paned, searchbar);
 	gtk_window_set_default_size(GTK_WINDOW(window), 0, 400);
 
 	gtk_window_present(GTK_WINDOW(window));
+
+	g_signal_connect(gtk_widget_get_frame_clock(window), "after-paint",
+			G_CALLBACK(on_first_frame), NULL);
+}
+
+static int netifstat_once(void)
+{
+	enum netif_snapshot_format format;
+	FILE *out = stdout;
+	int err;
+
+	if (netif_snapshot_format_parse(opt_format, &format) < 0) {
+		g_printerr("unknown snapshot format %s\n", opt_format);
+		return 1;
+	}
+
+	if (opt_output) {
+		out = fopen(opt_output, "we");
+		if (!out) {
+			g_printerr("%s: %s\n", opt_output, g_strerror(errno));
+			return 1;
+		}
+	}
+
+	err = netif_snapshot_write(opt_source, MAX(opt_interval, 1), format, out);
+	if (out != stdout)
+		fclose(out);
+
+	if (err < 0) {
+		g_printerr("snapshot failed: %s\n", g_strerror(-err));
+		return 1;
+	}
+
+	return 0;
+}
+
+static int on_handle_local_options(GApplication *app, GVariantDict *options)
+{
+	if (opt_list_sources) {
+		netif_source_list(stdout);
+		return 0;
+	}
+
+	if (opt_compare_sources)
+		return netif_source_compare(stdout, opt_iterations) < 0 ? 1 : 0;
+
+	if (opt_bench_rates > 0)
+		return netif_rates_bench(stdout, opt_bench_rates, MAX(opt_iterations, 1)) < 0 ? 1 : 0;
+
+	if (opt_bench_memory > 0)
+		return netif_link_table_bench(stdout, opt_bench_memory, opt_history) < 0 ? 1 : 0;
+
+	if (opt_offload) {
+		if (opt_source && !g_str_has_prefix(opt_source, "netlink")) {
+			g_printerr("--offload needs the netlink source\n");
+			return 1;
+		}
+		g_free(opt_source);
+		opt_source = g_strdup("netlink:offload");
+	}
+
+	if (opt_once)
+		return netifstat_once();
+
+	/* dumps at the viewer's tick, without a display */
+	if (opt_agent)
+		return netif_agent_run(opt_source, opt_agent, 1000) < 0 ? 1 : 0;
+
+	return -1;
 }
 
 int main(int argc, char *argv[])
 {
 	g_autoptr(AdwApplication) app = NULL;
 
+	startup_time = g_get_monotonic_time();
 	app = adw_application_new("cc.call.netifstat", G_APPLICATION_DEFAULT_FLAGS);
+	g_application_add_main_option_entries(G_APPLICATION(app), netifstat_options);
+	g_signal_connect(app, "handle-local-options", G_CALLBACK(on_handle_local_options), NULL);
 	g_signal_connect(app, "activate", G_CALLBACK(on_activate), NULL);
 	return g_application_run(G_APPLICATION(app), argc, argv);
 }